@@ -0,0 +1,78 @@
+#ifndef ALIGN_HPP
+#define ALIGN_HPP 1
+
+#include "fundamentals.hpp"
+#include "batch.hpp"
+#include <string>
+#include <vector>
+
+namespace bioinfo {
+    enum class AlignmentMode {
+        GLOBAL, // Needleman-Wunsch, both sequences aligned end to end
+        LOCAL, // Smith-Waterman, the best scoring pair of substrings
+        SEMI_GLOBAL // Gaps before the start and after the end of either sequence are free
+    };
+
+    // Substitution scores over an alphabet. Characters are matched case insensitively, U scores as T, and every character
+    // outside the alphabet scores as the wildcard (the last letter of the alphabet).
+    class ScoringMatrix {
+        private:
+            std::string alphabet;
+            std::vector<int> scores; // Row major, alphabet.length() x alphabet.length()
+            unsigned char codes[256]; // Character to index in the alphabet
+            int maxScore;
+            int minScore;
+        public:
+            ScoringMatrix(const std::string &alphabet, const std::vector<int> &scores);
+
+            const std::string &getAlphabet() const;
+            unsigned int size() const;
+            unsigned char code(char c) const;
+            int score(unsigned char a, unsigned char b) const;
+            int score(char a, char b) const;
+            int getMaxScore() const;
+            int getMinScore() const;
+    };
+
+    ScoringMatrix nucleotideMatrix(int match = 2, int mismatch = -3);
+    ScoringMatrix blosum62Matrix();
+
+    struct Alignment {
+        int score = 0;
+        unsigned long int queryStart = 0; // Aligned part of the query is [queryStart, queryEnd)
+        unsigned long int queryEnd = 0;
+        unsigned long int targetStart = 0; // Aligned part of the target is [targetStart, targetEnd)
+        unsigned long int targetEnd = 0;
+        std::string cigar; // '=' match, 'X' mismatch, 'I' base only in the query, 'D' base only in the target
+        std::string alignedQuery; // Query with '-' in its gaps
+        std::string alignedTarget; // Target with '-' in its gaps
+    } typedef Alignment;
+
+    // Pairwise aligner with affine gaps, where a gap of length L costs `gapOpen` + (L - 1) * `gapExtend`. Score-only calls
+    // run a striped SIMD kernel in 8-bit (local mode) or 16-bit lanes and fall back to a wider kernel when the scores
+    // overflow; alignments with traceback always use the scalar kernel.
+    class Aligner {
+        private:
+            ScoringMatrix matrix;
+            int gapOpen;
+            int gapExtend;
+            AlignmentMode mode;
+        public:
+            Aligner(ScoringMatrix matrix, int gapOpen, int gapExtend, AlignmentMode mode = AlignmentMode::GLOBAL);
+
+            const ScoringMatrix &getMatrix() const;
+            int getGapOpen() const;
+            int getGapExtend() const;
+            AlignmentMode getMode() const;
+
+            int score(SequenceView query, SequenceView target) const;
+            Alignment align(SequenceView query, SequenceView target) const;
+
+            std::vector<int> scoreBatch(SequenceView query, const std::vector<SequenceView> &targets, unsigned int threads = 0) const;
+            std::vector<int> scoreBatch(SequenceView query, const SequenceBatch &targets, unsigned int threads = 0) const;
+            std::vector<Alignment> alignBatch(SequenceView query, const std::vector<SequenceView> &targets,
+                                              unsigned int threads = 0) const;
+    };
+}
+
+#endif
@@ -2,8 +2,11 @@
 #define ANALYSIS_HPP 1
 
 #include "fundamentals.hpp"
+#include "batch.hpp"
 #include <vector>
 #include <string>
+#include <cstdint>
+#include <functional>
 
 namespace bioinfo {
     typedef std::unordered_map<char, double> MassTable;
@@ -18,6 +21,99 @@ namespace bioinfo {
         };
     }
 
+    struct HammingPair {
+        unsigned int first = 0;
+        unsigned int second = 0;
+        unsigned int distance = 0;
+    } typedef HammingPair;
+
+    typedef HammingPair EditDistancePair; // Same layout, `distance` is the Levenshtein distance
+
+    struct OpenReadingFrame {
+        int frame = 1; // 1 to 3 on the forward strand, -1 to -3 on the reverse complement
+        unsigned int start = 0; // Index of the lowest forward strand base covered by the ORF
+        unsigned int end = 0; // One past the highest forward strand base covered by the ORF, stop codon included
+        std::string protein; // Translated ORF without the stop codon
+    } typedef OpenReadingFrame;
+
+    const unsigned int MAX_KMER_LENGTH = 64; // Longest k-mer that fits the 128-bit keys of the k-mer counter
+
+    struct KmerCount {
+        std::string kmer;
+        unsigned long int count = 0;
+    } typedef KmerCount;
+
+    class KmerCounts {
+        private:
+            unsigned int k;
+            bool canonical;
+            std::vector<uint64_t> words; // 2-bit codes sorted ascending, one word per k-mer up to k = 32 and two (high, low) above
+            std::vector<unsigned long int> counts;
+        public:
+            KmerCounts(unsigned int k, bool canonical, std::vector<uint64_t> words, std::vector<unsigned long int> counts);
+
+            unsigned int getK() const;
+            bool isCanonical() const;
+            size_t size() const;
+            unsigned long int getTotal() const;
+            std::string getKmer(size_t i) const;
+            unsigned long int getCount(size_t i) const;
+
+            size_t find(SequenceView kmer) const;
+            unsigned long int count(SequenceView kmer) const;
+            std::vector<unsigned long int> histogram(unsigned long int maxCount = 10000) const;
+            std::vector<KmerCount> topN(size_t n) const;
+    };
+
+    struct KmerSpillOptions {
+        size_t memoryBudget = 1UL << 30; // Bytes the out-of-core counter may use at once
+        std::string tempDirectory = "."; // Where the bucket files are written
+        unsigned int buckets = 0; // Number of bucket files, 0 to pick enough to count each bucket within the budget
+        unsigned int threads = 0; // 0 for one per core
+    } typedef KmerSpillOptions;
+
+    enum class SketchMode {
+        BOTTOM_K, // Keep the `size` smallest k-mer hashes (MinHash as in Mash)
+        FRACTIONAL // Keep every k-mer hash below 2^64 / `size` (FracMinHash with scale factor `size`)
+    };
+
+    struct SketchPair {
+        unsigned int first = 0;
+        unsigned int second = 0;
+        double distance = 0.0;
+    } typedef SketchPair;
+
+    class MinHashSketch {
+        private:
+            std::string name;
+            unsigned int k;
+            SketchMode mode;
+            unsigned long int size;
+            std::vector<uint64_t> hashes; // Hashes of canonical k-mers, sorted ascending without repeats
+
+            void addHashes(std::vector<uint64_t> &batch);
+            void checkCompatible(const MinHashSketch &other) const;
+
+            friend std::vector<MinHashSketch> readSketches(const std::string &fn);
+        public:
+            MinHashSketch(unsigned int k, SketchMode mode, unsigned long int size, std::string name = "");
+            MinHashSketch(DNAString &ds, unsigned int k, SketchMode mode, unsigned long int size);
+
+            const std::string &getName() const;
+            void setName(std::string n);
+            unsigned int getK() const;
+            SketchMode getMode() const;
+            unsigned long int getSize() const;
+            const std::vector<uint64_t> &getHashes() const;
+
+            void add(SequenceView s);
+            void merge(const MinHashSketch &other);
+
+            double jaccard(const MinHashSketch &other) const;
+            double containment(const MinHashSketch &other) const;
+            double mashDistance(const MinHashSketch &other) const;
+    };
+
     struct DirectedEdge {
         std::string tail;
         std::string head;
@@ -26,18 +122,42 @@ namespace bioinfo {
     class AdjacencyList {
         private:
             std::vector<DirectedEdge> dsde;
-            template <typename T> void internalConstructor(std::vector<T> &vec, unsigned int ok);
+            template <typename T> void internalConstructor(std::vector<T> &vec, unsigned int ok, unsigned int threads);
         public:
-            AdjacencyList(std::vector<DNAString> &vec, unsigned int ok);
+            AdjacencyList(std::vector<DNAString> &vec, unsigned int ok, unsigned int threads = 0);
+            const std::vector<DirectedEdge> &getEdges() const;
             std::string toString();
 
     };
 
     std::vector<unsigned int> exactDNAStringMotif(DNAString &ds, DNAString &motif, bool overlap);
     unsigned int hammingDistance(DNAString &s, DNAString &t);
+    unsigned int hammingDistance(const std::string &s, const std::string &t);
+    unsigned int hammingDistance(SequenceView s, SequenceView t);
+    std::vector<unsigned int> hammingDistanceMatrix(std::vector<DNAString> &vec, unsigned int threads);
+    std::vector<HammingPair> hammingDistancePairs(std::vector<DNAString> &vec, unsigned int maxDistance, unsigned int threads);
+    unsigned int editDistance(DNAString &s, DNAString &t);
+    unsigned int editDistance(SequenceView s, SequenceView t);
+    unsigned int editDistance(SequenceView s, SequenceView t, unsigned int maxDistance);
+    std::vector<unsigned int> editDistances(SequenceView query, const std::vector<SequenceView> &targets,
+                                            unsigned int maxDistance, unsigned int threads);
+    std::vector<EditDistancePair> editDistancePairs(std::vector<DNAString> &vec, unsigned int maxDistance, unsigned int threads);
     double proteinMass(AAString &as, const MassTable &mt);
+    double proteinMass(SequenceView s, const MassTable &mt);
     unsigned int inferredRNACount(AAString &as, const AATranscribableUnitTable &ut, unsigned int m);
+    unsigned int inferredRNACount(SequenceView s, const AATranscribableUnitTable &ut, unsigned int m);
     RNAString spliceRNA(RNAString &s, std::vector<RNAString> &introns);
+    std::vector<OpenReadingFrame> findORFs(DNAString &ds, const CodonTable &ct, unsigned int minLength, bool nested);
+    KmerCounts countKmers(std::vector<DNAString> &vec, unsigned int k, bool canonical, unsigned int threads);
+    KmerCounts countKmers(const SequenceBatch &batch, unsigned int k, bool canonical, unsigned int threads);
+    void countKmersOutOfCore(const std::string &fn, unsigned int k, bool canonical, const KmerSpillOptions &options,
+                             const std::function<void(KmerCounts &)> &consume);
+    KmerCounts countKmersOutOfCore(const std::string &fn, unsigned int k, bool canonical, const KmerSpillOptions &options);
+    MinHashSketch sketchFASTAFile(const std::string &fn, unsigned int k, SketchMode mode, unsigned long int size,
+                                  unsigned int threads);
+    std::vector<SketchPair> mashDistancePairs(std::vector<MinHashSketch> &sketches, double maxDistance, unsigned int threads);
+    void writeSketches(const std::string &fn, const std::vector<MinHashSketch> &sketches);
+    std::vector<MinHashSketch> readSketches(const std::string &fn);
 }
 
 #endif
\ No newline at end of file
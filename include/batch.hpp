@@ -0,0 +1,54 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP 1
+
+#include "fundamentals.hpp"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace bioinfo {
+    // One record of a SequenceBatch, read through views into the arenas of the batch
+    class SequenceRecord {
+        private:
+            SequenceView header;
+            SequenceView sequence;
+        public:
+            SequenceRecord(SequenceView h, SequenceView s);
+
+            SequenceView getHeader() const;
+            SequenceView getSequence() const;
+            SequenceView getSequenceView() const;
+            unsigned int getSequenceLength() const;
+            DNAString toDNAString() const;
+    };
+
+    class SequenceBatch {
+        private:
+            std::string headers; // Every header back to back
+            std::string sequences; // Every sequence back to back, uppercased like a DNAString
+            std::vector<size_t> headerOffsets; // Header i is headers[headerOffsets[i], headerOffsets[i + 1])
+            std::vector<size_t> sequenceOffsets; // Sequence i is sequences[sequenceOffsets[i], sequenceOffsets[i + 1])
+        public:
+            SequenceBatch();
+
+            void reserve(size_t records, size_t bases, size_t headerBytes = 0);
+            void clear();
+
+            size_t size() const;
+            bool empty() const;
+            size_t getTotalLength() const;
+
+            void append(SequenceView h, SequenceView s);
+            void append(DNAString &ds);
+
+            SequenceRecord operator[](size_t i) const;
+            SequenceView getHeader(size_t i) const;
+            SequenceView getSequence(size_t i) const;
+            unsigned int getSequenceLength(size_t i) const;
+
+            DNAString toDNAString(size_t i) const;
+            std::vector<DNAString> toDNAStrings() const;
+    };
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef BENCHALLOC_HPP
+#define BENCHALLOC_HPP 1
+
+namespace bioinfo {
+    // Heap allocations made through the global operator new by any thread since the program started. Only the benchmark
+    // binary links the counting operators, so these are not part of the library.
+    unsigned long int allocationCount();
+    unsigned long int allocationBytes();
+}
+
+#endif
@@ -1,22 +1,188 @@
 #ifndef BIOMATH_HPP
 #define BIOMATH_HPP 1
 
+#include "parallel.hpp"
 #include <vector>
 #include <string>
+#include <iostream>
+#include <cstdint>
+#include <utility>
 
 namespace bioinfo {
+    // Arbitrary precision unsigned integer stored as little endian 32-bit limbs, so recurrences can run long past ULONG_MAX.
+    class BigUnsigned {
+        private:
+            std::vector<uint32_t> limbs; // Least significant limb first, with no leading zero limbs (zero has none)
+
+            void trim();
+        public:
+            BigUnsigned(unsigned long int value = 0);
+
+            bool isZero() const;
+            size_t bitLength() const;
+            bool fitsUnsignedLong() const;
+            unsigned long int toUnsignedLong() const;
+            unsigned long int mod(unsigned long int modulus) const;
+            std::string toString() const;
+
+            BigUnsigned &operator+=(const BigUnsigned &other);
+            BigUnsigned operator+(const BigUnsigned &other) const;
+            BigUnsigned operator*(const BigUnsigned &other) const;
+            bool operator==(const BigUnsigned &other) const;
+            bool operator!=(const BigUnsigned &other) const;
+            bool operator<(const BigUnsigned &other) const;
+    };
+
+    std::ostream &operator<<(std::ostream &os, const BigUnsigned &value);
+
+    // Linear recurrence over a state vector, where one step maps `state` to `transition` * `state` and the term after `n`
+    // steps is the dot product of `weights` with the state. Terms are computed by repeated squaring of the transition matrix,
+    // O(m^3 log n) for an m x m matrix, either exactly or modulo an integer.
+    class LinearRecurrence {
+        private:
+            unsigned int m;
+            std::vector<unsigned long int> transition; // Row major, m x m
+            std::vector<unsigned long int> initial;
+            std::vector<unsigned long int> weights;
+        public:
+            LinearRecurrence(const std::vector<std::vector<unsigned long int>> &transition,
+                             const std::vector<unsigned long int> &initial, const std::vector<unsigned long int> &weights);
+
+            unsigned int size() const;
+            BigUnsigned term(unsigned long int n) const;
+            unsigned long int term(unsigned long int n, unsigned long int modulus) const;
+            unsigned long int termChecked(unsigned long int n) const;
+    };
+
+    LinearRecurrence fibonacciRecurrence(unsigned long int k = 1);
+    LinearRecurrence mortalFibonacciRecurrence(unsigned long int k, unsigned int m);
+
     double factorial(int n);
     unsigned long int fibonacci(unsigned int n);
+    unsigned long int fibonacci(unsigned int n, unsigned long int modulus);
+    BigUnsigned bigFibonacci(unsigned int n);
     double binomialDistribution(unsigned int n, unsigned int x, double p);
 
+    double logFactorial(unsigned long int n);
+    double logBinomialCoefficient(unsigned long int n, unsigned long int x);
+    double logBinomialDistribution(unsigned int n, unsigned int x, double p);
+    double logBinomialTail(unsigned int n, unsigned int x, double p);
+    double binomialTail(unsigned int n, unsigned int x, double p);
+    double binomialCDF(unsigned int n, unsigned int x, double p);
+
+    std::vector<double> binomialDistribution(const std::vector<unsigned int> &n, const std::vector<unsigned int> &x,
+                                             const std::vector<double> &p, unsigned int threads = 0);
+    std::vector<double> binomialTail(const std::vector<unsigned int> &n, const std::vector<unsigned int> &x,
+                                     const std::vector<double> &p, unsigned int threads = 0);
+
+    // Philox4x32-10 counter-based random generator. Every (`seed`, `stream`) pair names an independent sequence and the
+    // output depends only on the counter, so replicates that each own a stream reproduce on any number of threads.
+    class PhiloxRandom {
+        private:
+            uint32_t key[2];
+            uint32_t counter[4]; // Block number in the low two words, stream in the high two
+            uint32_t block[4];
+            unsigned int used; // Words of `block` already handed out
+
+            void refill();
+        public:
+            PhiloxRandom(uint64_t seed, uint64_t stream = 0);
+
+            uint32_t next();
+            double uniform();
+    };
+
+    // Draws from a binomial distribution with `n` trials and success probability `p`. Means below 10 are drawn by inversion
+    // and larger ones by Hoermann's BTRS transformed rejection, whose constants are set up once per sampler.
+    class BinomialSampler {
+        private:
+            unsigned long int n;
+            double p; // Success probability actually sampled, at most 0.5
+            bool flipped; // Whether failures are counted because the requested probability was above 0.5
+            bool inversion;
+            double q;
+            double odds; // p / q
+            double a;
+            double b;
+            double c;
+            double alpha;
+            double vr;
+            double logOdds;
+            double logModeTerms; // log(m!) + log((n - m)!) for the mode m
+            unsigned long int mode;
+
+            unsigned long int sampleInversion(PhiloxRandom &rng) const;
+            unsigned long int sampleRejection(PhiloxRandom &rng) const;
+        public:
+            BinomialSampler(unsigned long int n, double p);
+
+            unsigned long int operator()(PhiloxRandom &rng) const;
+            void sample(PhiloxRandom &rng, unsigned long int *out, size_t count) const;
+    };
+
+    unsigned long int sampleBinomial(PhiloxRandom &rng, unsigned long int n, double p);
+    void sampleMultinomial(PhiloxRandom &rng, unsigned long int n, const double *p, unsigned long int *out, size_t k);
+    std::vector<unsigned long int> sampleMultinomial(PhiloxRandom &rng, unsigned long int n, const std::vector<double> &p);
+
+    const unsigned int MAX_PERMUTATION_LENGTH = 20; // Longest length whose permutation count fits an unsigned long int
+
+    // Every permutation of 1 to `n` in lexicographic order, generated on demand instead of stored. Permutations are addressed
+    // by rank through their Lehmer code, so the order can be split into rank ranges and enumerated from any point.
     class TotalPermutations {
         private:
             unsigned int n;
-            std::vector<std::vector<unsigned int>> p;
+            unsigned long int total; // n!
+
+            template <typename W> void writeRange(unsigned long int first, unsigned long int last, W sink) const;
         public:
+            class iterator {
+                private:
+                    unsigned long int r;
+                    std::vector<unsigned int> current;
+                public:
+                    iterator(unsigned long int r, std::vector<unsigned int> current);
+                    const std::vector<unsigned int> &operator*() const;
+                    const std::vector<unsigned int> *operator->() const;
+                    unsigned long int rank() const;
+                    iterator &operator++();
+                    bool operator==(const iterator &other) const;
+                    bool operator!=(const iterator &other) const;
+            };
+
             TotalPermutations(unsigned int n);
+
+            unsigned int getLength() const;
+            unsigned long int size() const;
+            std::vector<unsigned int> unrank(unsigned long int r) const;
+            unsigned long int rank(const std::vector<unsigned int> &perm) const;
+
+            iterator begin() const;
+            iterator end() const;
+            iterator at(unsigned long int r) const;
+            std::vector<std::pair<unsigned long int, unsigned long int>> split(unsigned long int parts) const;
+            template <typename F> void forEach(F f, unsigned int threads = 0) const;
+
+            void writePermutations(std::ostream &os, unsigned long int first, unsigned long int last) const;
+            void writePermutations(int fd, unsigned long int first, unsigned long int last) const;
+            void writePermutationSummary(std::ostream &os) const;
+            void writePermutationSummary(int fd) const;
             std::string getPermutationSummary();
     };
+
+    // Call `f(rank, permutation)` for every permutation across `threads` threads, each walking its own range of ranks.
+    template <typename F> void TotalPermutations::forEach(F f, unsigned int threads) const {
+        std::vector<std::pair<unsigned long int, unsigned long int>> ranges;
+
+        ranges = (*this).split(8 * (unsigned long int) resolveThreadCount(threads));
+
+        parallelFor(ranges.size(), threads, [&](size_t t) {
+            iterator it = (*this).at(ranges[t].first);
+
+            for (; it.rank() < ranges[t].second; ++it) {
+                f(it.rank(), *it);
+            }
+        });
+    }
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,54 @@
+#ifndef FMINDEX_HPP
+#define FMINDEX_HPP 1
+
+#include "fundamentals.hpp"
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace bioinfo {
+    const unsigned int FM_INDEX_SAMPLE_RATE = 32;
+
+    struct IndexHit {
+        unsigned int sequence = 0; // Index of the sequence in the indexed collection
+        unsigned long int position = 0; // Index in that sequence where the motif starts
+    } typedef IndexHit;
+
+    class FMIndex {
+        private:
+            // Rank directory for 64 BWT rows: how many of each base come before the block, and which rows hold each base
+            struct OccBlock {
+                uint32_t counts[4];
+                uint64_t bits[4];
+            };
+
+            std::vector<std::string> headers;
+            std::vector<uint64_t> starts; // Offset of the first base of every sequence in the concatenated text
+            uint64_t length; // Length of the concatenated text, separators and the final sentinel included
+            unsigned int sampleRate;
+            uint64_t firstRow[6]; // First BWT row of the suffixes starting with each symbol
+            std::vector<OccBlock> occ;
+            std::vector<uint64_t> sampledBits; // Bit i set when the text position of row i is kept in `samples`
+            std::vector<uint32_t> sampledRanks; // Set bits of sampledBits before every word
+            std::vector<uint32_t> samples; // Text positions of the sampled rows in row order
+
+            void build(const std::vector<SequenceView> &seqs, unsigned int threads);
+            uint64_t rank(unsigned int c, uint64_t row) const;
+            bool findRows(SequenceView motif, uint64_t &lo, uint64_t &hi) const;
+            uint64_t textPosition(uint64_t row) const;
+        public:
+            FMIndex(DNAString &ds, unsigned int sampleRate = FM_INDEX_SAMPLE_RATE, unsigned int threads = 0);
+            FMIndex(std::vector<DNAString> &vec, unsigned int sampleRate = FM_INDEX_SAMPLE_RATE, unsigned int threads = 0);
+            FMIndex(const std::string &fn);
+
+            void writeIndex(const std::string &fn) const;
+
+            unsigned int getSequenceCount() const;
+            const std::string &getHeader(unsigned int i) const;
+
+            unsigned long int count(SequenceView motif) const;
+            std::vector<IndexHit> locate(SequenceView motif) const;
+    };
+}
+
+#endif
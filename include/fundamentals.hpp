@@ -1,10 +1,13 @@
 #ifndef FUNDAMENTALS_HPP
 #define FUNDAMENTALS_HPP 1
 
+#include "packed.hpp"
 #include <string>
 #include <iostream>
 #include <unordered_map>
 #include <vector>
+#include <cstddef>
+#include <stdexcept>
 
 namespace bioinfo {
     typedef std::unordered_map<std::string, char> AATable;
@@ -45,37 +48,117 @@ namespace bioinfo {
         };
     };
 
+    // Read-only window into a sequence stored somewhere else (a std::string, a batch buffer or a mapped file). A view never
+    // owns or allocates, so it is only valid as long as the storage it points into is alive and unchanged.
+    class SequenceView {
+        private:
+            const char *start;
+            size_t count;
+        public:
+            SequenceView() : start(NULL), count(0) {}
+            SequenceView(const char *p, size_t n) : start(p), count(n) {}
+            SequenceView(const std::string &s) : start(s.data()), count(s.length()) {}
+
+            const char *data() const { return start; }
+            size_t length() const { return count; }
+            bool empty() const { return count == 0; }
+            const char *begin() const { return start; }
+            const char *end() const { return start + count; }
+            char operator[](size_t i) const { return start[i]; }
+
+            char at(size_t i) const {
+                if (i >= count) {
+                    throw std::out_of_range("ERROR: SequenceView index is out of range!");
+                }
+
+                return start[i];
+            }
+
+            // Get the view of up to `n` characters starting at `pos`, without copying them
+            SequenceView subsequence(size_t pos, size_t n = std::string::npos) const {
+                if (pos > count) {
+                    throw std::out_of_range("ERROR: SequenceView subsequence starts past the end!");
+                }
+
+                return SequenceView(start + pos, n < count - pos ? n : count - pos);
+            }
+
+            std::string toString() const { return std::string(start, count); }
+
+            bool operator==(const SequenceView &other) const {
+                return count == other.count && std::char_traits<char>::compare(start, other.start, count) == 0;
+            }
+
+            bool operator!=(const SequenceView &other) const { return !(*this == other); }
+    };
+
+    class CodonTable {
+        private:
+            char aminoAcids[64]; // Codon index (first base * 16 + second base * 4 + third base) to amino acid
+        public:
+            CodonTable(const AATable &code);
+
+            char translateCodon(unsigned int index) const;
+            std::string translate(const std::string &s) const;
+            std::vector<std::string> translateSixFrames(const std::string &s) const;
+    };
+
     class DNAString {
         private:
             std::string header;
-            std::string sequence;
+            std::string sequence; // Bases when unpacked, a cache of the unpacked bases when packed
+            PackedSequence packedSequence;
+            bool packed;
             unsigned int sequenceLength;
+
+            friend class RNAString;
         public:
             DNAString();
             DNAString(std::string h, std::string s);
-            std::string getHeader();
-            std::string getSequence();            
+            DNAString(std::string h, PackedSequence ps);
+            const std::string &getHeader();
+            const std::string &getSequence();
+            SequenceView getSequenceView();
             void setHeader(std::string h);
             void setSequence(std::string s);
 
             unsigned int getSequenceLength();
+
+            void pack();
+            void unpack();
+            bool isPacked();
+            const PackedSequence &getPackedSequence();
+
+            void reverseComplementInPlace();
     };
 
     class RNAString {
         private:
             std::string header;
-            std::string sequence;
+            std::string sequence; // Bases when unpacked, a cache of the unpacked bases when packed
+            PackedSequence packedSequence;
+            bool packed;
             unsigned int sequenceLength;
         public:
             RNAString();
             RNAString(std::string h, std::string s);
+            RNAString(std::string h, PackedSequence ps);
             RNAString(DNAString &ds);
-            std::string getHeader();
-            std::string getSequence();            
+            RNAString(DNAString &&ds);
+            const std::string &getHeader();
+            const std::string &getSequence();
+            SequenceView getSequenceView();
             void setHeader(std::string h);
             void setSequence(std::string s);
 
             unsigned int getSequenceLength();
+
+            void pack();
+            void unpack();
+            bool isPacked();
+            const PackedSequence &getPackedSequence();
+
+            void reverseComplementInPlace();
     };
 
     class AAString {
@@ -88,8 +171,9 @@ namespace bioinfo {
             AAString(DNAString &ds, const AATable &code);
             AAString(RNAString &rs, const AATable &code);
 
-            std::string getHeader();
-            std::string getSequence();            
+            const std::string &getHeader();
+            const std::string &getSequence();
+            SequenceView getSequenceView();
             void setHeader(std::string h);
             void setSequence(std::string s, const AATable &code);
 
@@ -98,11 +182,17 @@ namespace bioinfo {
 
     std::string toUpper(std::string s);
     std::string transcribe(std::string s);
+    void toUpperInPlace(std::string &s);
+    void toUpperInPlace(char *p, size_t n);
+    void transcribeInPlace(std::string &s);
+    void reverseComplementInPlace(std::string &s);
     std::string translate(std::string s, const AATable &code);
+    std::vector<std::string> translateSixFrames(DNAString &ds, const CodonTable &ct);
     DNAString reverseComplement(DNAString &ds);
 
     std::vector<DNAString> readDNAStringFile(std::string &fn);
     std::vector<DNAString> readDNAStringFile(const char *fnp);
+    std::vector<DNAString> readDNAStringFile(std::string &fn, unsigned int threads);
 };
 
 #endif // FUNDAMENTALS_HPP
\ No newline at end of file
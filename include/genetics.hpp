@@ -1,9 +1,11 @@
 #ifndef GENETICS_HPP
 #define GENETICS_HPP 1
 
-#include <unordered_map>
+#include "biomath.hpp"
 #include <limits.h>
 #include <stdexcept>
+#include <vector>
+#include <cstdint>
 
 namespace bioinfo {
     struct MendelianInheritanceStatistics {
@@ -19,22 +21,49 @@ namespace bioinfo {
         unsigned int hr = 0; // Aa-aa mating
         unsigned int rr = 0; // aa-aa mating
     } typedef GenotypesCount;
+
+    struct PopulationGenotypes {
+        unsigned long int dominant = 0; // AA individuals
+        unsigned long int heterozygous = 0; // Aa individuals
+        unsigned long int recessive = 0; // aa individuals
+    } typedef PopulationGenotypes;
+
+    // Forces acting on a Wright-Fisher population between generations.
+    struct PopulationModel {
+        unsigned long int size = 0; // Individuals in every new generation, 0 keeps the size of the starting population
+        double dominantFitness = 1.0; // Relative chance of an AA individual to reproduce
+        double heterozygousFitness = 1.0;
+        double recessiveFitness = 1.0;
+        double dominantMutation = 0.0; // Chance an A allele mutates to a in a gamete
+        double recessiveMutation = 0.0; // Chance an a allele mutates to A in a gamete
+    } typedef PopulationModel;
     
     MendelianInheritanceStatistics mendelianInheritance(unsigned int k, unsigned int m, unsigned int n);
     double calculateExpectedOffspring(GenotypesCount mg, unsigned int n);
     double tomsIndependentAlleles(unsigned int k, unsigned long int n);
 
+    std::vector<PopulationGenotypes> simulateOffspring(GenotypesCount mg, unsigned int n, unsigned int replicates,
+                                                       uint64_t seed, unsigned int threads = 0);
+    std::vector<PopulationGenotypes> wrightFisher(PopulationGenotypes start, const PopulationModel &model,
+                                                  unsigned int generations, unsigned int replicates, uint64_t seed,
+                                                  unsigned int threads = 0);
+    std::vector<std::vector<PopulationGenotypes>> wrightFisherTrajectories(PopulationGenotypes start,
+                                                                           const PopulationModel &model,
+                                                                           unsigned int generations,
+                                                                           unsigned int replicates, uint64_t seed,
+                                                                           unsigned int threads = 0);
+
     class WascallyWabbits {
         private:
             unsigned int rabbitPairs = 0;
-            unsigned int lifespan = 0;
-            std::unordered_map<unsigned int, unsigned long int> timeline;
-            unsigned long int fibonacci(unsigned int n);
-            unsigned long int MortalFibonacci(unsigned int n, unsigned int m);
         public:
             WascallyWabbits(unsigned int k);
             unsigned long int simulate(unsigned int n);
+            unsigned long int simulate(unsigned int n, unsigned long int modulus);
+            BigUnsigned simulateBig(unsigned int n);
             unsigned long int simulateMortal(unsigned int n, unsigned int m);
+            unsigned long int simulateMortal(unsigned int n, unsigned int m, unsigned long int modulus);
+            BigUnsigned simulateMortalBig(unsigned int n, unsigned int m);
     };
 }
 
@@ -0,0 +1,56 @@
+#ifndef GRAPH_HPP
+#define GRAPH_HPP 1
+
+#include "fundamentals.hpp"
+#include "analysis.hpp"
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace bioinfo {
+    // Directed graph with integer node IDs and compressed sparse row adjacency. The out-edges of node i are
+    // outTargets[outOffsets[i], outOffsets[i + 1]) and its in-edges are the same in inSources, so both directions are walked
+    // without hashing any label.
+    class CompactGraph {
+        private:
+            std::vector<std::string> labels; // Header or k-mer of every node
+            std::vector<unsigned long int> weights; // Coverage of every node, 1 when the graph has none
+            std::vector<size_t> outOffsets;
+            std::vector<unsigned int> outTargets;
+            std::vector<size_t> inOffsets;
+            std::vector<unsigned int> inSources;
+            unsigned int overlap; // Characters the labels of neighbouring nodes share, 0 when labels do not spell a sequence
+
+            CompactGraph();
+            void buildInEdges();
+
+            friend CompactGraph deBruijnGraph(std::vector<DNAString> &vec, unsigned int k, unsigned long int minCount,
+                                              unsigned int threads);
+        public:
+            CompactGraph(std::vector<std::string> labels, const std::vector<std::pair<unsigned int, unsigned int>> &edges,
+                         unsigned int overlap = 0);
+            CompactGraph(const AdjacencyList &al);
+
+            size_t getNodeCount() const;
+            size_t getEdgeCount() const;
+            unsigned int getOverlap() const;
+            const std::string &getLabel(unsigned int i) const;
+            unsigned long int getWeight(unsigned int i) const;
+
+            unsigned int getOutDegree(unsigned int i) const;
+            unsigned int getInDegree(unsigned int i) const;
+            unsigned int getOutNeighbour(unsigned int i, unsigned int j) const;
+            unsigned int getInNeighbour(unsigned int i, unsigned int j) const;
+
+            std::vector<std::vector<unsigned int>> unitigs(unsigned int threads = 0) const;
+            std::string spellPath(const std::vector<unsigned int> &path) const;
+    };
+
+    CompactGraph deBruijnGraph(std::vector<DNAString> &vec, unsigned int k, unsigned long int minCount = 1,
+                               unsigned int threads = 0);
+    std::vector<DNAString> compactUnitigs(const CompactGraph &g, unsigned int threads = 0);
+    std::vector<DNAString> greedyAssemble(const CompactGraph &g, unsigned int threads = 0);
+}
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef MOTIF_HPP
+#define MOTIF_HPP 1
+
+#include "fundamentals.hpp"
+#include <string>
+#include <vector>
+
+namespace bioinfo {
+    struct MotifHit {
+        unsigned int pattern = 0; // Index of the pattern in the matcher dictionary
+        unsigned int position = 0; // Index in the sequence where the pattern starts
+    } typedef MotifHit;
+
+    // Distance used by the approximate motif search
+    enum class MotifDistance {
+        HAMMING, // Substitutions only, hits are reported by their start index
+        EDIT // Substitutions, insertions and deletions, hits are reported by the index of their last base
+    };
+
+    struct ApproximateMotifHit {
+        unsigned int position = 0;
+        unsigned int distance = 0;
+    } typedef ApproximateMotifHit;
+
+    class MotifMatcher {
+        private:
+            std::vector<std::string> patterns;
+            std::vector<unsigned int> symbols; // Byte to symbol class, 0 for bytes that appear in no pattern
+            unsigned int symbolCount;
+            std::vector<unsigned int> transitions; // state * symbolCount + symbol to next state
+            std::vector<unsigned int> outputStart; // Patterns ending at a state are outputIds[outputStart[s], outputStart[s + 1])
+            std::vector<unsigned int> outputIds;
+            std::vector<unsigned int> dictionaryLinks; // Nearest proper suffix state that ends a pattern, 0 if none
+
+            void compile();
+            template <typename F> void scan(SequenceView s, F report) const;
+        public:
+            MotifMatcher(const std::vector<std::string> &patterns);
+            MotifMatcher(std::vector<DNAString> &motifs);
+            MotifMatcher(std::vector<RNAString> &motifs);
+
+            unsigned int getPatternCount() const;
+            const std::string &getPattern(unsigned int i) const;
+
+            std::vector<MotifHit> findAll(SequenceView s, bool overlap) const;
+            std::vector<MotifHit> findAll(DNAString &ds, bool overlap) const;
+            std::vector<MotifHit> findAll(RNAString &rs, bool overlap) const;
+            std::vector<std::vector<unsigned int>> findPositions(SequenceView s, bool overlap) const;
+            std::vector<long int> findFirst(SequenceView s) const;
+    };
+
+    std::vector<ApproximateMotifHit> approximateMotif(SequenceView s, SequenceView motif, unsigned int k, bool overlap,
+                                                      MotifDistance mode);
+    std::vector<ApproximateMotifHit> approximateDNAStringMotif(DNAString &ds, DNAString &motif, unsigned int k, bool overlap,
+                                                               MotifDistance mode = MotifDistance::HAMMING);
+}
+
+#endif
\ No newline at end of file
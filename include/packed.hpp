@@ -0,0 +1,47 @@
+#ifndef PACKED_HPP
+#define PACKED_HPP 1
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace bioinfo {
+    // 2-bit nucleotide codes, T and U share a code so DNA and RNA pack to the same words
+    namespace NucleotideCodes {
+        const unsigned char A = 0;
+        const unsigned char C = 1;
+        const unsigned char G = 2;
+        const unsigned char T = 3;
+        const unsigned int BASES_PER_WORD = 32;
+        const unsigned int BASES_PER_MASK_WORD = 64;
+    };
+
+    class PackedSequence {
+        private:
+            std::vector<uint64_t> words; // 32 bases per word, base i stored in bits 2 * (i % 32)
+            std::vector<uint64_t> mask; // 1 bit per base, set when the base is not A, C, G or T/U
+            std::string ambiguityCodes; // Original characters of the masked bases in sequence order
+            unsigned int length;
+        public:
+            PackedSequence();
+            PackedSequence(const std::string &s);
+
+            std::string unpack(char t) const;
+            unsigned char codeAt(unsigned int i) const;
+            bool isAmbiguous(unsigned int i) const;
+            unsigned int ambiguityRank(unsigned int i) const;
+
+            unsigned int getLength() const;
+            const std::vector<uint64_t> &getWords() const;
+            const std::vector<uint64_t> &getMask() const;
+            const std::string &getAmbiguityCodes() const;
+            bool hasAmbiguity() const;
+
+            PackedSequence reverseComplement() const;
+    };
+
+    unsigned int hammingDistance(const PackedSequence &s, const PackedSequence &t);
+    std::vector<unsigned int> exactPackedMotif(const PackedSequence &ps, const PackedSequence &motif, bool overlap);
+}
+
+#endif
\ No newline at end of file
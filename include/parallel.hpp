@@ -0,0 +1,66 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP 1
+
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <exception>
+#include <algorithm>
+#include <cstddef>
+
+namespace bioinfo {
+    // Resolve a requested thread count, where 0 means one thread per hardware core.
+    inline unsigned int resolveThreadCount(unsigned int threads) {
+        if (threads == 0) {
+            threads = std::thread::hardware_concurrency();
+        }
+
+        return threads == 0 ? 1 : threads;
+    }
+
+    // Call `f(i)` for every `i` in [0, `count`) across `threads` worker threads. Items are handed out one at a time so uneven
+    // work still balances, and the first exception thrown by a worker is rethrown once every thread has joined.
+    template <typename F> void parallelFor(size_t count, unsigned int threads, F f) {
+        std::vector<std::thread> pool;
+        std::atomic<size_t> nextItem(0);
+        std::exception_ptr error = nullptr;
+        std::atomic<bool> failed(false);
+        unsigned int t;
+
+        threads = std::min<size_t>(resolveThreadCount(threads), count);
+
+        if (threads <= 1) {
+            for (size_t i = 0; i < count; ++i) {
+                f(i);
+            }
+
+            return;
+        }
+
+        for (t = 0; t < threads; ++t) {
+            pool.emplace_back([&]() {
+                size_t i;
+
+                while (!failed && (i = nextItem++) < count) {
+                    try {
+                        f(i);
+                    } catch (...) {
+                        if (!failed.exchange(true)) {
+                            error = std::current_exception();
+                        }
+                    }
+                }
+            });
+        }
+
+        for (t = 0; t < threads; ++t) {
+            pool[t].join();
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+#endif
\ No newline at end of file
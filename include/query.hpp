@@ -2,12 +2,124 @@
 #define QUERY_HPP 1
 
 #include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
 #include <fundamentals.hpp>
 
-#define UNIPROT_URL "http://www.uniprot.org/uniprot/"
+// UniProt answers plain http:// with a redirect to https://, which the client reports as an error since it has no TLS, so
+// pass an http:// mirror or proxy as the base URL to reach it
+#define UNIPROT_URL "http://rest.uniprot.org/uniprotkb/"
 
 namespace bioinfo {
-    std::vector<AAString> queryUniProt(std::vector<std::string> &vec);
+    // Parts of an http:// URL
+    struct URL {
+        std::string host;
+        unsigned short port = 80;
+        std::string path = "/"; // Always starts with '/'
+    } typedef URL;
+
+    struct HTTPResponse {
+        int status = 0;
+        std::unordered_map<std::string, std::string> headers; // Header names in lower case
+        std::string body;
+    } typedef HTTPResponse;
+
+    // Plain HTTP/1.1 GET client over POSIX sockets that keeps at most `maxConnections` keep-alive connections to one host.
+    // Callers past the limit wait for a connection to be released, so any number of threads can share one client.
+    class HTTPClient {
+        private:
+            std::string host;
+            unsigned short port;
+            unsigned int maxConnections;
+            int timeoutMs;
+            std::mutex lock;
+            std::condition_variable released;
+            std::vector<int> idle; // Open connections nobody is using
+            unsigned int open; // Connections idle or in use
+
+            int connectSocket();
+            int acquire(bool &reused);
+            void release(int fd, bool keep);
+        public:
+            HTTPClient(const std::string &host, unsigned short port = 80, unsigned int maxConnections = 4,
+                       int timeoutMs = 30000);
+            HTTPClient(const HTTPClient &) = delete;
+            HTTPClient &operator=(const HTTPClient &) = delete;
+            ~HTTPClient();
+
+            HTTPResponse get(const std::string &path);
+    };
+
+    URL parseURL(const std::string &url);
+    std::string httpGet(const std::string &host, const std::string &path);
+    std::vector<AAString> parseFASTA(const std::string &text);
+
+    struct UniProtOptions {
+        std::string baseURL = UNIPROT_URL; // Requests go to baseURL + "accessions?accessions=...&format=fasta"
+        std::string cacheDir; // Directory of cached entries, one <accession>.fasta file each, empty for no cache
+        unsigned int batchSize = 100; // Accessions per request
+        unsigned int connections = 4; // Requests in flight at once
+        unsigned int retries = 3; // Extra attempts after a failed request
+        unsigned int backoffMs = 250; // Wait before the first retry, doubled before every later one
+        int timeoutMs = 30000; // Socket send and receive timeout
+    } typedef UniProtOptions;
+
+    // Resolves UniProt accessions to protein sequences. Accessions missing from the cache are grouped into multi-accession
+    // requests that run concurrently on a bounded connection pool, and server errors are retried with exponential backoff.
+    class UniProtClient {
+        private:
+            UniProtOptions options;
+            URL base;
+            HTTPClient http;
+
+            std::string cachePath(const std::string &accession) const;
+            bool readCache(const std::string &accession, std::string &entry) const;
+            void writeCache(const std::string &accession, const std::string &entry) const;
+            std::string request(const std::vector<std::string> &accessions, size_t first, size_t last);
+        public:
+            UniProtClient(const UniProtOptions &options = UniProtOptions());
+
+            std::vector<AAString> fetch(const std::vector<std::string> &accessions);
+    };
+
+    // Minimal HTTP server on 127.0.0.1 that answers UniProt accession queries from entries held in memory, so clients can
+    // be exercised without the network. It can be told to fail requests to exercise retries.
+    class LocalUniProtServer {
+        private:
+            std::unordered_map<std::string, std::string> entries; // Accession to its FASTA record
+            int listenFd;
+            unsigned short port;
+            std::thread acceptThread;
+            std::vector<std::thread> connectionThreads;
+            std::vector<int> connectionFds;
+            std::mutex lock;
+            std::atomic<bool> running;
+            std::atomic<unsigned long int> requests;
+            std::atomic<unsigned int> failures; // Requests still to be answered with 503
+
+            void acceptLoop();
+            void serve(int fd);
+            std::string answer(const std::string &target, int &status);
+        public:
+            LocalUniProtServer();
+            LocalUniProtServer(const LocalUniProtServer &) = delete;
+            LocalUniProtServer &operator=(const LocalUniProtServer &) = delete;
+            ~LocalUniProtServer();
+
+            void addEntry(const std::string &accession, const std::string &header, const std::string &sequence);
+            void start();
+            void stop();
+            void failNext(unsigned int n);
+
+            std::string getURL() const;
+            unsigned long int getRequestCount() const;
+    };
+
+    std::vector<AAString> queryUniProt(std::vector<std::string> &vec, const std::string &baseURL = UNIPROT_URL);
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,114 @@
+#ifndef SEQIO_HPP
+#define SEQIO_HPP 1
+
+#include "fundamentals.hpp"
+#include "batch.hpp"
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+
+namespace bioinfo {
+    const size_t FASTA_BLOCK_SIZE = 1 << 20;
+
+    // One line of a samtools compatible .fai index
+    struct FASTAIndexEntry {
+        std::string name;
+        unsigned long int length = 0; // Number of bases in the sequence
+        unsigned long int offset = 0; // Byte offset of the first base in the file
+        unsigned long int lineBases = 0; // Bases per full line
+        unsigned long int lineWidth = 0; // Bytes per full line, including the line ending
+    };
+
+    // One 4-line FASTQ record
+    struct FASTQRecord {
+        DNAString read;
+        std::string quality;
+    } typedef FASTQRecord;
+
+    class FASTAReader {
+        private:
+            std::FILE *file;
+            std::vector<char> buffer;
+            size_t bufferPos;
+            size_t bufferEnd;
+            std::string recordHeader; // Reused between records appended to a SequenceBatch
+            std::string recordSequence;
+
+            bool fillBuffer();
+            int peekChar();
+            void appendLine(std::string &s);
+            void skipLine();
+            bool readRecord(std::string &h, std::string &s);
+        public:
+            class iterator {
+                private:
+                    FASTAReader *reader;
+                    DNAString current;
+                public:
+                    iterator();
+                    iterator(FASTAReader *r);
+                    DNAString &operator*();
+                    DNAString *operator->();
+                    iterator &operator++();
+                    bool operator==(const iterator &other) const;
+                    bool operator!=(const iterator &other) const;
+            };
+
+            FASTAReader(const std::string &fn, size_t blockSize = FASTA_BLOCK_SIZE);
+            FASTAReader(const FASTAReader &) = delete;
+            FASTAReader &operator=(const FASTAReader &) = delete;
+            ~FASTAReader();
+
+            bool next(DNAString &ds);
+            size_t nextBatch(std::vector<DNAString> &batch, size_t n);
+            size_t nextBatch(SequenceBatch &batch, size_t n, size_t maxBases = SIZE_MAX);
+
+            iterator begin();
+            iterator end();
+    };
+
+    class MappedFile {
+        private:
+            int fd;
+            const char *data;
+            size_t size;
+        public:
+            MappedFile(const std::string &fn);
+            MappedFile(const MappedFile &) = delete;
+            MappedFile &operator=(const MappedFile &) = delete;
+            ~MappedFile();
+
+            const char *getData() const;
+            size_t getSize() const;
+    };
+
+    class IndexedFASTA {
+        private:
+            MappedFile file;
+            std::vector<FASTAIndexEntry> entries;
+            std::unordered_map<std::string, size_t> lookup;
+
+            void buildIndex();
+            bool loadIndex(const std::string &fn);
+            const FASTAIndexEntry &getEntry(const std::string &name) const;
+        public:
+            IndexedFASTA(const std::string &fn);
+            IndexedFASTA(const std::string &fn, const std::string &indexFn);
+
+            void writeIndex(const std::string &indexFn) const;
+            const std::vector<FASTAIndexEntry> &getEntries() const;
+            bool hasSequence(const std::string &name) const;
+
+            std::string fetchSequence(const std::string &name, unsigned long int start, unsigned long int end) const;
+            DNAString fetch(const std::string &name, unsigned long int start, unsigned long int end) const;
+            DNAString fetch(const std::string &region) const;
+    };
+
+    std::vector<DNAString> readFASTAFileParallel(const std::string &fn, unsigned int threads);
+    std::vector<FASTQRecord> readFASTQFile(const std::string &fn, unsigned int threads);
+}
+
+#endif
\ No newline at end of file
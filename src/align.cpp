@@ -0,0 +1,778 @@
+#include <align.hpp>
+#include <fundamentals.hpp>
+#include <batch.hpp>
+#include <parallel.hpp>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include <climits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BIOINFO_X86_KERNELS 1
+#endif
+
+namespace bioinfo {
+    const int SCORE_NEG_INF = INT_MIN / 4; // Low enough to never win, high enough that subtracting a gap cannot wrap
+    const size_t ALIGN_TASK_TARGETS = 16; // Targets aligned by one task of a batch
+
+    // Traceback bits of one cell: where H came from, and whether E and F extended a gap or opened one
+    const unsigned char TRACE_DIAGONAL = 0;
+    const unsigned char TRACE_E = 1;
+    const unsigned char TRACE_F = 2;
+    const unsigned char TRACE_ZERO = 3;
+    const unsigned char TRACE_SOURCE = 3;
+    const unsigned char TRACE_E_EXTEND = 4;
+    const unsigned char TRACE_F_EXTEND = 8;
+
+    // NCBI BLOSUM62 over its 24 letter alphabet, with X as the wildcard moved last so unknown residues score as X
+    static const char BLOSUM62_ALPHABET[] = "ARNDCQEGHILKMFPSTWYVBZ*X";
+    static const int BLOSUM62[24][24] = {
+        //A  R  N  D  C  Q  E  G  H  I  L  K  M  F  P  S  T  W  Y  V  B  Z  *  X
+        { 4,-1,-2,-2, 0,-1,-1, 0,-2,-1,-1,-1,-1,-2,-1, 1, 0,-3,-2, 0,-2,-1,-4, 0}, // A
+        {-1, 5, 0,-2,-3, 1, 0,-2, 0,-3,-2, 2,-1,-3,-2,-1,-1,-3,-2,-3,-1, 0,-4,-1}, // R
+        {-2, 0, 6, 1,-3, 0, 0, 0, 1,-3,-3, 0,-2,-3,-2, 1, 0,-4,-2,-3, 3, 0,-4,-1}, // N
+        {-2,-2, 1, 6,-3, 0, 2,-1,-1,-3,-4,-1,-3,-3,-1, 0,-1,-4,-3,-3, 4, 1,-4,-1}, // D
+        { 0,-3,-3,-3, 9,-3,-4,-3,-3,-1,-1,-3,-1,-2,-3,-1,-1,-2,-2,-1,-3,-3,-4,-2}, // C
+        {-1, 1, 0, 0,-3, 5, 2,-2, 0,-3,-2, 1, 0,-3,-1, 0,-1,-2,-1,-2, 0, 3,-4,-1}, // Q
+        {-1, 0, 0, 2,-4, 2, 5,-2, 0,-3,-3, 1,-2,-3,-1, 0,-1,-3,-2,-2, 1, 4,-4,-1}, // E
+        { 0,-2, 0,-1,-3,-2,-2, 6,-2,-4,-4,-2,-3,-3,-2, 0,-2,-2,-3,-3,-1,-2,-4,-1}, // G
+        {-2, 0, 1,-1,-3, 0, 0,-2, 8,-3,-3,-1,-2,-1,-2,-1,-2,-2, 2,-3, 0, 0,-4,-1}, // H
+        {-1,-3,-3,-3,-1,-3,-3,-4,-3, 4, 2,-3, 1, 0,-3,-2,-1,-3,-1, 3,-3,-3,-4,-1}, // I
+        {-1,-2,-3,-4,-1,-2,-3,-4,-3, 2, 4,-2, 2, 0,-3,-2,-1,-2,-1, 1,-4,-3,-4,-1}, // L
+        {-1, 2, 0,-1,-3, 1, 1,-2,-1,-3,-2, 5,-1,-3,-1, 0,-1,-3,-2,-2, 0, 1,-4,-1}, // K
+        {-1,-1,-2,-3,-1, 0,-2,-3,-2, 1, 2,-1, 5, 0,-2,-1,-1,-1,-1, 1,-3,-1,-4,-1}, // M
+        {-2,-3,-3,-3,-2,-3,-3,-3,-1, 0, 0,-3, 0, 6,-4,-2,-2, 1, 3,-1,-3,-3,-4,-1}, // F
+        {-1,-2,-2,-1,-3,-1,-1,-2,-2,-3,-3,-1,-2,-4, 7,-1,-1,-4,-3,-2,-2,-1,-4,-2}, // P
+        { 1,-1, 1, 0,-1, 0, 0, 0,-1,-2,-2, 0,-1,-2,-1, 4, 1,-3,-2,-2, 0, 0,-4, 0}, // S
+        { 0,-1, 0,-1,-1,-1,-1,-2,-2,-1,-1,-1,-1,-2,-1, 1, 5,-2,-2, 0,-1,-1,-4, 0}, // T
+        {-3,-3,-4,-4,-2,-2,-3,-2,-2,-3,-2,-3,-1, 1,-4,-3,-2,11, 2,-3,-4,-3,-4,-2}, // W
+        {-2,-2,-2,-3,-2,-1,-2,-3, 2,-1,-1,-2,-1, 3,-3,-2,-2, 2, 7,-1,-3,-2,-4,-1}, // Y
+        { 0,-3,-3,-3,-1,-2,-2,-3,-3, 3, 1,-2, 1,-1,-2,-2, 0,-3,-1, 4,-3,-2,-4,-1}, // V
+        {-2,-1, 3, 4,-3, 0, 1,-1, 0,-3,-4, 0,-3,-3,-2, 0,-1,-4,-3,-3, 4, 1,-4,-1}, // B
+        {-1, 0, 0, 1,-3, 3, 4,-2, 0,-3,-3, 1,-1,-3,-1, 0,-1,-3,-2,-2, 1, 4,-4,-1}, // Z
+        {-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4,-4, 1,-4}, // *
+        { 0,-1,-1,-1,-2,-1,-1,-1,-1,-1,-1,-1,-1,-1,-2, 0, 0,-2,-1,-1,-1,-1,-4,-1}  // X
+    };
+
+    // Create a scoring matrix over `alphabet` from its row major `scores`. The last letter of the alphabet is the wildcard.
+    ScoringMatrix::ScoringMatrix(const std::string &alphabet, const std::vector<int> &scores) {
+        unsigned int c;
+        unsigned int i;
+
+        if (alphabet.empty() || alphabet.length() > 255) {
+            throw std::invalid_argument("ERROR: Scoring matrix alphabet must have between 1 and 255 letters!");
+        } else if (scores.size() != alphabet.length() * alphabet.length()) {
+            throw std::invalid_argument("ERROR: Scoring matrix needs a score for every pair of letters!");
+        }
+
+        (*this).alphabet = toUpper(alphabet);
+        (*this).scores = scores;
+        (*this).maxScore = *std::max_element(scores.begin(), scores.end());
+        (*this).minScore = *std::min_element(scores.begin(), scores.end());
+
+        for (c = 0; c < 256; ++c) {
+            (*this).codes[c] = alphabet.length() - 1;
+        }
+
+        for (i = alphabet.length(); i-- > 0;) {
+            c = (unsigned char) (*this).alphabet[i];
+            (*this).codes[c] = i;
+
+            if (c >= 'A' && c <= 'Z') {
+                (*this).codes[c | 0x20] = i;
+            }
+        }
+
+        if ((*this).alphabet.find('T') != std::string::npos && (*this).alphabet.find('U') == std::string::npos) {
+            (*this).codes['U'] = (*this).codes['T'];
+            (*this).codes['u'] = (*this).codes['T'];
+        }
+    }
+
+    // Get the letters of the matrix, the wildcard last
+    const std::string &ScoringMatrix::getAlphabet() const {
+        return (*this).alphabet;
+    }
+
+    // Get how many letters are in the alphabet
+    unsigned int ScoringMatrix::size() const {
+        return (*this).alphabet.length();
+    }
+
+    // Get the index of `c` in the alphabet
+    unsigned char ScoringMatrix::code(char c) const {
+        return (*this).codes[(unsigned char) c];
+    }
+
+    // Get the score of the letters with indices `a` and `b`
+    int ScoringMatrix::score(unsigned char a, unsigned char b) const {
+        return (*this).scores[a * (*this).size() + b];
+    }
+
+    // Get the score of aligning the characters `a` and `b`
+    int ScoringMatrix::score(char a, char b) const {
+        return (*this).score((*this).code(a), (*this).code(b));
+    }
+
+    // Get the highest score in the matrix
+    int ScoringMatrix::getMaxScore() const {
+        return (*this).maxScore;
+    }
+
+    // Get the lowest score in the matrix
+    int ScoringMatrix::getMinScore() const {
+        return (*this).minScore;
+    }
+
+    // Get the matrix scoring `match` for equal nucleotides and `mismatch` otherwise. N is the wildcard and never matches.
+    ScoringMatrix nucleotideMatrix(int match, int mismatch) {
+        const std::string alphabet = "ACGTN";
+        std::vector<int> scores(alphabet.length() * alphabet.length(), mismatch);
+        unsigned int i;
+
+        for (i = 0; i + 1 < alphabet.length(); ++i) {
+            scores[i * alphabet.length() + i] = match;
+        }
+
+        return ScoringMatrix(alphabet, scores);
+    }
+
+    // Get the BLOSUM62 amino acid matrix
+    ScoringMatrix blosum62Matrix() {
+        std::vector<int> scores;
+        unsigned int i;
+
+        scores.reserve(24 * 24);
+
+        for (i = 0; i < 24; ++i) {
+            scores.insert(scores.end(), BLOSUM62[i], BLOSUM62[i] + 24);
+        }
+
+        return ScoringMatrix(BLOSUM62_ALPHABET, scores);
+    }
+
+    // --------------------------------------------------------------------------
+
+    // Encode the characters of `s` to indices in the alphabet of `matrix`
+    static std::vector<unsigned char> encodeSequence(SequenceView s, const ScoringMatrix &matrix) {
+        std::vector<unsigned char> codes(s.length());
+        size_t i;
+
+        for (i = 0; i < s.length(); ++i) {
+            codes[i] = matrix.code(s[i]);
+        }
+
+        return codes;
+    }
+
+    // Gotoh alignment of the encoded `query` against `target` in 32-bit scores. With `trace` set the source of every cell is
+    // kept, (query length + 1) x (target length + 1) bytes, so the path can be walked back into `result`; otherwise only
+    // the score and end positions are filled in and two rows of scores are all the memory used.
+    static void alignScalar(const std::vector<unsigned char> &query, SequenceView querySequence, SequenceView target,
+                            const ScoringMatrix &matrix, int gapOpen, int gapExtend, AlignmentMode mode, bool trace,
+                            Alignment &result) {
+        size_t m = query.size();
+        size_t n = target.length();
+        std::vector<int> hPrev(n + 1);
+        std::vector<int> hCur(n + 1);
+        std::vector<int> f(n + 1, SCORE_NEG_INF);
+        std::vector<unsigned char> codes = encodeSequence(target, matrix);
+        std::vector<unsigned char> traces;
+        std::vector<char> ops;
+        bool local = mode == AlignmentMode::LOCAL;
+        bool global = mode == AlignmentMode::GLOBAL;
+        int best = SCORE_NEG_INF;
+        size_t bestI = 0;
+        size_t bestJ = 0;
+        int e;
+        int h;
+        int diagonal;
+        unsigned char bits;
+        unsigned char state;
+        size_t i;
+        size_t j;
+
+        if (trace) {
+            traces.assign((m + 1) * (n + 1), 0);
+        }
+
+        hPrev[0] = 0;
+
+        for (j = 1; j <= n; ++j) {
+            hPrev[j] = global ? -(gapOpen + (int) (j - 1) * gapExtend) : 0;
+        }
+
+        // Free end gaps and local alignments can always score 0 with an empty alignment
+        if (!global) {
+            best = 0;
+            bestI = local ? 0 : m;
+        }
+
+        for (i = 1; i <= m; ++i) {
+            hCur[0] = global ? -(gapOpen + (int) (i - 1) * gapExtend) : 0;
+            e = SCORE_NEG_INF;
+
+            for (j = 1; j <= n; ++j) {
+                bits = 0;
+
+                if (e - gapExtend >= hCur[j - 1] - gapOpen) {
+                    e = e - gapExtend;
+                    bits |= TRACE_E_EXTEND;
+                } else {
+                    e = hCur[j - 1] - gapOpen;
+                }
+
+                if (f[j] - gapExtend >= hPrev[j] - gapOpen) {
+                    f[j] = f[j] - gapExtend;
+                    bits |= TRACE_F_EXTEND;
+                } else {
+                    f[j] = hPrev[j] - gapOpen;
+                }
+
+                diagonal = hPrev[j - 1] + matrix.score(query[i - 1], codes[j - 1]);
+                h = diagonal;
+
+                if (e > h) {
+                    h = e;
+                    bits |= TRACE_E;
+                }
+
+                if (f[j] > h) {
+                    h = f[j];
+                    bits = (bits & ~TRACE_SOURCE) | TRACE_F;
+                }
+
+                if (local && h <= 0) {
+                    h = 0;
+                    bits |= TRACE_ZERO;
+                }
+
+                hCur[j] = h;
+
+                if (trace) {
+                    traces[i * (n + 1) + j] = bits;
+                }
+
+                if ((local && h > best) || (mode == AlignmentMode::SEMI_GLOBAL && (i == m || j == n) && h > best)) {
+                    best = h;
+                    bestI = i;
+                    bestJ = j;
+                }
+            }
+
+            std::swap(hPrev, hCur);
+        }
+
+        if (global) {
+            best = hPrev[n];
+            bestI = m;
+            bestJ = n;
+        }
+
+        result.score = best;
+        result.queryEnd = bestI;
+        result.targetEnd = bestJ;
+
+        if (!trace) {
+            return;
+        }
+
+        // Walk back from the end in the state that produced each score, collecting the operations in reverse
+        i = bestI;
+        j = bestJ;
+        state = TRACE_DIAGONAL;
+
+        while (true) {
+            if (state == TRACE_DIAGONAL) {
+                if (i == 0 || j == 0) {
+                    if (global) {
+                        ops.insert(ops.end(), i, 'I');
+                        ops.insert(ops.end(), j, 'D');
+                        i = 0;
+                        j = 0;
+                    }
+
+                    break;
+                }
+
+                bits = traces[i * (n + 1) + j];
+
+                if ((bits & TRACE_SOURCE) == TRACE_ZERO) {
+                    break;
+                } else if ((bits & TRACE_SOURCE) == TRACE_DIAGONAL) {
+                    // Label through the matrix the score came from, so letters it scores as equal are matches and
+                    // wildcards it never rewards are mismatches
+                    ops.push_back(query[i - 1] == codes[j - 1] && matrix.score(query[i - 1], codes[j - 1]) > 0 ? '=' : 'X');
+                    --i;
+                    --j;
+                } else {
+                    state = bits & TRACE_SOURCE;
+                }
+            } else if (state == TRACE_E) {
+                bits = traces[i * (n + 1) + j];
+                ops.push_back('D');
+                --j;
+                state = (bits & TRACE_E_EXTEND) ? TRACE_E : TRACE_DIAGONAL;
+            } else {
+                bits = traces[i * (n + 1) + j];
+                ops.push_back('I');
+                --i;
+                state = (bits & TRACE_F_EXTEND) ? TRACE_F : TRACE_DIAGONAL;
+            }
+        }
+
+        result.queryStart = i;
+        result.targetStart = j;
+        result.cigar.clear();
+        result.alignedQuery.clear();
+        result.alignedTarget.clear();
+        result.alignedQuery.reserve(ops.size());
+        result.alignedTarget.reserve(ops.size());
+        std::reverse(ops.begin(), ops.end());
+
+        for (char op : ops) {
+            result.alignedQuery.push_back(op == 'D' ? '-' : querySequence[i++]);
+            result.alignedTarget.push_back(op == 'I' ? '-' : target[j++]);
+        }
+
+        for (i = 0; i < ops.size(); i = j) {
+            for (j = i; j < ops.size() && ops[j] == ops[i]; ++j) {}
+
+            result.cigar += std::to_string(j - i);
+            result.cigar.push_back(ops[i]);
+        }
+    }
+
+#ifdef BIOINFO_X86_KERNELS
+    // One SIMD register in memory. Containers of it keep the alignment that a container of __m128i itself would drop.
+    struct alignas(16) LaneVector {
+        __m128i value;
+    };
+
+    // 16 signed 8-bit lanes of a striped kernel
+    struct StripedLanes8 {
+        typedef int8_t Value;
+        static const unsigned int LANES = 16;
+        static const int MIN = INT8_MIN;
+        static const int MAX = INT8_MAX;
+
+        __attribute__((target("sse4.1"))) static inline __m128i set(int v) { return _mm_set1_epi8((char) v); }
+        __attribute__((target("sse4.1"))) static inline __m128i add(__m128i a, __m128i b) { return _mm_adds_epi8(a, b); }
+        __attribute__((target("sse4.1"))) static inline __m128i sub(__m128i a, __m128i b) { return _mm_subs_epi8(a, b); }
+        __attribute__((target("sse4.1"))) static inline __m128i max(__m128i a, __m128i b) { return _mm_max_epi8(a, b); }
+        __attribute__((target("sse4.1"))) static inline __m128i min(__m128i a, __m128i b) { return _mm_min_epi8(a, b); }
+        __attribute__((target("sse4.1"))) static inline __m128i greater(__m128i a, __m128i b) { return _mm_cmpgt_epi8(a, b); }
+
+        // Move every lane up by one and put `first` in lane 0
+        __attribute__((target("sse4.1"))) static inline __m128i shift(__m128i v, int first) {
+            return _mm_insert_epi8(_mm_slli_si128(v, 1), first, 0);
+        }
+    };
+
+    // 8 signed 16-bit lanes of a striped kernel
+    struct StripedLanes16 {
+        typedef int16_t Value;
+        static const unsigned int LANES = 8;
+        static const int MIN = INT16_MIN;
+        static const int MAX = INT16_MAX;
+
+        __attribute__((target("sse4.1"))) static inline __m128i set(int v) { return _mm_set1_epi16((short) v); }
+        __attribute__((target("sse4.1"))) static inline __m128i add(__m128i a, __m128i b) { return _mm_adds_epi16(a, b); }
+        __attribute__((target("sse4.1"))) static inline __m128i sub(__m128i a, __m128i b) { return _mm_subs_epi16(a, b); }
+        __attribute__((target("sse4.1"))) static inline __m128i max(__m128i a, __m128i b) { return _mm_max_epi16(a, b); }
+        __attribute__((target("sse4.1"))) static inline __m128i min(__m128i a, __m128i b) { return _mm_min_epi16(a, b); }
+        __attribute__((target("sse4.1"))) static inline __m128i greater(__m128i a, __m128i b) { return _mm_cmpgt_epi16(a, b); }
+
+        // Move every lane up by one and put `first` in lane 0
+        __attribute__((target("sse4.1"))) static inline __m128i shift(__m128i v, int first) {
+            return _mm_insert_epi16(_mm_slli_si128(v, 2), first, 0);
+        }
+    };
+
+    // Clamp `v` into the range of a lane
+    template <typename V> static inline int clampLane(long long v) {
+        return v < V::MIN ? V::MIN : (v > V::MAX ? V::MAX : (int) v);
+    }
+
+    // Striped query profile (Farrar 2007): query row i sits in lane i / segments of vector i % segments, and there is one
+    // such column of vectors per letter holding the score of every query row against that letter. Rows past the end of
+    // the query score 0; they come after every real row, so they never feed back into one.
+    template <typename V> struct StripedProfile {
+        size_t segments = 0;
+        std::vector<LaneVector> scores;
+
+        void build(const std::vector<unsigned char> &query, const ScoringMatrix &matrix) {
+            typename V::Value lanes[V::LANES];
+            size_t row;
+            size_t s;
+            unsigned int a;
+            unsigned int l;
+
+            (*this).segments = (query.size() + V::LANES - 1) / V::LANES;
+            (*this).scores.resize(matrix.size() * (*this).segments);
+
+            for (a = 0; a < matrix.size(); ++a) {
+                for (s = 0; s < (*this).segments; ++s) {
+                    for (l = 0; l < V::LANES; ++l) {
+                        row = l * (*this).segments + s;
+                        lanes[l] = row < query.size() ? matrix.score(query[row], (unsigned char) a) : 0;
+                    }
+
+                    std::memcpy(&(*this).scores[a * (*this).segments + s].value, lanes, sizeof(lanes));
+                }
+            }
+        }
+    };
+
+    // Get lane `l` of `v`
+    template <typename V> static inline int laneValue(__m128i v, unsigned int l) {
+        typename V::Value lanes[V::LANES];
+
+        std::memcpy(lanes, &v, sizeof(lanes));
+        return lanes[l];
+    }
+
+    // Score `target` against a striped query profile of `m` rows with the same recurrences as alignScalar. Each target
+    // column is one pass down the segments, ignoring vertical gaps that cross from one lane into the next, followed by the
+    // lazy F loop that carries those gaps across lanes until they stop improving any score. Returns false when a score got
+    // close enough to the range of a lane that saturation may have changed the result.
+    template <typename V>
+    __attribute__((target("sse4.1"))) static bool stripedScore(const StripedProfile<V> &profile, size_t m, SequenceView target,
+                                                               const ScoringMatrix &matrix, int gapOpen, int gapExtend,
+                                                               AlignmentMode mode, std::vector<LaneVector> &scratch, int &score) {
+        size_t segments = profile.segments;
+        size_t n = target.length();
+        size_t lastSegment = (m - 1) % segments;
+        unsigned int lastLane = (m - 1) / segments;
+        bool local = mode == AlignmentMode::LOCAL;
+        bool global = mode == AlignmentMode::GLOBAL;
+        const __m128i vOpen = V::set(gapOpen);
+        const __m128i vExtend = V::set(gapExtend);
+        const __m128i vZero = _mm_setzero_si128();
+        const __m128i vNegInf = V::set(V::MIN);
+        __m128i vMax = vNegInf;
+        __m128i vMin = V::set(V::MAX);
+        __m128i vH;
+        __m128i vE;
+        __m128i vF;
+        __m128i vRaised;
+        __m128i *hLoad;
+        __m128i *hStore;
+        __m128i *e;
+        const __m128i *p;
+        typename V::Value lanes[V::LANES];
+        int best = 0;
+        int highest;
+        int lowest;
+        size_t i;
+        size_t j;
+        size_t s;
+        unsigned int k;
+        unsigned int l;
+
+        // Score of the top boundary row above target column `c`, which is column -1 when `c` is -1
+        auto top = [&](long long c) {
+            return clampLane<V>(global && c >= 0 ? -((long long) gapOpen + c * gapExtend) : 0);
+        };
+
+        scratch.resize(3 * segments);
+        hLoad = &scratch.data()->value;
+        hStore = hLoad + segments;
+        e = hStore + segments;
+
+        for (s = 0; s < segments; ++s) {
+            for (l = 0; l < V::LANES; ++l) {
+                i = l * segments + s;
+                lanes[l] = global ? clampLane<V>(-((long long) gapOpen + (long long) i * gapExtend)) : 0;
+            }
+
+            std::memcpy(&hLoad[s], lanes, sizeof(lanes));
+            e[s] = V::sub(hLoad[s], vOpen);
+        }
+
+        for (j = 0; j < n; ++j) {
+            p = &profile.scores[matrix.code(target[j]) * segments].value;
+            vF = V::shift(vNegInf, clampLane<V>((long long) top(j) - gapOpen));
+            vH = V::shift(hLoad[segments - 1], top((long long) j - 1));
+
+            for (s = 0; s < segments; ++s) {
+                vH = V::add(vH, p[s]);
+                vE = e[s];
+                vH = V::max(vH, vE);
+                vH = V::max(vH, vF);
+
+                if (local) {
+                    vH = V::max(vH, vZero);
+                }
+
+                hStore[s] = vH;
+                vMax = V::max(vMax, vH);
+                vMin = V::min(vMin, vH);
+
+                vH = V::sub(vH, vOpen);
+                e[s] = V::max(V::sub(vE, vExtend), vH);
+                vF = V::max(V::sub(vF, vExtend), vH);
+                vH = hLoad[s];
+            }
+
+            for (k = 0; k < V::LANES; ++k) {
+                vF = V::shift(vF, V::MIN);
+
+                for (s = 0; s < segments; ++s) {
+                    vRaised = V::greater(vF, hStore[s]);
+                    vH = V::max(hStore[s], vF);
+                    hStore[s] = vH;
+                    vMax = V::max(vMax, vH);
+
+                    vH = V::sub(vH, vOpen);
+                    e[s] = V::max(e[s], vH);
+                    vF = V::sub(vF, vExtend);
+
+                    // Done once F can no longer beat the gaps the first pass already opened below here. A score F just
+                    // raised still has to be carried down even when opening and extending cost the same.
+                    if (!_mm_movemask_epi8(_mm_or_si128(V::greater(vF, vH), vRaised))) {
+                        goto columnDone;
+                    }
+                }
+            }
+
+        columnDone:
+            if (mode == AlignmentMode::SEMI_GLOBAL) {
+                best = std::max(best, laneValue<V>(hStore[lastSegment], lastLane));
+            }
+
+            std::swap(hLoad, hStore);
+        }
+
+        highest = V::MIN;
+        lowest = V::MAX;
+
+        for (l = 0; l < V::LANES; ++l) {
+            highest = std::max(highest, laneValue<V>(vMax, l));
+            lowest = std::min(lowest, laneValue<V>(vMin, l));
+        }
+
+        if (highest >= V::MAX - matrix.getMaxScore() ||
+            (!local && lowest <= V::MIN + gapOpen + gapExtend - std::min(matrix.getMinScore(), 0))) {
+            return false;
+        }
+
+        if (local) {
+            score = highest;
+        } else if (global) {
+            score = laneValue<V>(hLoad[lastSegment], lastLane);
+        } else {
+            // The last target column is the other free end
+            for (i = 0; i < m; ++i) {
+                best = std::max(best, laneValue<V>(hLoad[i % segments], i / segments));
+            }
+
+            score = best;
+        }
+
+        return true;
+    }
+
+    static const bool STRIPED_KERNELS = __builtin_cpu_supports("sse4.1");
+#endif
+
+    // Working memory of the striped kernels, kept across the targets one task scores
+    struct AlignScratch {
+#ifdef BIOINFO_X86_KERNELS
+        std::vector<LaneVector> vectors;
+#endif
+    };
+
+    // A query prepared once for scoring against any number of targets: its letter codes for the scalar kernel and, where
+    // the striped kernels can run, a profile for each lane width whose range the scoring scheme fits in.
+    struct QueryProfile {
+        SequenceView sequence;
+        std::vector<unsigned char> codes;
+#ifdef BIOINFO_X86_KERNELS
+        StripedProfile<StripedLanes8> profile8;
+        StripedProfile<StripedLanes16> profile16;
+        bool use8 = false;
+        bool use16 = false;
+#endif
+    };
+
+    // Check if a striped kernel with lanes of range [`laneMin`, `laneMax`] can score `length` bases with the given scheme
+    // without the boundary or a single step already saturating
+    static bool fitsLanes(int laneMin, int laneMax, size_t length, const ScoringMatrix &matrix, int gapOpen, int gapExtend,
+                          AlignmentMode mode) {
+        long long step = (long long) gapOpen + gapExtend + std::max(matrix.getMaxScore(), -matrix.getMinScore());
+
+        if (4 * step >= laneMax) {
+            return false;
+        }
+
+        return mode != AlignmentMode::GLOBAL || (long long) gapOpen + (long long) length * gapExtend + step < -(long long) laneMin;
+    }
+
+    // Prepare `query` for the aligner with scoring `matrix` and gaps `gapOpen` and `gapExtend` in `mode`. 8-bit lanes are only
+    // tried in local mode, where scores cannot drop below 0; the other modes start at 16 bits.
+    static QueryProfile prepareQuery(SequenceView query, const ScoringMatrix &matrix, int gapOpen, int gapExtend,
+                                     AlignmentMode mode, size_t longestTarget) {
+        QueryProfile qp;
+        size_t longest = std::max(query.length(), longestTarget);
+
+        qp.sequence = query;
+        qp.codes = encodeSequence(query, matrix);
+
+#ifdef BIOINFO_X86_KERNELS
+        if (STRIPED_KERNELS && !query.empty()) {
+            qp.use8 = mode == AlignmentMode::LOCAL &&
+                      fitsLanes(StripedLanes8::MIN, StripedLanes8::MAX, longest, matrix, gapOpen, gapExtend, mode);
+            qp.use16 = fitsLanes(StripedLanes16::MIN, StripedLanes16::MAX, longest, matrix, gapOpen, gapExtend, mode);
+
+            if (qp.use8) {
+                qp.profile8.build(qp.codes, matrix);
+            }
+
+            if (qp.use16) {
+                qp.profile16.build(qp.codes, matrix);
+            }
+        }
+#endif
+
+        return qp;
+    }
+
+    // Score a prepared query against `target` in the narrowest lanes that do not overflow, down to the scalar kernel
+    static int scorePrepared(const QueryProfile &qp, SequenceView target, const ScoringMatrix &matrix, int gapOpen,
+                             int gapExtend, AlignmentMode mode, AlignScratch &scratch) {
+        Alignment result;
+        int score;
+
+#ifdef BIOINFO_X86_KERNELS
+        if (!target.empty()) {
+            if (qp.use8 && stripedScore<StripedLanes8>(qp.profile8, qp.codes.size(), target, matrix, gapOpen, gapExtend, mode,
+                                                       scratch.vectors, score)) {
+                return score;
+            }
+
+            if (qp.use16 && stripedScore<StripedLanes16>(qp.profile16, qp.codes.size(), target, matrix, gapOpen, gapExtend,
+                                                         mode, scratch.vectors, score)) {
+                return score;
+            }
+        }
+#endif
+
+        alignScalar(qp.codes, qp.sequence, target, matrix, gapOpen, gapExtend, mode, false, result);
+
+        return result.score;
+    }
+
+    // --------------------------------------------------------------------------
+
+    // Create an aligner scoring substitutions with `matrix`, opening a gap with `gapOpen` and extending it with `gapExtend`
+    // (both penalties, so positive), aligning in `mode`
+    Aligner::Aligner(ScoringMatrix matrix, int gapOpen, int gapExtend, AlignmentMode mode) : matrix(std::move(matrix)) {
+        if (gapOpen < 0 || gapExtend < 0) {
+            throw std::invalid_argument("ERROR: Gap penalties cannot be negative!");
+        } else if (gapExtend > gapOpen) {
+            throw std::invalid_argument("ERROR: Gap extension penalty cannot be more than the gap open penalty!");
+        }
+
+        (*this).gapOpen = gapOpen;
+        (*this).gapExtend = gapExtend;
+        (*this).mode = mode;
+    }
+
+    // Get the substitution scores of the aligner
+    const ScoringMatrix &Aligner::getMatrix() const {
+        return (*this).matrix;
+    }
+
+    // Get the penalty of the first position of a gap
+    int Aligner::getGapOpen() const {
+        return (*this).gapOpen;
+    }
+
+    // Get the penalty of every later position of a gap
+    int Aligner::getGapExtend() const {
+        return (*this).gapExtend;
+    }
+
+    // Get the alignment mode
+    AlignmentMode Aligner::getMode() const {
+        return (*this).mode;
+    }
+
+    // Get the best alignment score of `query` against `target`, without the alignment itself
+    int Aligner::score(SequenceView query, SequenceView target) const {
+        QueryProfile qp = prepareQuery(query, (*this).matrix, (*this).gapOpen, (*this).gapExtend, (*this).mode, target.length());
+        AlignScratch scratch;
+
+        return scorePrepared(qp, target, (*this).matrix, (*this).gapOpen, (*this).gapExtend, (*this).mode, scratch);
+    }
+
+    // Get the best alignment of `query` against `target` with its traceback. Needs a byte per pair of bases.
+    Alignment Aligner::align(SequenceView query, SequenceView target) const {
+        Alignment result;
+
+        alignScalar(encodeSequence(query, (*this).matrix), query, target, (*this).matrix, (*this).gapOpen, (*this).gapExtend,
+                    (*this).mode, true, result);
+
+        return result;
+    }
+
+    // Get the best alignment score of `query` against every sequence in `targets`. The query profile is built once and the
+    // targets are spread across `threads` threads.
+    std::vector<int> Aligner::scoreBatch(SequenceView query, const std::vector<SequenceView> &targets, unsigned int threads) const {
+        std::vector<int> scores(targets.size());
+        size_t longest = 0;
+        size_t tasks = (targets.size() + ALIGN_TASK_TARGETS - 1) / ALIGN_TASK_TARGETS;
+
+        for (const SequenceView &t : targets) {
+            longest = std::max(longest, t.length());
+        }
+
+        QueryProfile qp = prepareQuery(query, (*this).matrix, (*this).gapOpen, (*this).gapExtend, (*this).mode, longest);
+
+        parallelFor(tasks, threads, [&](size_t t) {
+            AlignScratch scratch;
+            size_t end = std::min(targets.size(), (t + 1) * ALIGN_TASK_TARGETS);
+            size_t i;
+
+            for (i = t * ALIGN_TASK_TARGETS; i < end; ++i) {
+                scores[i] = scorePrepared(qp, targets[i], (*this).matrix, (*this).gapOpen, (*this).gapExtend, (*this).mode,
+                                          scratch);
+            }
+        });
+
+        return scores;
+    }
+
+    // Get the best alignment score of `query` against every record of `targets`
+    std::vector<int> Aligner::scoreBatch(SequenceView query, const SequenceBatch &targets, unsigned int threads) const {
+        std::vector<SequenceView> views;
+        size_t i;
+
+        views.reserve(targets.size());
+
+        for (i = 0; i < targets.size(); ++i) {
+            views.push_back(targets.getSequence(i));
+        }
+
+        return (*this).scoreBatch(query, views, threads);
+    }
+
+    // Get the best alignment of `query` against every sequence in `targets` with its traceback, across `threads` threads
+    std::vector<Alignment> Aligner::alignBatch(SequenceView query, const std::vector<SequenceView> &targets,
+                                               unsigned int threads) const {
+        std::vector<Alignment> alignments(targets.size());
+        std::vector<unsigned char> codes = encodeSequence(query, (*this).matrix);
+
+        parallelFor(targets.size(), threads, [&](size_t i) {
+            alignScalar(codes, query, targets[i], (*this).matrix, (*this).gapOpen, (*this).gapExtend, (*this).mode, true,
+                        alignments[i]);
+        });
+
+        return alignments;
+    }
+}
@@ -1,41 +1,144 @@
 #include <analysis.hpp>
 #include <fundamentals.hpp>
+#include <parallel.hpp>
+#include <motif.hpp>
+#include <seqio.hpp>
 #include <string>
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
+#include <string_view>
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+#include <cstdint>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <fstream>
+#include <cstdio>
+#include <unistd.h>
+#include <cmath>
+#include <climits>
+#include <iterator>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BIOINFO_X86_KERNELS 1
+#endif
 
 namespace bioinfo {
     // Create a new `AdjacencyList` object that generates the overlap graph of a vector of DNAStrings and 
-    // stores the headers of each directed edge that make up the graph.
-    AdjacencyList::AdjacencyList(std::vector<DNAString> &vec, unsigned int ok) {
-        (*this).internalConstructor(vec, ok);
+    // stores the headers of each directed edge that make up the graph. The graph is built on `threads` threads (0 for one per
+    // core).
+    AdjacencyList::AdjacencyList(std::vector<DNAString> &vec, unsigned int ok, unsigned int threads) {
+        (*this).internalConstructor(vec, ok, threads);
     }
 
-    template <typename T> void AdjacencyList::internalConstructor(std::vector<T> &vec, unsigned int ok) {
-        std::vector<DNAString>::iterator outer;
-        std::vector<DNAString>::iterator inner;
+    // Build the overlap graph with a hash join instead of comparing every pair of sequences. The prefix and suffix of length
+    // `ok` of every sequence are extracted once and hashed into shards, each shard indexes its prefixes in a hash table, and
+    // every suffix is joined against the bucket of identical prefixes. Edges come out in the same (tail, head) order as the
+    // all-pairs comparison.
+    template <typename T> void AdjacencyList::internalConstructor(std::vector<T> &vec, unsigned int ok, unsigned int threads) {
+        typedef std::unordered_map<std::string_view, std::vector<unsigned int>> PrefixBuckets;
 
-        DirectedEdge dsde;
-        std::string prefix;
-        std::string suffix;
+        const size_t BLOCK_SIZE = 4096;
+        size_t n = vec.size();
+        size_t blocks = (n + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        size_t shardCount;
+        size_t i;
 
-        for (outer = vec.begin(); outer != vec.end(); outer++) {
-            for (inner = vec.begin(); inner != vec.end(); inner++) {
-                if (outer != inner && outer->getSequenceLength() > ok && inner->getSequenceLength() > ok) {
+        std::vector<std::string_view> prefixes(n);
+        std::vector<std::string_view> suffixes(n);
+        std::vector<size_t> shardOf(n);
+        std::vector<std::vector<unsigned int>> prefixShards;
+        std::vector<std::vector<unsigned int>> suffixShards;
+        std::vector<PrefixBuckets> buckets;
+        std::vector<const std::vector<unsigned int> *> matches(n, NULL);
+        std::vector<size_t> offsets(n + 1, 0);
 
-                    suffix = outer->getSequence().substr(outer->getSequenceLength() - ok);
-                    prefix = inner->getSequence().substr(0, ok);
+        threads = resolveThreadCount(threads);
+        shardCount = threads * 8;
 
-                    if (prefix == suffix) {
-                        dsde.tail = outer->getHeader();
-                        dsde.head = inner->getHeader();
+        // Point at the ends of every sequence that is longer than the overlap, without copying them
+        parallelFor(blocks, threads, [&](size_t b) {
+            SequenceView seq;
+            size_t k;
 
-                        (*this).dsde.push_back(dsde);
-                    }
+            for (k = b * BLOCK_SIZE; k < std::min(n, (b + 1) * BLOCK_SIZE); ++k) {
+                if (vec[k].getSequenceLength() > ok) {
+                    seq = vec[k].getSequenceView();
+                    prefixes[k] = std::string_view(seq.data(), ok);
+                    suffixes[k] = std::string_view(seq.data() + seq.length() - ok, ok);
+                }
+            }
+        });
+
+        prefixShards.resize(shardCount);
+        suffixShards.resize(shardCount);
+        buckets.resize(shardCount);
+
+        for (i = 0; i < n; ++i) {
+            if (vec[i].getSequenceLength() > ok) {
+                prefixShards[std::hash<std::string_view>()(prefixes[i]) % shardCount].push_back(i);
+                suffixShards[std::hash<std::string_view>()(suffixes[i]) % shardCount].push_back(i);
+            }
+        }
+
+        // Join every suffix with the bucket of matching prefixes in its shard
+        parallelFor(shardCount, threads, [&](size_t shard) {
+            PrefixBuckets &table = buckets[shard];
+            PrefixBuckets::const_iterator it;
+
+            for (unsigned int k : prefixShards[shard]) {
+                table[prefixes[k]].push_back(k);
+            }
+
+            for (unsigned int k : suffixShards[shard]) {
+                it = table.find(suffixes[k]);
+
+                if (it != table.end()) {
+                    matches[k] = &it->second;
                 }
             }
+        });
+
+        // Every bucket is sorted, so emitting them in tail order keeps the all-pairs edge order
+        for (i = 0; i < n; ++i) {
+            offsets[i + 1] = offsets[i];
+
+            if (matches[i] != NULL) {
+                offsets[i + 1] += matches[i]->size() - std::binary_search(matches[i]->begin(), matches[i]->end(), i);
+            }
         }
+
+        (*this).dsde.resize(offsets[n]);
+
+        parallelFor(blocks, threads, [&](size_t b) {
+            size_t k;
+            size_t e;
+
+            for (k = b * BLOCK_SIZE; k < std::min(n, (b + 1) * BLOCK_SIZE); ++k) {
+                if (matches[k] == NULL) {
+                    continue;
+                }
+
+                e = offsets[k];
+
+                for (unsigned int head : *matches[k]) {
+                    if (head != k) {
+                        (*this).dsde[e].tail = vec[k].getHeader();
+                        (*this).dsde[e].head = vec[head].getHeader();
+                        ++e;
+                    }
+                }
+            }
+        });
+    }
+
+    // Get the directed edges of the overlap graph, tail and head given by header
+    const std::vector<DirectedEdge> &AdjacencyList::getEdges() const {
+        return (*this).dsde;
     }
 
     // Return the `AdjacencyList` directed edge vector as a string.
@@ -60,6 +163,14 @@ namespace bioinfo {
         std::vector<unsigned int> positions;
         unsigned int pos = 0;
 
+        if (ds.isPacked()) {
+            if (motif.isPacked()) {
+                return exactPackedMotif(ds.getPackedSequence(), motif.getPackedSequence(), overlap);
+            }
+
+            return exactPackedMotif(ds.getPackedSequence(), PackedSequence(motif.getSequence()), overlap);
+        }
+
         if (motif.getSequenceLength() > ds.getSequenceLength()) {
             // throw error that motif is greater than ds
         } else if (motif.getSequenceLength() == 0) {
@@ -81,38 +192,516 @@ namespace bioinfo {
         return positions;
     }
 
+    // Count the positions where `s` and `t` differ, one character at a time.
+    static size_t hammingScalar(const char *s, const char *t, size_t n) {
+        size_t hd = 0;
+        size_t i;
+
+        for (i = 0; i < n; ++i) {
+            hd += s[i] != t[i];
+        }
+
+        return hd;
+    }
+
+#ifdef BIOINFO_X86_KERNELS
+    // Count differing characters 16 at a time. Equal bytes are accumulated as 8-bit counters for up to 255 iterations before
+    // being summed with `_mm_sad_epu8`.
+    __attribute__((target("sse2"))) static size_t hammingSSE2(const char *s, const char *t, size_t n) {
+        const __m128i zero = _mm_setzero_si128();
+        __m128i acc;
+        __m128i sums;
+        size_t equal = 0;
+        size_t i = 0;
+        size_t chunks;
+
+        while (n - i >= 16) {
+            acc = zero;
+
+            for (chunks = std::min<size_t>((n - i) / 16, 255); chunks > 0; --chunks, i += 16) {
+                acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *) (s + i)),
+                                                       _mm_loadu_si128((const __m128i *) (t + i))));
+            }
+
+            sums = _mm_sad_epu8(acc, zero);
+            equal += _mm_extract_epi16(sums, 0) + _mm_extract_epi16(sums, 4);
+        }
+
+        return i - equal + hammingScalar(s + i, t + i, n - i);
+    }
+
+    // Count differing characters 32 at a time with the same counter scheme as the SSE2 kernel.
+    __attribute__((target("avx2"))) static size_t hammingAVX2(const char *s, const char *t, size_t n) {
+        const __m256i zero = _mm256_setzero_si256();
+        __m256i acc;
+        __m256i sums;
+        size_t equal = 0;
+        size_t i = 0;
+        size_t chunks;
+
+        while (n - i >= 32) {
+            acc = zero;
+
+            for (chunks = std::min<size_t>((n - i) / 32, 255); chunks > 0; --chunks, i += 32) {
+                acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *) (s + i)),
+                                                             _mm256_loadu_si256((const __m256i *) (t + i))));
+            }
+
+            sums = _mm256_sad_epu8(acc, zero);
+            equal += _mm256_extract_epi16(sums, 0) + _mm256_extract_epi16(sums, 4) +
+                     _mm256_extract_epi16(sums, 8) + _mm256_extract_epi16(sums, 12);
+        }
+
+        return i - equal + hammingSSE2(s + i, t + i, n - i);
+    }
+
+    // Count differing characters 64 at a time using the byte compare mask registers.
+    __attribute__((target("avx512bw,popcnt"))) static size_t hammingAVX512(const char *s, const char *t, size_t n) {
+        size_t hd = 0;
+        size_t i;
+
+        for (i = 0; i + 64 <= n; i += 64) {
+            hd += __builtin_popcountll(_mm512_cmpneq_epi8_mask(_mm512_loadu_si512((const void *) (s + i)),
+                                                               _mm512_loadu_si512((const void *) (t + i))));
+        }
+
+        return hd + hammingAVX2(s + i, t + i, n - i);
+    }
+#endif
+
+    typedef size_t (*HammingKernel)(const char *, const char *, size_t);
+
+    // Pick the widest hamming distance kernel the CPU supports, once.
+    static HammingKernel hammingKernel() {
+        static const HammingKernel kernel = []() {
+#ifdef BIOINFO_X86_KERNELS
+            __builtin_cpu_init();
+
+            if (__builtin_cpu_supports("avx512bw")) {
+                return (HammingKernel) hammingAVX512;
+            } else if (__builtin_cpu_supports("avx2")) {
+                return (HammingKernel) hammingAVX2;
+            }
+
+            return (HammingKernel) hammingSSE2;
+#else
+            return (HammingKernel) hammingScalar;
+#endif
+        }();
+
+        return kernel;
+    }
+
+    // Get the hamming distance between two strings (`s` and `t`) of the same length with the widest SIMD kernel available.
+    unsigned int hammingDistance(const std::string &s, const std::string &t) {
+        return hammingDistance(SequenceView(s), SequenceView(t));
+    }
+
+    // Get the hamming distance between two sequence views (`s` and `t`) of the same length, whatever storage they point into.
+    unsigned int hammingDistance(SequenceView s, SequenceView t) {
+        if (s.length() != t.length()) {
+            throw std::invalid_argument("ERROR: Sequences are not the same length!");
+        }
+
+        return hammingKernel()(s.data(), t.data(), s.length());
+    }
+
     // Get the hamming distance between the sequences of two DNAStrings (`s` and `t`).
     unsigned int hammingDistance(DNAString &s, DNAString &t) {
-        unsigned int hd = 0;
-        unsigned int i = 0;
-
         if (s.getSequenceLength() != t.getSequenceLength()) {
             throw std::invalid_argument("ERROR: DNAString sequences are not the same length!");
         }
 
-        for (i = 0; i < s.getSequenceLength(); ++i) {
-            if (s.getSequence().at(i) != t.getSequence().at(i)) {
-                ++hd;
+        if (s.isPacked() && t.isPacked()) {
+            return hammingDistance(s.getPackedSequence(), t.getPackedSequence());
+        }
+
+        return hammingDistance(s.getSequenceView(), t.getSequenceView());
+    }
+
+    // Sequences of a batch laid out for the all-vs-all kernels. Sequences of up to 32 unambiguous bases are packed into one
+    // 2-bit word each so a pair costs a single popcount, anything else is stored back to back in one character buffer.
+    struct HammingBatch {
+        size_t n = 0;
+        size_t length = 0;
+        bool packedWords = false;
+        std::vector<uint64_t> words;
+        std::string buffer;
+    };
+
+    // Lay out the sequences of `vec` for the all-vs-all kernels, checking that they all have the same length.
+    static HammingBatch layoutHammingBatch(std::vector<DNAString> &vec, unsigned int threads) {
+        HammingBatch batch;
+        size_t i;
+
+        batch.n = vec.size();
+        batch.length = batch.n > 0 ? vec[0].getSequenceLength() : 0;
+
+        for (i = 0; i < batch.n; ++i) {
+            if (vec[i].getSequenceLength() != batch.length) {
+                throw std::invalid_argument("ERROR: DNAString sequences are not the same length!");
+            }
+        }
+
+        batch.buffer.resize(batch.n * batch.length);
+
+        parallelFor(batch.n, threads, [&](size_t k) {
+            SequenceView seq = vec[k].getSequenceView();
+            std::copy(seq.begin(), seq.end(), batch.buffer.begin() + k * batch.length);
+        });
+
+        if (batch.length <= NucleotideCodes::BASES_PER_WORD &&
+            batch.buffer.find_first_not_of("ACGT") == std::string::npos) {
+            batch.packedWords = true;
+            batch.words.resize(batch.n);
+
+            for (i = 0; i < batch.n; ++i) {
+                batch.words[i] = PackedSequence(batch.buffer.substr(i * batch.length, batch.length)).getWords().front();
             }
+
+            std::string().swap(batch.buffer);
         }
 
-        return hd;
+        return batch;
+    }
+
+    // Visit every pair (i < j) of the batch with its hamming distance. The pairs are cut into square tiles that keep both
+    // blocks of sequences in cache, and every block row of tiles is one work item so the rows spread across `threads`.
+    template <typename F> static void forEachHammingPair(const HammingBatch &batch, unsigned int threads, F visit) {
+        const size_t TILE_SIZE = 64;
+        size_t blocks = (batch.n + TILE_SIZE - 1) / TILE_SIZE;
+        HammingKernel kernel = hammingKernel();
+
+        parallelFor(blocks, threads, [&](size_t bi) {
+            size_t bj;
+            size_t i;
+            size_t j;
+            size_t x;
+            uint64_t diff;
+
+            for (bj = bi; bj < blocks; ++bj) {
+                for (i = bi * TILE_SIZE; i < std::min(batch.n, (bi + 1) * TILE_SIZE); ++i) {
+                    for (j = std::max(i + 1, bj * TILE_SIZE); j < std::min(batch.n, (bj + 1) * TILE_SIZE); ++j) {
+                        if (batch.packedWords) {
+                            x = batch.words[i] ^ batch.words[j];
+                            diff = (x | (x >> 1)) & 0x5555555555555555ULL;
+                            visit(bi, i, j, (unsigned int) __builtin_popcountll(diff));
+                        } else {
+                            visit(bi, i, j, (unsigned int) kernel(batch.buffer.data() + i * batch.length,
+                                                                  batch.buffer.data() + j * batch.length, batch.length));
+                        }
+                    }
+                }
+            }
+        });
+    }
+
+    // Get the full pairwise hamming distance matrix of the equal length DNAStrings in `vec`, stored row-major as
+    // `vec.size()` by `vec.size()` values and computed on `threads` threads (0 for one per core).
+    std::vector<unsigned int> hammingDistanceMatrix(std::vector<DNAString> &vec, unsigned int threads) {
+        HammingBatch batch = layoutHammingBatch(vec, threads);
+        std::vector<unsigned int> matrix(batch.n * batch.n, 0);
+
+        forEachHammingPair(batch, threads, [&](size_t, size_t i, size_t j, unsigned int d) {
+            matrix[i * batch.n + j] = d;
+            matrix[j * batch.n + i] = d;
+        });
+
+        return matrix;
+    }
+
+    // Get every pair of the equal length DNAStrings in `vec` that are at most `maxDistance` apart, for example barcode
+    // collisions, without materialising the whole matrix. Pairs are sorted by (first, second).
+    std::vector<HammingPair> hammingDistancePairs(std::vector<DNAString> &vec, unsigned int maxDistance, unsigned int threads) {
+        HammingBatch batch = layoutHammingBatch(vec, threads);
+        std::vector<std::vector<HammingPair>> rows((batch.n + 63) / 64);
+        std::vector<HammingPair> pairs;
+        size_t r;
+
+        forEachHammingPair(batch, threads, [&](size_t bi, size_t i, size_t j, unsigned int d) {
+            if (d <= maxDistance) {
+                rows[bi].push_back(HammingPair{(unsigned int) i, (unsigned int) j, d});
+            }
+        });
+
+        for (r = 0; r < rows.size(); ++r) {
+            std::sort(rows[r].begin(), rows[r].end(), [](const HammingPair &a, const HammingPair &b) {
+                return a.first != b.first ? a.first < b.first : a.second < b.second;
+            });
+
+            pairs.insert(pairs.end(), rows[r].begin(), rows[r].end());
+        }
+
+        return pairs;
+    }
+
+    const size_t EDIT_CHECK_INTERVAL = 8; // Columns between checks of the diagonal for an early exit of the banded edit distance
+
+    // Pattern side of the bit-parallel edit distance: for every distinct character of the pattern, a bit per row marking
+    // where it occurs, 64 rows to a word
+    struct EditPattern {
+        size_t length = 0;
+        size_t blocks = 0;
+        unsigned char codes[256]; // Character to its row of `peq`, 0 (an all zero row) when not in the pattern
+        std::vector<uint64_t> peq; // (distinct characters + 1) x blocks
+    };
+
+    // Vertical score differences of 64 rows of the current column, as bits of +1 (`p`) and -1 (`m`), and the score of
+    // the bottom row
+    struct EditBlock {
+        uint64_t p;
+        uint64_t m;
+        unsigned int score;
+    };
+
+    // Fill `ep` with the match bits of `pattern`, keeping its allocations for the next pattern
+    static void buildEditPattern(SequenceView pattern, EditPattern &ep) {
+        unsigned int distinct = 0;
+        unsigned char c;
+        size_t i;
+
+        ep.length = pattern.length();
+        ep.blocks = (pattern.length() + 63) / 64;
+        std::fill(ep.codes, ep.codes + 256, 0);
+
+        for (i = 0; i < pattern.length(); ++i) {
+            c = pattern[i];
+
+            if (ep.codes[c] == 0) {
+                ep.codes[c] = ++distinct;
+            }
+        }
+
+        ep.peq.assign((distinct + 1) * ep.blocks, 0);
+
+        for (i = 0; i < pattern.length(); ++i) {
+            ep.peq[ep.codes[(unsigned char) pattern[i]] * ep.blocks + i / 64] |= 1ULL << (i % 64);
+        }
+    }
+
+    // Advance one block of the column by a text character with match bits `eq`, given the score difference `hin` (-1, 0 or
+    // +1) along the top of the block (Myers 1999, Hyyrö's global variant). Returns the difference along the bottom of the
+    // block, read at bit `high` (the index of its last row). Branch free, as `hin` and the result change unpredictably.
+    static inline int advanceEditBlock(EditBlock &block, uint64_t eq, int hin, unsigned int high) {
+        uint64_t hinNegative = (uint64_t) (hin < 0);
+        uint64_t hinPositive = (uint64_t) (hin > 0);
+        uint64_t xv = eq | block.m;
+        uint64_t xh;
+        uint64_t ph;
+        uint64_t mh;
+        int hout;
+
+        eq |= hinNegative;
+        xh = (((eq & block.p) + block.p) ^ block.p) | eq;
+        ph = block.m | ~(xh | block.p);
+        mh = block.p & xh;
+        hout = (int) ((ph >> high) & 1) - (int) ((mh >> high) & 1);
+
+        ph = (ph << 1) | hinPositive;
+        mh = (mh << 1) | hinNegative;
+        block.p = mh | ~(xv | ph);
+        block.m = ph & xv;
+
+        return hout;
+    }
+
+    // Get the Levenshtein distance between the pattern `ep` and `text`, or `maxDistance` + 1 when it is more than that.
+    // Only the blocks of rows within `maxDistance` of both the start and the end diagonal are advanced (Ukkonen's band);
+    // rows entering the band start from an over-estimate and rows leaving it feed +1 down, which can only raise scores that
+    // are already above the limit. Scores never fall along a diagonal, so the run stops as soon as the cell on the diagonal
+    // of the last cell is over the limit.
+    static unsigned int editDistanceBanded(const EditPattern &ep, SequenceView text, unsigned int maxDistance,
+                                           std::vector<EditBlock> &blocks) {
+        size_t m = ep.length;
+        size_t n = text.length();
+        long long shift = (long long) m - (long long) n;
+        long long k = maxDistance;
+        size_t first = 0;
+        size_t last = 0;
+        size_t b;
+        size_t j;
+        long long row;
+        unsigned int lastHigh = (m - 1) % 64;
+        uint64_t mask;
+        const uint64_t *eq;
+        unsigned int bit;
+        long long value;
+        int hout;
+
+        if (std::llabs(shift) > k) {
+            return maxDistance + 1;
+        } else if (m == 0 || n == 0) {
+            return std::max(m, n);
+        }
+
+        // Highest row of block `b`, counting the top row of the pattern as 1
+        auto bottom = [&](size_t b) {
+            return std::min(64 * (b + 1), m);
+        };
+
+        // A pattern of up to 64 rows keeps its one block in registers, the band being the whole column anyway
+        if (ep.blocks == 1) {
+            EditBlock single = EditBlock{~0ULL, 0, (unsigned int) m};
+
+            mask = lastHigh == 63 ? ~0ULL : (2ULL << lastHigh) - 1;
+
+            for (j = 1; j <= n; ++j) {
+                single.score += advanceEditBlock(single, ep.peq[ep.codes[(unsigned char) text[j - 1]]], 1, lastHigh);
+                row = (long long) j + shift;
+
+                if (row > 0 && j % EDIT_CHECK_INTERVAL == 0) {
+                    value = (long long) single.score - __builtin_popcountll(single.p & mask & ~((2ULL << (row - 1)) - 1)) +
+                            __builtin_popcountll(single.m & mask & ~((2ULL << (row - 1)) - 1));
+
+                    if (value > k) {
+                        return maxDistance + 1;
+                    }
+                }
+            }
+
+            return single.score <= maxDistance ? single.score : maxDistance + 1;
+        }
+
+        blocks.resize(ep.blocks);
+        blocks[0] = EditBlock{~0ULL, 0, (unsigned int) bottom(0)};
+
+        for (j = 1; j <= n; ++j) {
+            // Bring in every block that has rows within the band of this column, scored as if the gap ran straight down
+            while (last + 1 < ep.blocks && (long long) (64 * (last + 1) + 1) <= (long long) j + k) {
+                ++last;
+                blocks[last] = EditBlock{~0ULL, 0, blocks[last - 1].score + (unsigned int) (bottom(last) - 64 * last)};
+            }
+
+            while (first < last && (long long) bottom(first) < (long long) j + shift - k) {
+                ++first;
+            }
+
+            eq = ep.peq.data() + ep.codes[(unsigned char) text[j - 1]] * ep.blocks;
+            hout = 1;
+
+            for (b = first; b <= last; ++b) {
+                hout = advanceEditBlock(blocks[b], eq[b], hout, b + 1 == ep.blocks ? lastHigh : 63);
+                blocks[b].score += hout;
+            }
+
+            // Checked every few columns, as reading one row out of a block costs two popcounts
+            row = (long long) j + shift;
+
+            if (row > 0 && j % EDIT_CHECK_INTERVAL == 0) {
+                b = (row - 1) / 64;
+                bit = (row - 1) % 64;
+                mask = (bottom(b) % 64 == 0 ? ~0ULL : (1ULL << (bottom(b) % 64)) - 1) & ~((2ULL << bit) - 1);
+                value = (long long) blocks[b].score - __builtin_popcountll(blocks[b].p & mask) +
+                        __builtin_popcountll(blocks[b].m & mask);
+
+                if (value > k) {
+                    return maxDistance + 1;
+                }
+            }
+        }
+
+        return blocks[ep.blocks - 1].score <= maxDistance ? blocks[ep.blocks - 1].score : maxDistance + 1;
+    }
+
+    // Get the Levenshtein distance between the sequences of two DNAStrings (`s` and `t`), which may differ in length
+    unsigned int editDistance(DNAString &s, DNAString &t) {
+        return editDistance(s.getSequenceView(), t.getSequenceView());
+    }
+
+    // Get the Levenshtein distance between two sequence views (`s` and `t`) with the bit-parallel algorithm of Myers, 64
+    // rows of the shorter one per word
+    unsigned int editDistance(SequenceView s, SequenceView t) {
+        return editDistance(s, t, std::max(s.length(), t.length()));
+    }
+
+    // Get the Levenshtein distance between `s` and `t` if it is at most `maxDistance`, and `maxDistance` + 1 otherwise. Only
+    // a band of 2 * `maxDistance` + 1 diagonals is computed, and the run stops as soon as the limit cannot be met.
+    unsigned int editDistance(SequenceView s, SequenceView t, unsigned int maxDistance) {
+        EditPattern ep;
+        std::vector<EditBlock> blocks;
+
+        if (s.length() > t.length()) {
+            std::swap(s, t);
+        }
+
+        buildEditPattern(s, ep);
+
+        return editDistanceBanded(ep, t, maxDistance, blocks);
+    }
+
+    // Get the Levenshtein distance from `query` to every sequence in `targets`, capped at `maxDistance` + 1 like the banded
+    // editDistance. The match bits of the query are built once and the targets are spread across `threads` threads.
+    std::vector<unsigned int> editDistances(SequenceView query, const std::vector<SequenceView> &targets,
+                                            unsigned int maxDistance, unsigned int threads) {
+        const size_t TASK_TARGETS = 256;
+        std::vector<unsigned int> distances(targets.size());
+        EditPattern ep;
+
+        buildEditPattern(query, ep);
+
+        parallelFor((targets.size() + TASK_TARGETS - 1) / TASK_TARGETS, threads, [&](size_t task) {
+            std::vector<EditBlock> blocks;
+            size_t end = std::min(targets.size(), (task + 1) * TASK_TARGETS);
+            size_t i;
+
+            for (i = task * TASK_TARGETS; i < end; ++i) {
+                distances[i] = editDistanceBanded(ep, targets[i], maxDistance, blocks);
+            }
+        });
+
+        return distances;
+    }
+
+    // Get every pair of the DNAStrings in `vec` that are at most `maxDistance` edits apart, for example reads or UMIs to
+    // merge when deduplicating. Every sequence is the pattern of one work item, compared against the sequences after it.
+    // Pairs are sorted by (first, second).
+    std::vector<EditDistancePair> editDistancePairs(std::vector<DNAString> &vec, unsigned int maxDistance, unsigned int threads) {
+        std::vector<SequenceView> views(vec.size());
+        std::vector<std::vector<EditDistancePair>> rows(vec.size());
+        std::vector<EditDistancePair> pairs;
+        size_t i;
+
+        for (i = 0; i < vec.size(); ++i) {
+            views[i] = vec[i].getSequenceView();
+        }
+
+        parallelFor(vec.size(), threads, [&](size_t i) {
+            EditPattern ep;
+            std::vector<EditBlock> blocks;
+            unsigned int d;
+            size_t j;
+
+            buildEditPattern(views[i], ep);
+
+            for (j = i + 1; j < views.size(); ++j) {
+                if ((d = editDistanceBanded(ep, views[j], maxDistance, blocks)) <= maxDistance) {
+                    rows[i].push_back(EditDistancePair{(unsigned int) i, (unsigned int) j, d});
+                }
+            }
+        });
+
+        for (i = 0; i < rows.size(); ++i) {
+            pairs.insert(pairs.end(), rows[i].begin(), rows[i].end());
+        }
+
+        return pairs;
     }
 
     // Calculate the total mass of a protein `as` in daltons based on a mass table `mt`.
     double proteinMass(bioinfo::AAString &as, const MassTable &mt) {
+        return proteinMass(as.getSequenceView(), mt);
+    }
+
+    // Calculate the total mass in daltons of the protein sequence viewed by `s` based on a mass table `mt`.
+    double proteinMass(SequenceView s, const MassTable &mt) {
         double pm = 0.0;
-        unsigned int i;
-        unsigned int asLength = as.getSequenceLength();
         MassTable::const_iterator it;
-        char currAA;
 
-        for (i = 0; i < asLength; ++i) {
-            currAA = as.getSequence().at(i);
+        for (char currAA : s) {
             it = mt.find(currAA);
 
             if (it != mt.end()) {
-                pm += mt.at(currAA);
+                pm += it->second;
             }
         }
 
@@ -122,50 +711,1241 @@ namespace bioinfo {
     // Calculate how many possible mRNA strands an inputted protein sequence `as` could of come from applied with the modulus 
     // operator at a value of `m`.
     unsigned int inferredRNACount(AAString &as, const AATranscribableUnitTable &ut, unsigned int m) {
+        return inferredRNACount(as.getSequenceView(), ut, m);
+    }
+
+    // Calculate how many possible mRNA strands the protein sequence viewed by `s` could of come from, modulo `m`.
+    unsigned int inferredRNACount(SequenceView s, const AATranscribableUnitTable &ut, unsigned int m) {
         unsigned int i;
-        unsigned int asLength = as.getSequenceLength();
         unsigned int result = 0;
 
         AATranscribableUnitTable::const_iterator it;
-        unsigned char tUnits;
-        char currAA;
 
-        if (asLength > 0) {
-            for (i = 1; i < asLength; ++i) {
-                currAA = as.getSequence().at(i);
-                it = ut.find(currAA);
+        for (i = 1; i < s.length(); ++i) {
+            it = ut.find(s[i]);
 
-                if (it != ut.end() && result != 0) {
-                    result = (result * ut.at(currAA)) % m;
-                } else if (it != ut.end() && result == 0) {
-                    result = ut.at(currAA);
-                }
+            if (it != ut.end() && result != 0) {
+                result = (result * it->second) % m;
+            } else if (it != ut.end() && result == 0) {
+                result = it->second;
             }
         }
 
         return result;
     }
 
+    // Return whether removing the non-overlapping `ranges` of `seq` (sorted by start) leaves a match of a pattern of `matcher`
+    // after pattern `after` that crosses the join left by `ranges[r]`. Only the up to `span` - 1 kept bases on either side of
+    // the join are scanned, where `span` is the length of the longest pattern.
+    static bool matchesAcrossJoin(SequenceView seq, const std::vector<std::pair<size_t, size_t>> &ranges, size_t r,
+                                  const MotifMatcher &matcher, unsigned int after, size_t span) {
+        std::string window;
+        std::vector<MotifHit> hits;
+        std::vector<MotifHit>::iterator hit;
+        size_t left;
+        size_t pos;
+        size_t j;
+
+        if (span < 2) {
+            return false;
+        }
+
+        // Kept bases before the join, walking back over ranges that end where the walk is
+        for (pos = ranges[r].first, j = r; window.length() < span - 1 && pos > 0; ) {
+            if (j > 0 && ranges[j - 1].second == pos) {
+                pos = ranges[--j].first;
+            } else {
+                window += seq[--pos];
+            }
+        }
+
+        std::reverse(window.begin(), window.end());
+        left = window.length();
+
+        // Kept bases after the join, skipping ranges that start where the walk is
+        for (pos = ranges[r].second, j = r + 1; window.length() - left < span - 1 && pos < seq.length(); ) {
+            if (j < ranges.size() && ranges[j].first == pos) {
+                pos = ranges[j++].second;
+            } else {
+                window += seq[pos++];
+            }
+        }
+
+        hits = matcher.findAll(SequenceView(window), true);
+
+        for (hit = hits.begin(); hit != hits.end(); ++hit) {
+            if (hit->pattern > after && hit->position < left &&
+                hit->position + matcher.getPattern(hit->pattern).length() > left) {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
     // Remove the introns of a RNAString `s` given by a vector of RNAString objects `introns`. The sequence of each item in the 
     // vector is used as the intron sequence and the first occurrence of each sequence is removed from the original RNA sequence
-    // given by `s`.
+    // given by `s`, one intron after the other. Every intron is located in one pass of a MotifMatcher over the pre-mRNA and the
+    // exons between them are copied out once. That only matches the one-at-a-time removal when no earlier removal creates or
+    // moves a match of a later intron, so each join is scanned once, when its intron is removed, for the introns after it. If
+    // two first occurrences overlap or a later intron matches across a join, the introns are removed one at a time instead.
     RNAString spliceRNA(RNAString &s, std::vector<RNAString> &introns) {
         RNAString mrna = RNAString(s.getHeader(), std::string(""));
-        std::string seq = s.getSequence();
+        SequenceView seq = s.getSequenceView();
+        std::string spliced;
+
+        MotifMatcher matcher(introns);
+        std::vector<long int> first = matcher.findFirst(seq);
+        std::vector<std::pair<size_t, size_t>> removed; // Sorted ranges removed by the introns checked so far
+        std::vector<std::pair<size_t, size_t>>::iterator it;
+        std::pair<size_t, size_t> range;
+        std::string::size_type loc;
+
+        size_t i;
+        size_t pos = 0;
+        size_t span = 0;
+        bool sequential = false;
 
-        std::vector<RNAString>::iterator it;
-        unsigned int loc;
+        for (i = 0; i < introns.size(); ++i) {
+            span = std::max(span, matcher.getPattern(i).length());
+        }
+
+        for (i = 0; i < introns.size() && !sequential; ++i) {
+            if (first[i] < 0) {
+                continue;
+            }
+
+            range = std::make_pair((size_t) first[i], first[i] + matcher.getPattern(i).length());
+            it = std::upper_bound(removed.begin(), removed.end(), range);
+            sequential = (it != removed.end() && it->first < range.second) ||
+                         (it != removed.begin() && (it - 1)->second > range.first);
+            it = removed.insert(it, range);
 
-        // For every intron loop through pre-mrna sequence and remove the intron
-        for (it = introns.begin(); it != introns.end(); it++) {
-            loc = seq.find(it->getSequence());
+            // Every later intron sees the sequence with this join in it, and a match across it would be found before that
+            // intron's first match in the original. A match made by this join and a later one crosses the later join, so
+            // it is caught when that join is scanned.
+            sequential = sequential || matchesAcrossJoin(seq, removed, it - removed.begin(), matcher, i, span);
+        }
+
+        if (sequential) {
+            spliced = seq.toString();
 
-            if (loc != std::string::npos) {
-                seq.erase(loc, it->getSequenceLength());
+            for (i = 0; i < introns.size(); ++i) {
+                loc = spliced.find(matcher.getPattern(i));
+
+                if (loc != std::string::npos) {
+                    spliced.erase(loc, matcher.getPattern(i).length());
+                }
             }
+
+            mrna.setSequence(std::move(spliced));
+            return mrna;
+        }
+
+        spliced.reserve(seq.length());
+
+        for (it = removed.begin(); it != removed.end(); it++) {
+            spliced.append(seq.data() + pos, it->first - pos);
+            pos = it->second;
         }
 
-        mrna.setSequence(seq);
+        spliced.append(seq.data() + pos, seq.length() - pos);
+
+        mrna.setSequence(std::move(spliced));
         return mrna;
     }
-}
\ No newline at end of file
+
+    // Find every open reading frame (start codon to the next in-frame stop codon) of at least `minLength` amino acids in all
+    // six frames of a DNAString `ds`. A start codon is any codon that `ct` translates to 'M'. With `nested` set to false only
+    // the first start codon before each stop is used, otherwise every start codon gives its own ORF.
+    std::vector<OpenReadingFrame> findORFs(DNAString &ds, const CodonTable &ct, unsigned int minLength, bool nested) {
+        std::vector<OpenReadingFrame> orfs;
+        std::vector<std::string> frames = ct.translateSixFrames(ds.getSequence());
+        std::vector<size_t> starts;
+        std::vector<size_t>::iterator it;
+
+        OpenReadingFrame orf;
+        unsigned int n = ds.getSequenceLength();
+        unsigned int f;
+        unsigned int offset;
+        size_t c;
+
+        for (f = 0; f < 6; ++f) {
+            offset = f % 3;
+            starts.clear();
+
+            for (c = 0; c < frames[f].length(); ++c) {
+                if (frames[f][c] == 'M' && (nested || starts.empty())) {
+                    starts.push_back(c);
+                } else if (frames[f][c] == '*') {
+                    for (it = starts.begin(); it != starts.end(); it++) {
+                        if (c - *it < minLength) {
+                            continue;
+                        }
+
+                        orf.protein = frames[f].substr(*it, c - *it);
+
+                        if (f < 3) {
+                            orf.frame = offset + 1;
+                            orf.start = offset + *it * 3;
+                            orf.end = offset + c * 3 + 3;
+                        } else {
+                            orf.frame = -(int) (offset + 1);
+                            orf.start = n - (offset + c * 3 + 3);
+                            orf.end = n - (offset + *it * 3);
+                        }
+
+                        orfs.push_back(orf);
+                    }
+
+                    starts.clear();
+                }
+            }
+        }
+
+        return orfs;
+    }
+
+    // --------------------------------------------------------------------------
+
+    typedef unsigned __int128 WideKmer;
+
+    const size_t KMER_TASK_BASES = 1 << 20; // K-mer start positions handled by one task of the counter
+    const size_t KMER_FLUSH_SIZE = 512; // K-mers buffered per shard before the shard lock is taken
+    const size_t KMER_PREFETCH_DISTANCE = 8; // How many k-mers ahead a flush prefetches the table slot
+    const size_t KMER_MIN_MEMORY_BUDGET = 16 << 20; // Smallest memory budget of the out-of-core counter
+    const size_t KMER_MAX_BUCKETS = 512; // Most bucket files the out-of-core counter keeps open at once
+
+    // Slot of a k-mer table, the key and its count side by side so a probe touches one cache line
+    template <typename Key> struct KmerSlot {
+        Key key;
+        unsigned long int count; // 0 marks an empty slot
+    };
+
+    // Hash table of one shard of the k-mer counter, open addressing with linear probing. Only touched with `lock` held.
+    template <typename Key> struct KmerShard {
+        std::mutex lock;
+        std::vector<KmerSlot<Key>> slots;
+        size_t used = 0;
+    };
+
+    // Get the 2-bit code of a base, or 4 for anything that is not A, C, G or T/U.
+    static unsigned int kmerBaseCode(char c) {
+        switch (c) {
+            case 'A': case 'a': return NucleotideCodes::A;
+            case 'C': case 'c': return NucleotideCodes::C;
+            case 'G': case 'g': return NucleotideCodes::G;
+            case 'T': case 't': case 'U': case 'u': return NucleotideCodes::T;
+            default: return 4;
+        }
+    }
+
+    // Scramble the bits of a k-mer code so neighbouring codes land in different shards and slots (the splitmix64 finalizer).
+    static uint64_t mixKmer(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    static uint64_t mixKmer(WideKmer x) {
+        return mixKmer((uint64_t) x ^ mixKmer((uint64_t) (x >> 64)));
+    }
+
+    // Call `emit(code)` for every k-mer of `s` made only of A, C, G and T, in order of position. With `canonical` set the code
+    // is the smaller of the k-mer and its reverse complement, the same pairing `reverseComplement` gives, and as A < C < G < T
+    // the smaller code is also the lexicographically smaller k-mer.
+    template <typename Key, typename F> static void forEachKmer(SequenceView s, unsigned int k, bool canonical, F emit) {
+        const Key mask = 2 * k == sizeof(Key) * 8 ? ~(Key) 0 : ((Key) 1 << (2 * k)) - 1;
+        const unsigned int shift = 2 * (k - 1);
+
+        Key forward = 0;
+        Key reverse = 0;
+        unsigned int valid = 0;
+        unsigned int code;
+        size_t i;
+
+        for (i = 0; i < s.length(); ++i) {
+            code = kmerBaseCode(s[i]);
+
+            if (code > NucleotideCodes::T) {
+                valid = 0;
+                continue;
+            }
+
+            forward = ((forward << 2) | code) & mask;
+            reverse = (reverse >> 2) | ((Key) (NucleotideCodes::T - code) << shift);
+
+            if (valid < k) {
+                ++valid;
+            }
+
+            if (valid == k) {
+                emit(canonical && reverse < forward ? reverse : forward);
+            }
+        }
+    }
+
+    // Add `n` to the count of `key`, whose mixed code is `hash`, in `shard`, doubling the table once it is three quarters full.
+    template <typename Key> static void insertKmer(KmerShard<Key> &shard, Key key, uint64_t hash, unsigned long int n) {
+        size_t slot;
+        size_t sizeMask;
+
+        if ((shard.used + 1) * 4 > shard.slots.size() * 3) {
+            std::vector<KmerSlot<Key>> old(std::max<size_t>(1024, shard.slots.size() * 2), KmerSlot<Key>{0, 0});
+
+            old.swap(shard.slots);
+            shard.used = 0;
+
+            for (const KmerSlot<Key> &entry : old) {
+                if (entry.count != 0) {
+                    insertKmer(shard, entry.key, mixKmer(entry.key), entry.count);
+                }
+            }
+        }
+
+        sizeMask = shard.slots.size() - 1;
+
+        for (slot = hash & sizeMask; shard.slots[slot].count != 0 && shard.slots[slot].key != key;
+             slot = (slot + 1) & sizeMask) {}
+
+        if (shard.slots[slot].count == 0) {
+            shard.slots[slot].key = key;
+            ++shard.used;
+        }
+
+        shard.slots[slot].count += n;
+    }
+
+    static void appendKmerWords(std::vector<uint64_t> &words, uint64_t key) {
+        words.push_back(key);
+    }
+
+    static void appendKmerWords(std::vector<uint64_t> &words, WideKmer key) {
+        words.push_back((uint64_t) (key >> 64));
+        words.push_back((uint64_t) key);
+    }
+
+    // Add one to the count of each of the `n` k-mers at `keys` in `shard`. The whole block is hashed into `hashes` first so the
+    // slot of a k-mer a few places ahead can be prefetched while this one is inserted, overlapping the cache misses of the
+    // random probes.
+    template <typename Key> static void insertKmerBlock(KmerShard<Key> &shard, const Key *keys, size_t n, uint64_t *hashes) {
+        size_t q;
+
+        for (q = 0; q < n; ++q) {
+            hashes[q] = mixKmer(keys[q]);
+        }
+
+        for (q = 0; q < n; ++q) {
+            if (q + KMER_PREFETCH_DISTANCE < n && !shard.slots.empty()) {
+                __builtin_prefetch(&shard.slots[hashes[q + KMER_PREFETCH_DISTANCE] & (shard.slots.size() - 1)], 1);
+            }
+
+            insertKmer(shard, keys[q], hashes[q], 1);
+        }
+    }
+
+    // Move the k-mers of `shard` to the end of `entries` and free its table.
+    template <typename Key> static void drainKmerShard(KmerShard<Key> &shard, std::vector<std::pair<Key, unsigned long int>> &entries) {
+        for (const KmerSlot<Key> &entry : shard.slots) {
+            if (entry.count != 0) {
+                entries.push_back(std::make_pair(entry.key, entry.count));
+            }
+        }
+
+        std::vector<KmerSlot<Key>>().swap(shard.slots);
+        shard.used = 0;
+    }
+
+    // Sort the distinct k-mers of `entries` and turn them into KmerCounts.
+    template <typename Key> static KmerCounts makeKmerCounts(std::vector<std::pair<Key, unsigned long int>> &entries, unsigned int k,
+                                                             bool canonical) {
+        std::vector<uint64_t> words;
+        std::vector<unsigned long int> counts;
+        size_t i;
+
+        std::sort(entries.begin(), entries.end(), [](const std::pair<Key, unsigned long int> &a,
+                                                     const std::pair<Key, unsigned long int> &b) {
+            return a.first < b.first;
+        });
+
+        words.reserve(entries.size() * (sizeof(Key) / sizeof(uint64_t)));
+        counts.reserve(entries.size());
+
+        for (i = 0; i < entries.size(); ++i) {
+            appendKmerWords(words, entries[i].first);
+            counts.push_back(entries[i].second);
+        }
+
+        return KmerCounts(k, canonical, std::move(words), std::move(counts));
+    }
+
+    // Range [start, end) of sequence `seq` whose k-mers one task of the counter handles
+    struct KmerRange {
+        size_t seq;
+        size_t start;
+        size_t end;
+    };
+
+    // Cut `seqs` into tasks of about KMER_TASK_BASES k-mers, long sequences split with k - 1 bases of overlap and short ones
+    // grouped. Task t covers ranges[taskStart[t], taskStart[t + 1]).
+    static void splitKmerTasks(const std::vector<SequenceView> &seqs, unsigned int k, std::vector<KmerRange> &ranges,
+                               std::vector<size_t> &taskStart) {
+        size_t taskKmers = 0;
+        size_t start;
+        size_t end;
+        size_t i;
+
+        ranges.clear();
+        taskStart.assign(1, 0);
+
+        for (i = 0; i < seqs.size(); ++i) {
+            for (start = 0; start + k <= seqs[i].length(); start += KMER_TASK_BASES) {
+                end = std::min(seqs[i].length(), start + KMER_TASK_BASES + k - 1);
+                ranges.push_back(KmerRange{i, start, end});
+                taskKmers += end - start - k + 1;
+
+                if (taskKmers >= KMER_TASK_BASES) {
+                    taskStart.push_back(ranges.size());
+                    taskKmers = 0;
+                }
+            }
+        }
+
+        if (ranges.size() > taskStart.back()) {
+            taskStart.push_back(ranges.size());
+        }
+    }
+
+    // Count the k-mers of `seqs` with keys of type `Key`. Every task hashes its k-mers into per shard buffers that are added
+    // to the shared shard tables a lock at a time.
+    template <typename Key> static KmerCounts countKmersWith(const std::vector<SequenceView> &seqs, unsigned int k, bool canonical,
+                                                             unsigned int threads) {
+        std::vector<KmerRange> ranges;
+        std::vector<size_t> taskStart;
+        std::vector<std::pair<Key, unsigned long int>> entries;
+        size_t distinct = 0;
+        size_t shardCount;
+        size_t i;
+
+        threads = resolveThreadCount(threads);
+        shardCount = threads * 8;
+
+        std::vector<KmerShard<Key>> shards(shardCount);
+
+        splitKmerTasks(seqs, k, ranges, taskStart);
+
+        parallelFor(taskStart.size() - 1, threads, [&](size_t t) {
+            std::vector<std::vector<Key>> pending(shardCount);
+            std::vector<uint64_t> hashes(KMER_FLUSH_SIZE);
+            size_t r;
+            size_t sh;
+
+            auto flush = [&](size_t target) {
+                std::lock_guard<std::mutex> guard(shards[target].lock);
+
+                insertKmerBlock(shards[target], pending[target].data(), pending[target].size(), hashes.data());
+                pending[target].clear();
+            };
+
+            for (r = taskStart[t]; r < taskStart[t + 1]; ++r) {
+                forEachKmer<Key>(seqs[ranges[r].seq].subsequence(ranges[r].start, ranges[r].end - ranges[r].start), k, canonical,
+                                 [&](Key key) {
+                    sh = (mixKmer(key) >> 40) % shardCount;
+                    pending[sh].push_back(key);
+
+                    if (pending[sh].size() >= KMER_FLUSH_SIZE) {
+                        flush(sh);
+                    }
+                });
+            }
+
+            for (sh = 0; sh < shardCount; ++sh) {
+                flush(sh);
+            }
+        });
+
+        for (i = 0; i < shardCount; ++i) {
+            distinct += shards[i].used;
+        }
+
+        entries.reserve(distinct);
+
+        for (i = 0; i < shardCount; ++i) {
+            drainKmerShard(shards[i], entries);
+        }
+
+        return makeKmerCounts(entries, k, canonical);
+    }
+
+    static void checkKmerLength(unsigned int k) {
+        if (k == 0 || k > MAX_KMER_LENGTH) {
+            throw std::invalid_argument("ERROR: k-mer length must be between 1 and 64!");
+        }
+    }
+
+    // Count the k-mers of the sequence views in `seqs`, picking 64-bit keys for k up to 32 and 128-bit keys above.
+    static KmerCounts countKmerViews(const std::vector<SequenceView> &seqs, unsigned int k, bool canonical, unsigned int threads) {
+        checkKmerLength(k);
+
+        if (k <= NucleotideCodes::BASES_PER_WORD) {
+            return countKmersWith<uint64_t>(seqs, k, canonical, threads);
+        }
+
+        return countKmersWith<WideKmer>(seqs, k, canonical, threads);
+    }
+
+    // Count every k-mer of length `k` in the sequences of `vec` on `threads` threads (0 for one per core). K-mers containing a
+    // base other than A, C, G or T are skipped. With `canonical` set a k-mer and its reverse complement are counted together
+    // under the smaller of the two.
+    KmerCounts countKmers(std::vector<DNAString> &vec, unsigned int k, bool canonical, unsigned int threads) {
+        std::vector<SequenceView> seqs;
+        std::vector<DNAString>::iterator it;
+
+        for (it = vec.begin(); it != vec.end(); it++) {
+            seqs.push_back(it->getSequenceView());
+        }
+
+        return countKmerViews(seqs, k, canonical, threads);
+    }
+
+    // Count every k-mer of length `k` in the records of a SequenceBatch `batch`.
+    KmerCounts countKmers(const SequenceBatch &batch, unsigned int k, bool canonical, unsigned int threads) {
+        std::vector<SequenceView> seqs;
+        size_t i;
+
+        for (i = 0; i < batch.size(); ++i) {
+            seqs.push_back(batch.getSequence(i));
+        }
+
+        return countKmerViews(seqs, k, canonical, threads);
+    }
+
+    // --------------------------------------------------------------------------
+
+    // Count the k-mers of the FASTA file `fn` in two passes that stay within `options.memoryBudget`. The first pass streams the
+    // file a batch at a time and appends every k-mer to one of several bucket files picked by its hash. The second counts the
+    // buckets in memory, several at once, and hands the distinct k-mers of each to `onBucket` (one call at a time). A k-mer
+    // always lands in the same bucket, so every bucket is complete on its own. The bucket files are removed once counted.
+    template <typename Key, typename F> static void countKmerBuckets(const std::string &fn, unsigned int k, bool canonical,
+                                                                    const KmerSpillOptions &options, F onBucket) {
+        static std::atomic<unsigned int> runs(0);
+
+        unsigned int threads = resolveThreadCount(options.threads);
+        uint64_t fileSize;
+        size_t bucketCount;
+        size_t batchBases = options.memoryBudget / 4;
+        size_t flushKeys;
+        size_t b;
+
+        std::ifstream probe(fn, std::ios::binary | std::ios::ate);
+        std::string prefix;
+        std::mutex consumeLock;
+
+        if (!probe.good()) {
+            throw std::invalid_argument("ERROR: countKmersOutOfCore could not open file!");
+        }
+
+        if (options.memoryBudget < KMER_MIN_MEMORY_BUDGET) {
+            throw std::invalid_argument("ERROR: countKmersOutOfCore memory budget is too small!");
+        }
+
+        // Assume every k-mer of the file may be distinct, and give each of the buckets counted at once an equal share of the
+        // budget for its table
+        fileSize = probe.tellg();
+        probe.close();
+        bucketCount = options.buckets;
+
+        if (bucketCount == 0) {
+            bucketCount = (fileSize * 4 * sizeof(KmerSlot<Key>) * threads + options.memoryBudget - 1) / options.memoryBudget;
+            bucketCount = std::min<size_t>(std::max<size_t>(bucketCount, 1), KMER_MAX_BUCKETS);
+        }
+
+        flushKeys = options.memoryBudget / 4 / (threads * bucketCount * sizeof(Key));
+        flushKeys = std::min<size_t>(std::max<size_t>(flushKeys, 64), 1 << 16);
+        prefix = options.tempDirectory + "/kmers." + std::to_string(getpid()) + "." + std::to_string(runs++) + ".";
+
+        std::vector<std::FILE *> files(bucketCount, NULL);
+        std::vector<std::mutex> locks(bucketCount);
+
+        auto bucketName = [&](size_t bucket) {
+            return prefix + std::to_string(bucket) + ".bin";
+        };
+
+        try {
+            FASTAReader reader(fn);
+            SequenceBatch batch;
+            std::vector<SequenceView> seqs;
+            std::vector<KmerRange> ranges;
+            std::vector<size_t> taskStart;
+            size_t i;
+
+            for (b = 0; b < bucketCount; ++b) {
+                files[b] = std::fopen(bucketName(b).c_str(), "wb");
+
+                if (files[b] == NULL) {
+                    throw std::runtime_error("ERROR: countKmersOutOfCore could not create a bucket file!");
+                }
+            }
+
+            while (reader.nextBatch(batch, SIZE_MAX, batchBases) > 0) {
+                seqs.clear();
+
+                for (i = 0; i < batch.size(); ++i) {
+                    seqs.push_back(batch.getSequence(i));
+                }
+
+                splitKmerTasks(seqs, k, ranges, taskStart);
+
+                parallelFor(taskStart.size() - 1, threads, [&](size_t t) {
+                    std::vector<std::vector<Key>> pending(bucketCount);
+                    size_t r;
+                    size_t target;
+
+                    auto flush = [&](size_t bucket) {
+                        std::lock_guard<std::mutex> guard(locks[bucket]);
+
+                        if (std::fwrite(pending[bucket].data(), sizeof(Key), pending[bucket].size(), files[bucket]) !=
+                            pending[bucket].size()) {
+                            throw std::runtime_error("ERROR: countKmersOutOfCore failed to write a bucket file!");
+                        }
+
+                        pending[bucket].clear();
+                    };
+
+                    for (r = taskStart[t]; r < taskStart[t + 1]; ++r) {
+                        forEachKmer<Key>(seqs[ranges[r].seq].subsequence(ranges[r].start, ranges[r].end - ranges[r].start), k,
+                                         canonical, [&](Key key) {
+                            target = (mixKmer(key) >> 32) % bucketCount;
+                            pending[target].push_back(key);
+
+                            if (pending[target].size() >= flushKeys) {
+                                flush(target);
+                            }
+                        });
+                    }
+
+                    for (target = 0; target < bucketCount; ++target) {
+                        flush(target);
+                    }
+                });
+            }
+
+            for (b = 0; b < bucketCount; ++b) {
+                if (std::fclose(files[b]) != 0) {
+                    files[b] = NULL;
+                    throw std::runtime_error("ERROR: countKmersOutOfCore failed to write a bucket file!");
+                }
+
+                files[b] = NULL;
+            }
+
+            parallelFor(bucketCount, threads, [&](size_t bucket) {
+                KmerShard<Key> table;
+                std::vector<Key> block(KMER_FLUSH_SIZE);
+                std::vector<uint64_t> hashes(KMER_FLUSH_SIZE);
+                std::vector<std::pair<Key, unsigned long int>> entries;
+                std::FILE *in = std::fopen(bucketName(bucket).c_str(), "rb");
+                size_t got;
+
+                if (in == NULL) {
+                    throw std::runtime_error("ERROR: countKmersOutOfCore could not open a bucket file!");
+                }
+
+                while ((got = std::fread(block.data(), sizeof(Key), block.size(), in)) > 0) {
+                    insertKmerBlock(table, block.data(), got, hashes.data());
+                }
+
+                std::fclose(in);
+                std::remove(bucketName(bucket).c_str());
+
+                entries.reserve(table.used);
+                drainKmerShard(table, entries);
+
+                std::lock_guard<std::mutex> guard(consumeLock);
+                onBucket(entries);
+            });
+        } catch (...) {
+            for (b = 0; b < bucketCount; ++b) {
+                if (files[b] != NULL) {
+                    std::fclose(files[b]);
+                }
+
+                std::remove(bucketName(b).c_str());
+            }
+
+            throw;
+        }
+    }
+
+    // Count every k-mer of length `k` in the FASTA file `fn` without holding the file in memory, see `countKmerBuckets`. The
+    // counts arrive one bucket at a time through `consume`; the buckets hold disjoint sets of k-mers, each sorted, so the whole
+    // result never has to fit in memory at once.
+    void countKmersOutOfCore(const std::string &fn, unsigned int k, bool canonical, const KmerSpillOptions &options,
+                             const std::function<void(KmerCounts &)> &consume) {
+        checkKmerLength(k);
+
+        if (k <= NucleotideCodes::BASES_PER_WORD) {
+            countKmerBuckets<uint64_t>(fn, k, canonical, options, [&](std::vector<std::pair<uint64_t, unsigned long int>> &entries) {
+                KmerCounts counts = makeKmerCounts(entries, k, canonical);
+                consume(counts);
+            });
+        } else {
+            countKmerBuckets<WideKmer>(fn, k, canonical, options, [&](std::vector<std::pair<WideKmer, unsigned long int>> &entries) {
+                KmerCounts counts = makeKmerCounts(entries, k, canonical);
+                consume(counts);
+            });
+        }
+    }
+
+    // Count every k-mer of length `k` in the FASTA file `fn` without holding the file in memory, and merge the buckets into one
+    // KmerCounts. Only the distinct k-mers have to fit in memory.
+    KmerCounts countKmersOutOfCore(const std::string &fn, unsigned int k, bool canonical, const KmerSpillOptions &options) {
+        checkKmerLength(k);
+
+        if (k <= NucleotideCodes::BASES_PER_WORD) {
+            std::vector<std::pair<uint64_t, unsigned long int>> all;
+
+            countKmerBuckets<uint64_t>(fn, k, canonical, options, [&](std::vector<std::pair<uint64_t, unsigned long int>> &entries) {
+                all.insert(all.end(), entries.begin(), entries.end());
+            });
+
+            return makeKmerCounts(all, k, canonical);
+        }
+
+        std::vector<std::pair<WideKmer, unsigned long int>> all;
+
+        countKmerBuckets<WideKmer>(fn, k, canonical, options, [&](std::vector<std::pair<WideKmer, unsigned long int>> &entries) {
+            all.insert(all.end(), entries.begin(), entries.end());
+        });
+
+        return makeKmerCounts(all, k, canonical);
+    }
+
+    // --------------------------------------------------------------------------
+
+    // Create the counts of `k`-mers from their sorted codes `words` and matching `counts`.
+    KmerCounts::KmerCounts(unsigned int k, bool canonical, std::vector<uint64_t> words, std::vector<unsigned long int> counts) {
+        (*this).k = k;
+        (*this).canonical = canonical;
+        (*this).words = std::move(words);
+        (*this).counts = std::move(counts);
+    }
+
+    // Get the length of the counted k-mers
+    unsigned int KmerCounts::getK() const {
+        return (*this).k;
+    }
+
+    // Check if a k-mer and its reverse complement were counted together
+    bool KmerCounts::isCanonical() const {
+        return (*this).canonical;
+    }
+
+    // Get how many distinct k-mers were counted
+    size_t KmerCounts::size() const {
+        return (*this).counts.size();
+    }
+
+    // Get how many k-mers were counted, repeats included
+    unsigned long int KmerCounts::getTotal() const {
+        unsigned long int total = 0;
+
+        for (unsigned long int c : (*this).counts) {
+            total += c;
+        }
+
+        return total;
+    }
+
+    // Get the k-mer with index `i`, k-mers being sorted lexicographically
+    std::string KmerCounts::getKmer(size_t i) const {
+        const char BASES[4] = {'A', 'C', 'G', 'T'};
+        std::string kmer((*this).k, 'A');
+        WideKmer code;
+        unsigned int j;
+
+        if (i >= (*this).size()) {
+            throw std::out_of_range("ERROR: KmerCounts index is out of range!");
+        }
+
+        code = (*this).k > NucleotideCodes::BASES_PER_WORD ?
+            ((WideKmer) (*this).words[2 * i] << 64) | (*this).words[2 * i + 1] : (WideKmer) (*this).words[i];
+
+        for (j = (*this).k; j-- > 0; code >>= 2) {
+            kmer[j] = BASES[(unsigned int) (code & 3)];
+        }
+
+        return kmer;
+    }
+
+    // Get the count of the k-mer with index `i`
+    unsigned long int KmerCounts::getCount(size_t i) const {
+        return (*this).counts.at(i);
+    }
+
+    // Get the index of `kmer`, or `size()` if it was never seen. A binary search over the sorted codes.
+    size_t KmerCounts::find(SequenceView kmer) const {
+        bool wide = (*this).k > NucleotideCodes::BASES_PER_WORD;
+        bool found = false;
+        WideKmer key = 0;
+        WideKmer mid;
+        size_t lo = 0;
+        size_t hi = (*this).size();
+        size_t m;
+
+        if (kmer.length() != (*this).k) {
+            return (*this).size();
+        }
+
+        forEachKmer<WideKmer>(kmer, (*this).k, (*this).canonical, [&](WideKmer code) {
+            key = code;
+            found = true;
+        });
+
+        while (found && lo < hi) {
+            m = lo + (hi - lo) / 2;
+            mid = wide ? ((WideKmer) (*this).words[2 * m] << 64) | (*this).words[2 * m + 1] : (WideKmer) (*this).words[m];
+
+            if (mid == key) {
+                return m;
+            } else if (mid < key) {
+                lo = m + 1;
+            } else {
+                hi = m;
+            }
+        }
+
+        return (*this).size();
+    }
+
+    // Get how many times `kmer` was counted, or 0 if it was never seen.
+    unsigned long int KmerCounts::count(SequenceView kmer) const {
+        size_t i = (*this).find(kmer);
+
+        return i < (*this).size() ? (*this).counts[i] : 0;
+    }
+
+    // Get how many distinct k-mers were seen each number of times: entry c is the number of k-mers counted c times, and the
+    // last entry also takes every k-mer counted more than `maxCount` times.
+    std::vector<unsigned long int> KmerCounts::histogram(unsigned long int maxCount) const {
+        std::vector<unsigned long int> hist(maxCount + 1, 0);
+
+        for (unsigned long int c : (*this).counts) {
+            ++hist[std::min(c, maxCount)];
+        }
+
+        return hist;
+    }
+
+    // Get the `n` most frequent k-mers, most frequent first and ties in lexicographic order.
+    std::vector<KmerCount> KmerCounts::topN(size_t n) const {
+        std::vector<size_t> order((*this).size());
+        std::vector<KmerCount> top;
+        size_t i;
+
+        for (i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+
+        n = std::min(n, order.size());
+
+        std::partial_sort(order.begin(), order.begin() + n, order.end(), [&](size_t a, size_t b) {
+            return (*this).counts[a] != (*this).counts[b] ? (*this).counts[a] > (*this).counts[b] : a < b;
+        });
+
+        for (i = 0; i < n; ++i) {
+            top.push_back(KmerCount{(*this).getKmer(order[i]), (*this).counts[order[i]]});
+        }
+
+        return top;
+    }
+
+    // --------------------------------------------------------------------------
+
+    const size_t SKETCH_BATCH_BASES = 64 << 20; // Bases read from a FASTA file per batch while sketching it
+    const char SKETCH_FILE_MAGIC[8] = {'B', 'I', 'O', 'S', 'K', 'C', 'H', '1'};
+
+    // Call `emit(hash)` with the hash of every canonical k-mer of `s`.
+    template <typename F> static void forEachKmerHash(SequenceView s, unsigned int k, F emit) {
+        if (k <= NucleotideCodes::BASES_PER_WORD) {
+            forEachKmer<uint64_t>(s, k, true, [&](uint64_t key) {
+                emit(mixKmer(key));
+            });
+        } else {
+            forEachKmer<WideKmer>(s, k, true, [&](WideKmer key) {
+                emit(mixKmer(key));
+            });
+        }
+    }
+
+    // Create an empty sketch of canonical `k`-mers. `size` is the number of hashes kept in BOTTOM_K mode and the scale factor
+    // in FRACTIONAL mode.
+    MinHashSketch::MinHashSketch(unsigned int k, SketchMode mode, unsigned long int size, std::string name) {
+        checkKmerLength(k);
+
+        if (size == 0) {
+            throw std::invalid_argument("ERROR: MinHashSketch size cannot be 0!");
+        }
+
+        (*this).name = std::move(name);
+        (*this).k = k;
+        (*this).mode = mode;
+        (*this).size = size;
+    }
+
+    // Create the sketch of the sequence of a DNAString `ds`, named after its header.
+    MinHashSketch::MinHashSketch(DNAString &ds, unsigned int k, SketchMode mode, unsigned long int size)
+        : MinHashSketch(k, mode, size, ds.getHeader()) {
+        (*this).add(ds.getSequenceView());
+    }
+
+    // Get the name of the sketch
+    const std::string &MinHashSketch::getName() const {
+        return (*this).name;
+    }
+
+    // Change the name of the sketch
+    void MinHashSketch::setName(std::string n) {
+        (*this).name = std::move(n);
+    }
+
+    // Get the length of the sketched k-mers
+    unsigned int MinHashSketch::getK() const {
+        return (*this).k;
+    }
+
+    // Get how the sketch picks the hashes it keeps
+    SketchMode MinHashSketch::getMode() const {
+        return (*this).mode;
+    }
+
+    // Get the number of hashes kept (BOTTOM_K) or the scale factor (FRACTIONAL)
+    unsigned long int MinHashSketch::getSize() const {
+        return (*this).size;
+    }
+
+    // Get the kept hashes in ascending order
+    const std::vector<uint64_t> &MinHashSketch::getHashes() const {
+        return (*this).hashes;
+    }
+
+    // Merge the unsorted hashes of `batch` into the sketch and drop whatever the mode does not keep. `batch` is left empty.
+    void MinHashSketch::addHashes(std::vector<uint64_t> &batch) {
+        std::vector<uint64_t> merged;
+
+        std::sort(batch.begin(), batch.end());
+        merged.reserve((*this).hashes.size() + batch.size());
+        std::set_union((*this).hashes.begin(), (*this).hashes.end(), batch.begin(), batch.end(), std::back_inserter(merged));
+        merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+
+        if ((*this).mode == SketchMode::BOTTOM_K && merged.size() > (*this).size) {
+            merged.resize((*this).size);
+        }
+
+        (*this).hashes.swap(merged);
+        batch.clear();
+    }
+
+    // Add the canonical k-mers of `s` to the sketch. Hashes that cannot make it into the sketch are dropped before they are
+    // buffered, so a long sequence costs little more than the k-mer roll itself.
+    void MinHashSketch::add(SequenceView s) {
+        const uint64_t threshold = UINT64_MAX / (*this).size;
+        const size_t flushSize = std::max<size_t>(4 * (*this).size, 1 << 16);
+
+        std::vector<uint64_t> batch;
+        uint64_t limit = UINT64_MAX;
+        bool bottom = (*this).mode == SketchMode::BOTTOM_K;
+
+        if (bottom && (*this).hashes.size() == (*this).size) {
+            limit = (*this).hashes.back();
+        }
+
+        forEachKmerHash(s, (*this).k, [&](uint64_t hash) {
+            if (bottom ? hash < limit : hash <= threshold) {
+                batch.push_back(hash);
+
+                if (bottom && batch.size() >= flushSize) {
+                    (*this).addHashes(batch);
+                    limit = (*this).hashes.size() == (*this).size ? (*this).hashes.back() : UINT64_MAX;
+                }
+            }
+        });
+
+        (*this).addHashes(batch);
+    }
+
+    // Add every k-mer of another sketch `other` with the same parameters, giving the sketch of the union of their inputs.
+    void MinHashSketch::merge(const MinHashSketch &other) {
+        std::vector<uint64_t> batch = other.hashes;
+
+        (*this).checkCompatible(other);
+        (*this).addHashes(batch);
+    }
+
+    // Throw if `other` was built with a different k, mode or size, since their hashes cannot be compared.
+    void MinHashSketch::checkCompatible(const MinHashSketch &other) const {
+        if ((*this).k != other.k || (*this).mode != other.mode || (*this).size != other.size) {
+            throw std::invalid_argument("ERROR: MinHashSketch sketches were built with different parameters!");
+        }
+    }
+
+    // Estimate the Jaccard index of the k-mer sets of the two sketches. In BOTTOM_K mode only the `size` smallest hashes of the
+    // union are compared, as Mash does, and in FRACTIONAL mode every kept hash is.
+    double MinHashSketch::jaccard(const MinHashSketch &other) const {
+        std::vector<uint64_t>::const_iterator a = (*this).hashes.begin();
+        std::vector<uint64_t>::const_iterator b = other.hashes.begin();
+        unsigned long int limit = (*this).mode == SketchMode::BOTTOM_K ? (*this).size : ULONG_MAX;
+        unsigned long int unionCount = 0;
+        unsigned long int shared = 0;
+
+        (*this).checkCompatible(other);
+
+        while (unionCount < limit && (a != (*this).hashes.end() || b != other.hashes.end())) {
+            if (b == other.hashes.end() || (a != (*this).hashes.end() && *a < *b)) {
+                ++a;
+            } else if (a == (*this).hashes.end() || *b < *a) {
+                ++b;
+            } else {
+                ++shared;
+                ++a;
+                ++b;
+            }
+
+            ++unionCount;
+        }
+
+        return unionCount == 0 ? 0.0 : (double) shared / unionCount;
+    }
+
+    // Estimate how much of the k-mer set of this sketch is contained in that of `other`. In BOTTOM_K mode only hashes below
+    // the largest hash both sketches can vouch for are counted.
+    double MinHashSketch::containment(const MinHashSketch &other) const {
+        std::vector<uint64_t>::const_iterator a;
+        std::vector<uint64_t>::const_iterator b = other.hashes.begin();
+        uint64_t limit = UINT64_MAX;
+        unsigned long int total = 0;
+        unsigned long int shared = 0;
+
+        (*this).checkCompatible(other);
+
+        if ((*this).mode == SketchMode::BOTTOM_K && !(*this).hashes.empty() && !other.hashes.empty() &&
+            other.hashes.size() == other.size) {
+            limit = other.hashes.back();
+        }
+
+        for (a = (*this).hashes.begin(); a != (*this).hashes.end() && *a <= limit; a++) {
+            while (b != other.hashes.end() && *b < *a) {
+                ++b;
+            }
+
+            shared += b != other.hashes.end() && *b == *a;
+            ++total;
+        }
+
+        return total == 0 ? 0.0 : (double) shared / total;
+    }
+
+    // Get the Mash distance between the sketches, an estimate of the per base mutation rate between their sequences derived
+    // from the Jaccard index. Sketches that share no k-mers are at distance 1.
+    double MinHashSketch::mashDistance(const MinHashSketch &other) const {
+        double j = (*this).jaccard(other);
+
+        if (j <= 0.0) {
+            return 1.0;
+        }
+
+        return std::min(1.0, -std::log(2.0 * j / (1.0 + j)) / (*this).k);
+    }
+
+    // Sketch every sequence of the FASTA file `fn` together without holding the file in memory. Each batch of the file is cut
+    // into tasks that are sketched on `threads` threads (0 for one per core) and merged, which gives the same sketch as a
+    // sequential pass.
+    MinHashSketch sketchFASTAFile(const std::string &fn, unsigned int k, SketchMode mode, unsigned long int size,
+                                  unsigned int threads) {
+        MinHashSketch sketch(k, mode, size, fn);
+        FASTAReader reader(fn);
+        SequenceBatch batch;
+        std::vector<SequenceView> seqs;
+        std::vector<KmerRange> ranges;
+        std::vector<size_t> taskStart;
+        std::mutex lock;
+        size_t i;
+
+        threads = resolveThreadCount(threads);
+
+        while (reader.nextBatch(batch, SIZE_MAX, SKETCH_BATCH_BASES) > 0) {
+            seqs.clear();
+
+            for (i = 0; i < batch.size(); ++i) {
+                seqs.push_back(batch.getSequence(i));
+            }
+
+            splitKmerTasks(seqs, k, ranges, taskStart);
+
+            parallelFor(taskStart.size() - 1, threads, [&](size_t t) {
+                MinHashSketch part(k, mode, size);
+                size_t r;
+
+                for (r = taskStart[t]; r < taskStart[t + 1]; ++r) {
+                    part.add(seqs[ranges[r].seq].subsequence(ranges[r].start, ranges[r].end - ranges[r].start));
+                }
+
+                std::lock_guard<std::mutex> guard(lock);
+                sketch.merge(part);
+            });
+        }
+
+        return sketch;
+    }
+
+    // Get every pair of sketches in `sketches` that are at most `maxDistance` apart by Mash distance, comparing all pairs on
+    // `threads` threads (0 for one per core). Pairs are sorted by (first, second).
+    std::vector<SketchPair> mashDistancePairs(std::vector<MinHashSketch> &sketches, double maxDistance, unsigned int threads) {
+        std::vector<std::vector<SketchPair>> rows(sketches.size());
+        std::vector<SketchPair> pairs;
+        size_t i;
+
+        parallelFor(sketches.size(), threads, [&](size_t first) {
+            size_t second;
+            double d;
+
+            for (second = first + 1; second < sketches.size(); ++second) {
+                d = sketches[first].mashDistance(sketches[second]);
+
+                if (d <= maxDistance) {
+                    rows[first].push_back(SketchPair{(unsigned int) first, (unsigned int) second, d});
+                }
+            }
+        });
+
+        for (i = 0; i < rows.size(); ++i) {
+            pairs.insert(pairs.end(), rows[i].begin(), rows[i].end());
+        }
+
+        return pairs;
+    }
+
+    // Write `v` as a LEB128 variable length integer, 7 bits per byte.
+    static void writeVarint(std::ofstream &out, uint64_t v) {
+        char byte;
+
+        do {
+            byte = (char) (v & 0x7f);
+            v >>= 7;
+
+            if (v != 0) {
+                byte |= (char) 0x80;
+            }
+
+            out.put(byte);
+        } while (v != 0);
+    }
+
+    static uint64_t readVarint(std::ifstream &in) {
+        uint64_t v = 0;
+        unsigned int shift = 0;
+        int byte;
+
+        do {
+            byte = in.get();
+
+            if (byte == EOF || shift > 63) {
+                throw std::runtime_error("ERROR: Sketch file is truncated or corrupt!");
+            }
+
+            v |= (uint64_t) (byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+
+        return v;
+    }
+
+    // Write `sketches` to the file with name `fn`. Hashes are stored as varint gaps between neighbours, which takes a few
+    // bytes per hash instead of eight.
+    void writeSketches(const std::string &fn, const std::vector<MinHashSketch> &sketches) {
+        std::ofstream out(fn, std::ios::binary);
+        std::vector<MinHashSketch>::const_iterator it;
+        uint64_t previous;
+
+        if (!out.good()) {
+            throw std::invalid_argument("ERROR: Could not open sketch file for writing!");
+        }
+
+        out.write(SKETCH_FILE_MAGIC, sizeof(SKETCH_FILE_MAGIC));
+        writeVarint(out, sketches.size());
+
+        for (it = sketches.begin(); it != sketches.end(); it++) {
+            writeVarint(out, it->getName().length());
+            out.write(it->getName().data(), it->getName().length());
+            writeVarint(out, it->getK());
+            writeVarint(out, it->getMode() == SketchMode::BOTTOM_K ? 0 : 1);
+            writeVarint(out, it->getSize());
+            writeVarint(out, it->getHashes().size());
+            previous = 0;
+
+            for (uint64_t hash : it->getHashes()) {
+                writeVarint(out, hash - previous);
+                previous = hash;
+            }
+        }
+
+        if (!out.good()) {
+            throw std::runtime_error("ERROR: Failed to write sketch file!");
+        }
+    }
+
+    // Read every sketch from a file written by `writeSketches`.
+    std::vector<MinHashSketch> readSketches(const std::string &fn) {
+        std::ifstream in(fn, std::ios::binary);
+        std::vector<MinHashSketch> sketches;
+        std::vector<uint64_t> hashes;
+        char magic[sizeof(SKETCH_FILE_MAGIC)];
+        std::string name;
+        uint64_t count;
+        uint64_t n;
+        uint64_t i;
+        uint64_t j;
+        uint64_t previous;
+        unsigned int k;
+        SketchMode mode;
+        unsigned long int size;
+
+        if (!in.good()) {
+            throw std::invalid_argument("ERROR: Could not open sketch file!");
+        }
+
+        if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), SKETCH_FILE_MAGIC)) {
+            throw std::runtime_error("ERROR: File is not a sketch file written by this version!");
+        }
+
+        count = readVarint(in);
+
+        for (i = 0; i < count; ++i) {
+            name.resize(readVarint(in));
+
+            if (!in.read(&name[0], name.length())) {
+                throw std::runtime_error("ERROR: Sketch file is truncated or corrupt!");
+            }
+
+            k = readVarint(in);
+            mode = readVarint(in) == 0 ? SketchMode::BOTTOM_K : SketchMode::FRACTIONAL;
+            size = readVarint(in);
+            n = readVarint(in);
+
+            hashes.resize(n);
+            previous = 0;
+
+            for (j = 0; j < n; ++j) {
+                previous += readVarint(in);
+                hashes[j] = previous;
+            }
+
+            sketches.push_back(MinHashSketch(k, mode, size, name));
+            sketches.back().hashes.swap(hashes);
+        }
+
+        return sketches;
+    }
+}
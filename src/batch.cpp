@@ -0,0 +1,146 @@
+#include <batch.hpp>
+#include <fundamentals.hpp>
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+namespace bioinfo {
+    // Create a record from views of its header `h` and sequence `s`
+    SequenceRecord::SequenceRecord(SequenceView h, SequenceView s) {
+        (*this).header = h;
+        (*this).sequence = s;
+    }
+
+    // Get the header of the record
+    SequenceView SequenceRecord::getHeader() const {
+        return (*this).header;
+    }
+
+    // Get the sequence of the record
+    SequenceView SequenceRecord::getSequence() const {
+        return (*this).sequence;
+    }
+
+    // Get the sequence of the record, named the same as on DNAString so templates can take either
+    SequenceView SequenceRecord::getSequenceView() const {
+        return (*this).sequence;
+    }
+
+    // Get how many nucleotides are in the record
+    unsigned int SequenceRecord::getSequenceLength() const {
+        return (*this).sequence.length();
+    }
+
+    // Copy the record out of the batch into its own DNAString
+    DNAString SequenceRecord::toDNAString() const {
+        return DNAString((*this).header.toString(), (*this).sequence.toString());
+    }
+
+    // --------------------------------------------------------------------------
+
+    // Create a new empty SequenceBatch
+    SequenceBatch::SequenceBatch() {
+        (*this).headerOffsets.push_back(0);
+        (*this).sequenceOffsets.push_back(0);
+    }
+
+    // Reserve room for `records` records holding `bases` bases in total, and `headerBytes` bytes of headers, so appending up to
+    // that much does not reallocate.
+    void SequenceBatch::reserve(size_t records, size_t bases, size_t headerBytes) {
+        (*this).headerOffsets.reserve(records + 1);
+        (*this).sequenceOffsets.reserve(records + 1);
+        (*this).sequences.reserve(bases);
+        (*this).headers.reserve(headerBytes);
+    }
+
+    // Remove every record but keep the arenas allocated, so refilling the batch with records of a similar size does not
+    // allocate.
+    void SequenceBatch::clear() {
+        (*this).headers.clear();
+        (*this).sequences.clear();
+        (*this).headerOffsets.resize(1);
+        (*this).sequenceOffsets.resize(1);
+    }
+
+    // Get how many records are in the batch
+    size_t SequenceBatch::size() const {
+        return (*this).sequenceOffsets.size() - 1;
+    }
+
+    // Check if the batch has no records
+    bool SequenceBatch::empty() const {
+        return (*this).size() == 0;
+    }
+
+    // Get how many nucleotides are in the batch over every record
+    size_t SequenceBatch::getTotalLength() const {
+        return (*this).sequences.length();
+    }
+
+    // Copy a record with header `h` and sequence `s` to the end of the arenas. The sequence is uppercased the same as the
+    // DNAString constructor does.
+    void SequenceBatch::append(SequenceView h, SequenceView s) {
+        size_t start = (*this).sequences.length();
+
+        (*this).headers.append(h.data(), h.length());
+        (*this).sequences.append(s.data(), s.length());
+        toUpperInPlace(&(*this).sequences[start], s.length());
+
+        (*this).headerOffsets.push_back((*this).headers.length());
+        (*this).sequenceOffsets.push_back((*this).sequences.length());
+    }
+
+    // Copy the header and sequence of a DNAString `ds` to the end of the arenas
+    void SequenceBatch::append(DNAString &ds) {
+        (*this).append(ds.getHeader(), ds.getSequenceView());
+    }
+
+    // Get the record with index `i` without copying it
+    SequenceRecord SequenceBatch::operator[](size_t i) const {
+        return SequenceRecord((*this).getHeader(i), (*this).getSequence(i));
+    }
+
+    // Get the header of the record with index `i`
+    SequenceView SequenceBatch::getHeader(size_t i) const {
+        if (i >= (*this).size()) {
+            throw std::out_of_range("ERROR: SequenceBatch index is out of range!");
+        }
+
+        return SequenceView((*this).headers.data() + (*this).headerOffsets[i],
+                            (*this).headerOffsets[i + 1] - (*this).headerOffsets[i]);
+    }
+
+    // Get the sequence of the record with index `i`
+    SequenceView SequenceBatch::getSequence(size_t i) const {
+        if (i >= (*this).size()) {
+            throw std::out_of_range("ERROR: SequenceBatch index is out of range!");
+        }
+
+        return SequenceView((*this).sequences.data() + (*this).sequenceOffsets[i],
+                            (*this).sequenceOffsets[i + 1] - (*this).sequenceOffsets[i]);
+    }
+
+    // Get how many nucleotides are in the record with index `i`
+    unsigned int SequenceBatch::getSequenceLength(size_t i) const {
+        return (*this).getSequence(i).length();
+    }
+
+    // Copy the record with index `i` out of the batch into its own DNAString
+    DNAString SequenceBatch::toDNAString(size_t i) const {
+        return (*this)[i].toDNAString();
+    }
+
+    // Copy every record out of the batch into its own DNAString
+    std::vector<DNAString> SequenceBatch::toDNAStrings() const {
+        std::vector<DNAString> vec;
+        size_t i;
+
+        vec.reserve((*this).size());
+
+        for (i = 0; i < (*this).size(); ++i) {
+            vec.push_back((*this).toDNAString(i));
+        }
+
+        return vec;
+    }
+}
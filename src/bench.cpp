@@ -0,0 +1,396 @@
+// Standard libs
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <ctime>
+#include <stdexcept>
+#include <functional>
+#include <utility>
+// POSIX libs
+#include <unistd.h>
+// Bioinformatics libs
+#include <fundamentals.hpp>
+#include <analysis.hpp>
+#include <biomath.hpp>
+#include <benchalloc.hpp>
+
+/*
+    Benchmark harness for the public kernels. Every kernel runs on deterministic synthetic input at sizes from 1 KiB up to
+    --max-size, and the results are written as JSON with the time, throughput and heap allocations of one call.
+
+    Usage: benchmark [--max-size BYTES[K|M|G]] [--min-time SECONDS] [--threads N] [--out FILE]
+*/
+
+namespace bioinfo {
+    const unsigned long int BENCH_MIN_SIZE = 1 << 10;
+    const unsigned long int BENCH_SIZE_STEP = 32; // Each benchmarked size is this many times the previous one
+    const unsigned long int BENCH_DEFAULT_MAX_SIZE = 32UL << 20;
+    const unsigned long int BENCH_FASTA_RECORD = 10000; // Bases per record of the synthetic FASTA file
+    const unsigned long int BENCH_READ_LENGTH = 100; // Bases per read given to AdjacencyList
+    const unsigned long int BENCH_MAX_READS = 1 << 16; // Most reads given to AdjacencyList, one per BENCH_READ_LENGTH bytes below it
+    const unsigned int BENCH_OVERLAP = 12; // Overlap of the AdjacencyList benchmark, long enough to keep random edges rare
+    const unsigned long int BENCH_MAX_BINOMIALS = 1 << 22; // Most (n, x, p) triples evaluated per call
+    const uint64_t BENCH_SEED = 0x5EEDB10CUL;
+
+    struct BenchOptions {
+        unsigned long int maxSize = BENCH_DEFAULT_MAX_SIZE;
+        double minTime = 0.25; // Seconds every benchmark keeps calling its kernel for
+        unsigned int threads = 1; // Threads given to the kernels that take a thread count
+        std::string out; // JSON output file, standard output when empty
+    } typedef BenchOptions;
+
+    struct BenchResult {
+        std::string name;
+        unsigned long int size = 0; // Synthetic input size in bytes
+        unsigned long int items = 0; // Bases, residues or other units processed by one call
+        std::string unit;
+        unsigned long int iterations = 0;
+        double secondsPerCall = 0.0;
+        double allocationsPerCall = 0.0;
+        double bytesAllocatedPerCall = 0.0;
+    } typedef BenchResult;
+
+    // Results of kernels are folded in here so the compiler cannot drop the calls
+    static volatile size_t benchSink = 0;
+
+    // Output stream that throws everything away, used to time permutation formatting without the cost of a device.
+    class NullBuffer : public std::streambuf {
+        protected:
+            int overflow(int c) override { return c; }
+            std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+    };
+
+    // Return `n` characters drawn uniformly from `alphabet` by stream `stream` of the bench seed.
+    static std::string syntheticSequence(unsigned long int n, const std::string &alphabet, uint64_t stream) {
+        PhiloxRandom rng(BENCH_SEED, stream);
+        std::string s(n, alphabet[0]);
+        uint32_t bits = 0;
+        unsigned long int i;
+
+        if (alphabet.length() == 4) {
+            // Sixteen bases from every 32 random bits
+            for (i = 0; i < n; ++i) {
+                if ((i & 15) == 0) {
+                    bits = rng.next();
+                }
+
+                s[i] = alphabet[bits & 3];
+                bits >>= 2;
+            }
+        } else {
+            for (i = 0; i < n; ++i) {
+                s[i] = alphabet[rng.next() % alphabet.length()];
+            }
+        }
+
+        return s;
+    }
+
+    // Write a FASTA file of `n` synthetic bases split into records and return its name.
+    static std::string syntheticFASTAFile(unsigned long int n) {
+        char name[] = "/tmp/bioinfo-bench-XXXXXX";
+        std::string seq = syntheticSequence(n, "ACGT", 1);
+        std::ofstream out;
+        unsigned long int i;
+        unsigned long int j;
+        int fd = mkstemp(name);
+
+        if (fd < 0) {
+            throw std::runtime_error("ERROR: Could not create the benchmark FASTA file!");
+        }
+
+        close(fd);
+        out.open(name);
+
+        for (i = 0; i < n; i += BENCH_FASTA_RECORD) {
+            out << ">record_" << i / BENCH_FASTA_RECORD << "\n";
+
+            for (j = i; j < std::min(n, i + BENCH_FASTA_RECORD); j += 80) {
+                out.write(seq.data() + j, std::min(80UL, std::min(n, i + BENCH_FASTA_RECORD) - j));
+                out << "\n";
+            }
+        }
+
+        if (!out) {
+            std::remove(name);
+            throw std::runtime_error("ERROR: Could not write the benchmark FASTA file!");
+        }
+
+        return name;
+    }
+
+    // Call `f` until `minTime` seconds have passed, after one warm-up call, and record the time and allocations per call.
+    static BenchResult runBenchmark(const std::string &name, unsigned long int size, unsigned long int items,
+                                    const std::string &unit, double minTime, const std::function<size_t()> &f) {
+        BenchResult result;
+        std::chrono::steady_clock::time_point start;
+        double elapsed = 0.0;
+        unsigned long int count;
+        unsigned long int bytes;
+
+        benchSink = benchSink + f();
+
+        count = allocationCount();
+        bytes = allocationBytes();
+        start = std::chrono::steady_clock::now();
+
+        do {
+            benchSink = benchSink + f();
+            ++result.iterations;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        } while (elapsed < minTime);
+
+        result.name = name;
+        result.size = size;
+        result.items = items;
+        result.unit = unit;
+        result.secondsPerCall = elapsed / result.iterations;
+        result.allocationsPerCall = (double) (allocationCount() - count) / result.iterations;
+        result.bytesAllocatedPerCall = (double) (allocationBytes() - bytes) / result.iterations;
+
+        std::cerr << std::left << std::setw(24) << name << std::right << std::setw(12) << size << " B "
+                  << std::setw(12) << std::setprecision(3) << std::scientific << items / result.secondsPerCall << " "
+                  << unit << "/s " << std::fixed << std::setprecision(1) << std::setw(10) << result.allocationsPerCall
+                  << " allocs/call" << std::endl;
+
+        return result;
+    }
+
+    // Benchmark every kernel on synthetic inputs of `size` bytes and append the results to `results`. Each kernel builds its
+    // input in its own block, so only one kernel's input is alive at a time and the largest sizes fit in memory.
+    static void benchmarkSize(unsigned long int size, const BenchOptions &options, std::vector<BenchResult> &results) {
+        unsigned long int i;
+
+        {
+            std::string fasta = syntheticFASTAFile(size);
+
+            try {
+                results.push_back(runBenchmark("readDNAStringFile", size, size, "bases", options.minTime, [&]() {
+                    return readDNAStringFile(fasta).size();
+                }));
+            } catch (...) {
+                std::remove(fasta.c_str());
+                throw;
+            }
+
+            std::remove(fasta.c_str());
+        }
+
+        {
+            std::string rna = transcribe(syntheticSequence(size, "ACGT", 2));
+
+            results.push_back(runBenchmark("translate", size, size, "bases", options.minTime, [&]() {
+                return translate(rna, GeneticCode::STANDARD_GENETIC_CODE).length();
+            }));
+        }
+
+        {
+            std::string dna = syntheticSequence(size, "ACGT", 2);
+
+            results.push_back(runBenchmark("transcribe", size, size, "bases", options.minTime, [&]() {
+                return transcribe(dna).length();
+            }));
+        }
+
+        {
+            DNAString ds("synthetic", syntheticSequence(size, "ACGT", 2));
+
+            results.push_back(runBenchmark("reverseComplement", size, size, "bases", options.minTime, [&]() {
+                return (size_t) reverseComplement(ds).getSequenceLength();
+            }));
+        }
+
+        {
+            DNAString ds("synthetic", syntheticSequence(size, "ACGT", 2));
+            DNAString other("other", syntheticSequence(size, "ACGT", 4));
+
+            results.push_back(runBenchmark("hammingDistance", size, size, "bases", options.minTime, [&]() {
+                return (size_t) hammingDistance(ds, other);
+            }));
+        }
+
+        {
+            std::string dna = syntheticSequence(size, "ACGT", 2);
+            DNAString motif("motif", dna.substr(size / 2, 8));
+            DNAString ds("synthetic", std::move(dna));
+
+            results.push_back(runBenchmark("exactDNAStringMotif", size, size, "bases", options.minTime, [&]() {
+                return exactDNAStringMotif(ds, motif, true).size();
+            }));
+        }
+
+        {
+            std::string dna = syntheticSequence(std::min(size, BENCH_MAX_READS * BENCH_READ_LENGTH), "ACGT", 2);
+            std::vector<DNAString> reads;
+
+            for (i = 0; i + BENCH_READ_LENGTH <= dna.length(); i += BENCH_READ_LENGTH) {
+                reads.push_back(DNAString("read", dna.substr(i, BENCH_READ_LENGTH)));
+            }
+
+            results.push_back(runBenchmark("AdjacencyList", size, reads.size() * BENCH_READ_LENGTH, "bases", options.minTime,
+                                           [&]() {
+                return AdjacencyList(reads, BENCH_OVERLAP, options.threads).getEdges().size();
+            }));
+        }
+
+        {
+            AAString as("synthetic", syntheticSequence(size, "ACDEFGHIKLMNPQRSTVWY", 3), GeneticCode::STANDARD_GENETIC_CODE);
+
+            results.push_back(runBenchmark("proteinMass", size, size, "residues", options.minTime, [&]() {
+                return (size_t) proteinMass(as, MassTables::MONOISOTOPIC_MASS_TABLE);
+            }));
+        }
+
+        {
+            RNAString rs("synthetic", transcribe(syntheticSequence(size, "ACGT", 2)));
+            const std::string &rna = rs.getSequence();
+            std::vector<RNAString> introns;
+
+            for (i = 0; i < 10; ++i) {
+                introns.push_back(RNAString("intron", rna.substr((i + 1) * size / 12, std::min(20UL, size / 12))));
+            }
+
+            results.push_back(runBenchmark("spliceRNA", size, size, "bases", options.minTime, [&]() {
+                return (size_t) spliceRNA(rs, introns).getSequenceLength();
+            }));
+        }
+
+        {
+            std::vector<unsigned int> ns;
+            std::vector<unsigned int> xs;
+            std::vector<double> ps;
+            unsigned long int binomials = std::min(size / 16, BENCH_MAX_BINOMIALS);
+            PhiloxRandom rng(BENCH_SEED, 5);
+
+            for (i = 0; i < binomials; ++i) {
+                ns.push_back(10 + rng.next() % 1000000);
+                ps.push_back(rng.uniform());
+                xs.push_back((unsigned int) (ns.back() * ps.back()) + rng.next() % 64);
+                xs.back() = std::min(xs.back(), ns.back());
+            }
+
+            results.push_back(runBenchmark("binomialDistribution", size, binomials, "evaluations", options.minTime, [&]() {
+                return binomialDistribution(ns, xs, ps, options.threads).size();
+            }));
+        }
+
+        {
+            unsigned int permutationLength = 3;
+            NullBuffer nullBuffer;
+            std::ostream nullStream(&nullBuffer);
+
+            // Permutations of the longest length whose formatted output stays within the size
+            while (permutationLength < 12 &&
+                   TotalPermutations(permutationLength + 1).size() * 2 * (permutationLength + 1) <= size) {
+                ++permutationLength;
+            }
+
+            results.push_back(runBenchmark("TotalPermutations", size, TotalPermutations(permutationLength).size(),
+                                           "permutations", options.minTime, [&]() {
+                TotalPermutations tp(permutationLength);
+
+                tp.writePermutationSummary(nullStream);
+                return (size_t) tp.size();
+            }));
+        }
+    }
+
+    // Parse a byte count such as 4096, 64K, 32M or 1G.
+    static unsigned long int parseSize(const std::string &s) {
+        size_t end;
+        unsigned long int value = std::stoul(s, &end);
+
+        if (end + 1 == s.length()) {
+            switch (s[end]) {
+                case 'K': case 'k': return value << 10;
+                case 'M': case 'm': return value << 20;
+                case 'G': case 'g': return value << 30;
+            }
+        } else if (end == s.length()) {
+            return value;
+        }
+
+        throw std::invalid_argument("ERROR: Invalid size " + s + "!");
+    }
+
+    // Write `results` as a JSON document.
+    static void writeJSON(std::ostream &os, const BenchOptions &options, const std::vector<BenchResult> &results) {
+        std::vector<BenchResult>::const_iterator it;
+
+        os << std::setprecision(9);
+        os << "{\n";
+        os << "  \"suite\": \"bioinfo\",\n";
+        os << "  \"timestamp\": " << (long int) std::time(NULL) << ",\n";
+        os << "  \"threads\": " << options.threads << ",\n";
+        os << "  \"min_time\": " << options.minTime << ",\n";
+        os << "  \"results\": [";
+
+        for (it = results.begin(); it != results.end(); ++it) {
+            os << (it == results.begin() ? "\n" : ",\n");
+            os << "    {\"name\": \"" << it->name << "\", \"size\": " << it->size << ", \"items\": " << it->items
+               << ", \"unit\": \"" << it->unit << "\", \"iterations\": " << it->iterations
+               << ", \"seconds_per_call\": " << it->secondsPerCall
+               << ", \"throughput\": " << it->items / it->secondsPerCall
+               << ", \"allocations_per_call\": " << it->allocationsPerCall
+               << ", \"bytes_allocated_per_call\": " << it->bytesAllocatedPerCall << "}";
+        }
+
+        os << "\n  ]\n}\n";
+    }
+}
+
+int main(int argc, char **argv) {
+    bioinfo::BenchOptions options;
+    std::vector<bioinfo::BenchResult> results;
+    std::ofstream out;
+    std::string arg;
+    unsigned long int size;
+    int i;
+
+    try {
+        for (i = 1; i < argc; ++i) {
+            arg = argv[i];
+
+            if (i + 1 >= argc) {
+                throw std::invalid_argument("ERROR: Missing value for " + arg + "!");
+            } else if (arg == "--max-size") {
+                options.maxSize = bioinfo::parseSize(argv[++i]);
+            } else if (arg == "--min-time") {
+                options.minTime = std::stod(argv[++i]);
+            } else if (arg == "--threads") {
+                options.threads = std::stoul(argv[++i]);
+            } else if (arg == "--out") {
+                options.out = argv[++i];
+            } else {
+                throw std::invalid_argument("ERROR: Unknown option " + arg + "!");
+            }
+        }
+
+        for (size = bioinfo::BENCH_MIN_SIZE; size <= options.maxSize; size *= bioinfo::BENCH_SIZE_STEP) {
+            bioinfo::benchmarkSize(size, options, results);
+        }
+
+        if (options.out.empty()) {
+            bioinfo::writeJSON(std::cout, options, results);
+        } else {
+            out.open(options.out);
+            bioinfo::writeJSON(out, options, results);
+
+            if (!out) {
+                throw std::runtime_error("ERROR: Could not write " + options.out + "!");
+            }
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+#include <benchalloc.hpp>
+#include <atomic>
+#include <new>
+#include <cstdlib>
+#include <cstddef>
+
+/*
+    Replacement global operator new and delete for the benchmark binary, which count every heap allocation so the harness
+    can report allocations per call. They live in their own translation unit so the compiler never sees them inlined next
+    to the standard containers.
+*/
+
+static std::atomic<unsigned long int> allocations(0);
+static std::atomic<unsigned long int> allocatedBytes(0);
+
+// Count and make an allocation of `size` bytes, returning NULL when malloc fails.
+static void *countedMalloc(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new(std::size_t size) {
+    void *p = countedMalloc(size);
+
+    if (p == NULL) {
+        throw std::bad_alloc();
+    }
+
+    return p;
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return countedMalloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return countedMalloc(size);
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+    std::free(p);
+}
+
+namespace bioinfo {
+    // Get the number of heap allocations made so far.
+    unsigned long int allocationCount() {
+        return allocations.load();
+    }
+
+    // Get the number of bytes requested by the heap allocations made so far.
+    unsigned long int allocationBytes() {
+        return allocatedBytes.load();
+    }
+}
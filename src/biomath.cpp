@@ -1,13 +1,443 @@
 #include <biomath.hpp>
+#include <parallel.hpp>
 #include <stdexcept>
 #include <limits.h>
 #include <vector>
 #include <cmath>
+#include <math.h>
 #include <string>
 #include <sstream>
 #include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
 
 namespace bioinfo {
+    const uint32_t DECIMAL_CHUNK = 1000000000; // Largest power of 10 that fits a limb, peeled off when printing
+
+    // Create a new `BigUnsigned` holding `value`.
+    BigUnsigned::BigUnsigned(unsigned long int value) {
+        while (value > 0) {
+            (*this).limbs.push_back((uint32_t) value);
+            value = (unsigned long int) ((uint64_t) value >> 32);
+        }
+    }
+
+    // Drop the zero limbs at the most significant end.
+    void BigUnsigned::trim() {
+        while (!(*this).limbs.empty() && (*this).limbs.back() == 0) {
+            (*this).limbs.pop_back();
+        }
+    }
+
+    bool BigUnsigned::isZero() const {
+        return (*this).limbs.empty();
+    }
+
+    // Return the number of bits needed to write the value, 0 for zero.
+    size_t BigUnsigned::bitLength() const {
+        if ((*this).limbs.empty()) {
+            return 0;
+        }
+
+        return 32 * ((*this).limbs.size() - 1) + (32 - __builtin_clz((*this).limbs.back()));
+    }
+
+    bool BigUnsigned::fitsUnsignedLong() const {
+        return (*this).bitLength() <= sizeof(unsigned long int) * CHAR_BIT;
+    }
+
+    // Return the value as an `unsigned long int`, throwing when it does not fit.
+    unsigned long int BigUnsigned::toUnsignedLong() const {
+        unsigned long int value = 0;
+        size_t i;
+
+        if (!(*this).fitsUnsignedLong()) {
+            throw std::overflow_error("ERROR: BigUnsigned value does not fit in an unsigned long int!");
+        }
+
+        for (i = (*this).limbs.size(); i > 0; --i) {
+            value = (unsigned long int) (((uint64_t) value << 32) | (*this).limbs[i - 1]);
+        }
+
+        return value;
+    }
+
+    // Return the value modulo `modulus`.
+    unsigned long int BigUnsigned::mod(unsigned long int modulus) const {
+        unsigned __int128 r = 0;
+        size_t i;
+
+        if (modulus == 0) {
+            throw std::invalid_argument("ERROR: Modulus cannot be 0!");
+        }
+
+        for (i = (*this).limbs.size(); i > 0; --i) {
+            r = ((r << 32) | (*this).limbs[i - 1]) % modulus;
+        }
+
+        return (unsigned long int) r;
+    }
+
+    // Return the value written in decimal.
+    std::string BigUnsigned::toString() const {
+        std::vector<uint32_t> rest = (*this).limbs;
+        std::vector<uint32_t> chunks;
+        std::string digits;
+        std::string chunk;
+        uint64_t remainder;
+        size_t i;
+
+        if (rest.empty()) {
+            return "0";
+        }
+
+        // Peel off nine decimal digits at a time by dividing the limbs in place
+        while (!rest.empty()) {
+            remainder = 0;
+
+            for (i = rest.size(); i > 0; --i) {
+                remainder = (remainder << 32) | rest[i - 1];
+                rest[i - 1] = (uint32_t) (remainder / DECIMAL_CHUNK);
+                remainder %= DECIMAL_CHUNK;
+            }
+
+            chunks.push_back((uint32_t) remainder);
+
+            while (!rest.empty() && rest.back() == 0) {
+                rest.pop_back();
+            }
+        }
+
+        digits = std::to_string(chunks.back());
+
+        for (i = chunks.size() - 1; i > 0; --i) {
+            chunk = std::to_string(chunks[i - 1]);
+            digits.append(9 - chunk.length(), '0');
+            digits += chunk;
+        }
+
+        return digits;
+    }
+
+    BigUnsigned &BigUnsigned::operator+=(const BigUnsigned &other) {
+        uint64_t carry = 0;
+        size_t i;
+
+        if ((*this).limbs.size() < other.limbs.size()) {
+            (*this).limbs.resize(other.limbs.size(), 0);
+        }
+
+        for (i = 0; i < (*this).limbs.size(); ++i) {
+            if (i >= other.limbs.size() && carry == 0) {
+                break;
+            }
+
+            carry += (uint64_t) (*this).limbs[i] + (i < other.limbs.size() ? other.limbs[i] : 0);
+            (*this).limbs[i] = (uint32_t) carry;
+            carry >>= 32;
+        }
+
+        if (carry > 0) {
+            (*this).limbs.push_back((uint32_t) carry);
+        }
+
+        return *this;
+    }
+
+    BigUnsigned BigUnsigned::operator+(const BigUnsigned &other) const {
+        BigUnsigned sum = *this;
+
+        sum += other;
+        return sum;
+    }
+
+    // Schoolbook product, accumulating each row of partial products with a 64-bit carry.
+    BigUnsigned BigUnsigned::operator*(const BigUnsigned &other) const {
+        BigUnsigned product;
+        uint64_t carry;
+        uint64_t a;
+        size_t i;
+        size_t j;
+
+        if ((*this).isZero() || other.isZero()) {
+            return product;
+        }
+
+        product.limbs.assign((*this).limbs.size() + other.limbs.size(), 0);
+
+        for (i = 0; i < (*this).limbs.size(); ++i) {
+            a = (*this).limbs[i];
+            carry = 0;
+
+            for (j = 0; j < other.limbs.size(); ++j) {
+                carry += a * other.limbs[j] + product.limbs[i + j];
+                product.limbs[i + j] = (uint32_t) carry;
+                carry >>= 32;
+            }
+
+            product.limbs[i + other.limbs.size()] = (uint32_t) carry;
+        }
+
+        product.trim();
+        return product;
+    }
+
+    bool BigUnsigned::operator==(const BigUnsigned &other) const {
+        return (*this).limbs == other.limbs;
+    }
+
+    bool BigUnsigned::operator!=(const BigUnsigned &other) const {
+        return (*this).limbs != other.limbs;
+    }
+
+    bool BigUnsigned::operator<(const BigUnsigned &other) const {
+        size_t i;
+
+        if ((*this).limbs.size() != other.limbs.size()) {
+            return (*this).limbs.size() < other.limbs.size();
+        }
+
+        for (i = (*this).limbs.size(); i > 0; --i) {
+            if ((*this).limbs[i - 1] != other.limbs[i - 1]) {
+                return (*this).limbs[i - 1] < other.limbs[i - 1];
+            }
+        }
+
+        return false;
+    }
+
+    std::ostream &operator<<(std::ostream &os, const BigUnsigned &value) {
+        return os << value.toString();
+    }
+
+    // Arithmetic the matrix power runs in: exact big integers, integers modulo `modulus`, or `unsigned long int` that records
+    // whether any step overflowed. Each dot product is summed into an `Accumulator` by `mulAdd` and turned back into a
+    // `Value` by `finish`, which lets the modular ring reduce once per entry instead of once per product.
+    struct BigRing {
+        typedef BigUnsigned Value;
+        typedef BigUnsigned Accumulator;
+
+        Value make(unsigned long int v) const { return BigUnsigned(v); }
+        bool isZero(const Value &v) const { return v.isZero(); }
+        void mulAdd(Accumulator &acc, const Value &a, const Value &b) const { acc += a * b; }
+        Value finish(Accumulator &acc) const { return std::move(acc); }
+    } typedef BigRing;
+
+    struct ModRing {
+        typedef unsigned long int Value;
+        typedef unsigned __int128 Accumulator;
+        unsigned long int modulus;
+
+        Value make(unsigned long int v) const { return v % modulus; }
+        bool isZero(Value v) const { return v == 0; }
+        void mulAdd(Accumulator &acc, Value a, Value b) const {
+            Accumulator product = (Accumulator) a * b;
+
+            // A reduced sum plus one product of reduced values always fits, so only reduce when the next add would wrap
+            if (acc > ~product) {
+                acc %= modulus;
+            }
+
+            acc += product;
+        }
+        Value finish(Accumulator &acc) const { return (Value) (acc % modulus); }
+    } typedef ModRing;
+
+    struct CheckedRing {
+        typedef unsigned long int Value;
+        typedef unsigned long int Accumulator;
+        bool overflowed = false;
+
+        Value make(unsigned long int v) const { return v; }
+        bool isZero(Value v) const { return v == 0; }
+        void mulAdd(Accumulator &acc, Value a, Value b) {
+            Value product;
+
+            if (__builtin_mul_overflow(a, b, &product) || __builtin_add_overflow(acc, product, &acc)) {
+                overflowed = true;
+            }
+        }
+        Value finish(Accumulator &acc) const { return acc; }
+    } typedef CheckedRing;
+
+    // Return `weights` . (`transition`^`n` * `initial`) in `ring`. The state vector absorbs the power of the matrix for every
+    // set bit of `n` while the matrix is squared, and the last squaring is skipped because nothing would use it.
+    template <typename R> static typename R::Value applyRecurrence(R &ring, unsigned int m,
+                                                                   const std::vector<unsigned long int> &transition,
+                                                                   const std::vector<unsigned long int> &initial,
+                                                                   const std::vector<unsigned long int> &weights,
+                                                                   unsigned long int n) {
+        typedef typename R::Value Value;
+        typedef typename R::Accumulator Accumulator;
+        std::vector<Value> power;
+        std::vector<Value> squared(m * m);
+        std::vector<Value> state;
+        std::vector<Value> next(m);
+        std::vector<Accumulator> row(m);
+        Accumulator total = Accumulator();
+        unsigned int i;
+        unsigned int j;
+        unsigned int l;
+
+        for (i = 0; i < m * m; ++i) {
+            power.push_back(ring.make(transition[i]));
+        }
+
+        for (i = 0; i < m; ++i) {
+            state.push_back(ring.make(initial[i]));
+        }
+
+        while (n > 0) {
+            if (n & 1) {
+                for (i = 0; i < m; ++i) {
+                    row[0] = Accumulator();
+
+                    for (j = 0; j < m; ++j) {
+                        if (!ring.isZero(power[i * m + j]) && !ring.isZero(state[j])) {
+                            ring.mulAdd(row[0], power[i * m + j], state[j]);
+                        }
+                    }
+
+                    next[i] = ring.finish(row[0]);
+                }
+
+                state.swap(next);
+            }
+
+            n >>= 1;
+
+            if (n > 0) {
+                // Loop order i, l, j keeps the inner loop on one row of both matrices and skips the zero entries of
+                // sparse transitions such as Leslie matrices
+                for (i = 0; i < m; ++i) {
+                    std::fill(row.begin(), row.end(), Accumulator());
+
+                    for (l = 0; l < m; ++l) {
+                        if (ring.isZero(power[i * m + l])) {
+                            continue;
+                        }
+
+                        for (j = 0; j < m; ++j) {
+                            if (!ring.isZero(power[l * m + j])) {
+                                ring.mulAdd(row[j], power[i * m + l], power[l * m + j]);
+                            }
+                        }
+                    }
+
+                    for (j = 0; j < m; ++j) {
+                        squared[i * m + j] = ring.finish(row[j]);
+                    }
+                }
+
+                power.swap(squared);
+            }
+        }
+
+        for (i = 0; i < m; ++i) {
+            if (weights[i] != 0) {
+                ring.mulAdd(total, ring.make(weights[i]), state[i]);
+            }
+        }
+
+        return ring.finish(total);
+    }
+
+    // Create a new `LinearRecurrence` from a square `transition` matrix, the starting `initial` state and the `weights` that
+    // turn a state into a term.
+    LinearRecurrence::LinearRecurrence(const std::vector<std::vector<unsigned long int>> &transition,
+                                       const std::vector<unsigned long int> &initial,
+                                       const std::vector<unsigned long int> &weights) {
+        size_t i;
+
+        (*this).m = transition.size();
+
+        if ((*this).m == 0) {
+            throw std::invalid_argument("ERROR: Recurrence transition matrix cannot be empty!");
+        } else if (initial.size() != (*this).m || weights.size() != (*this).m) {
+            throw std::invalid_argument("ERROR: Recurrence state and weights must match the transition matrix size!");
+        }
+
+        for (i = 0; i < (*this).m; ++i) {
+            if (transition[i].size() != (*this).m) {
+                throw std::invalid_argument("ERROR: Recurrence transition matrix must be square!");
+            }
+
+            (*this).transition.insert((*this).transition.end(), transition[i].begin(), transition[i].end());
+        }
+
+        (*this).initial = initial;
+        (*this).weights = weights;
+    }
+
+    // Return the size of the state vector.
+    unsigned int LinearRecurrence::size() const {
+        return (*this).m;
+    }
+
+    // Calculate the exact term after `n` steps.
+    BigUnsigned LinearRecurrence::term(unsigned long int n) const {
+        BigRing ring;
+
+        return applyRecurrence(ring, (*this).m, (*this).transition, (*this).initial, (*this).weights, n);
+    }
+
+    // Calculate the term after `n` steps modulo `modulus`.
+    unsigned long int LinearRecurrence::term(unsigned long int n, unsigned long int modulus) const {
+        ModRing ring;
+
+        if (modulus == 0) {
+            throw std::invalid_argument("ERROR: Modulus cannot be 0!");
+        }
+
+        ring.modulus = modulus;
+        return applyRecurrence(ring, (*this).m, (*this).transition, (*this).initial, (*this).weights, n);
+    }
+
+    // Calculate the term after `n` steps as an `unsigned long int`, throwing when it does not fit. The power first runs in
+    // machine words and only falls back to big integers when an intermediate matrix entry overflowed, since those entries
+    // can outgrow a term that still fits.
+    unsigned long int LinearRecurrence::termChecked(unsigned long int n) const {
+        CheckedRing ring;
+        unsigned long int value = applyRecurrence(ring, (*this).m, (*this).transition, (*this).initial, (*this).weights, n);
+
+        if (!ring.overflowed) {
+            return value;
+        }
+
+        return (*this).term(n).toUnsignedLong();
+    }
+
+    // Create the recurrence f(n) = f(n - 1) + `k` * f(n - 2) with f(0) = 0 and f(1) = 1, whose term after n steps is f(n).
+    LinearRecurrence fibonacciRecurrence(unsigned long int k) {
+        return LinearRecurrence({{1, k}, {1, 0}}, {1, 0}, {0, 1});
+    }
+
+    // Create the Leslie matrix recurrence for pairs that live `m` months and produce `k` new pairs every month from their
+    // second month on. The state counts pairs by age starting from one newborn pair, and its term after n steps is the
+    // number of living pairs in month n + 1.
+    LinearRecurrence mortalFibonacciRecurrence(unsigned long int k, unsigned int m) {
+        std::vector<std::vector<unsigned long int>> leslie;
+        std::vector<unsigned long int> initial(m, 0);
+        unsigned int i;
+
+        if (m == 0) {
+            throw std::invalid_argument("ERROR: Lifespan must be at least 1!");
+        }
+
+        leslie.assign(m, std::vector<unsigned long int>(m, 0));
+
+        for (i = 1; i < m; ++i) {
+            leslie[0][i] = k;
+            leslie[i][i - 1] = 1;
+        }
+
+        initial[0] = 1;
+        return LinearRecurrence(leslie, initial, std::vector<unsigned long int>(m, 1));
+    }
+
     // Calculate the factorial of a number `n`.
     double factorial(int n) {
         double fn = 1;
@@ -30,78 +460,684 @@ namespace bioinfo {
 
     // Calculate the fibonacci of a numer `n`.
     unsigned long int fibonacci(unsigned int n) {
-        unsigned long int fn = 0;
-        unsigned int i;
-        unsigned long int currNum;
+        if (n == 0) {
+            return 1;
+        }
+
+        try {
+            return fibonacciRecurrence().termChecked(n);
+        } catch (const std::overflow_error &e) {
+            throw std::overflow_error("ERROR: Fibonacci result overflowed!");
+        }
+    }
+
+    // Calculate the fibonacci of a number `n` modulo `modulus`.
+    unsigned long int fibonacci(unsigned int n, unsigned long int modulus) {
+        if (n == 0) {
+            return BigUnsigned(1).mod(modulus);
+        }
+
+        return fibonacciRecurrence().term(n, modulus);
+    }
+
+    // Calculate the exact fibonacci of a number `n`.
+    BigUnsigned bigFibonacci(unsigned int n) {
+        if (n == 0) {
+            return BigUnsigned(1);
+        }
+
+        return fibonacciRecurrence().term(n);
+    }
 
-        std::vector<unsigned long int> nums = {1, 1};
+    const unsigned long int LOG_FACTORIAL_TABLE_SIZE = 1 << 16; // Values of n whose log(n!) is looked up instead of computed
+    const size_t BIOMATH_TASK_ITEMS = 4096; // Array entries evaluated by one task of the vectorized functions
+    const double TAIL_TERM_CUTOFF = 1e-20; // Tail sums stop once a term is this small relative to the largest term
 
-        for(i = 2; i < n; ++i) {
-            if (nums.at(i - 2) > 0 && nums.at(i - 1) > ULONG_MAX - nums.at(i - 2)) {
-                throw std::overflow_error("ERROR: Fibonacci result overflowed!");
+    // Calculate the natural log of the gamma function at `x` with the reentrant `lgamma_r`, since `std::lgamma` writes the
+    // global `signgam` and races when worker threads call it.
+    static double logGamma(double x) {
+        int sign;
+
+        return lgamma_r(x, &sign);
+    }
+
+    // Return the table of log(i!) for i in [0, LOG_FACTORIAL_TABLE_SIZE). It is built on first use and shared by every caller
+    // and thread.
+    static const std::vector<double> &logFactorialTable() {
+        static const std::vector<double> table = []() {
+            std::vector<double> t(LOG_FACTORIAL_TABLE_SIZE);
+            unsigned long int i;
+
+            for (i = 0; i < LOG_FACTORIAL_TABLE_SIZE; ++i) {
+                t[i] = logGamma((double) i + 1.0);
             }
 
-            currNum = nums.at(i - 1) + nums.at(i - 2);
+            return t;
+        }();
+
+        return table;
+    }
+
+    // Throw unless `p` is a probability.
+    static void checkProbability(double p) {
+        if (!(p >= 0.0 && p <= 1.0)) {
+            throw std::invalid_argument("ERROR: Probability must be between 0 and 1!");
+        }
+    }
 
-            nums.push_back(currNum);
+    // Calculate the natural log of the factorial of `n`, which stays finite long after `n`! overflows a double.
+    double logFactorial(unsigned long int n) {
+        if (n < LOG_FACTORIAL_TABLE_SIZE) {
+            return logFactorialTable()[n];
         }
 
-        fn = nums.back();
-        return fn;
+        return logGamma((double) n + 1.0);
+    }
+
+    // Calculate the natural log of the number of ways to choose `x` items from `n`, or -infinity when `x` > `n`.
+    double logBinomialCoefficient(unsigned long int n, unsigned long int x) {
+        if (x > n) {
+            return -INFINITY;
+        }
+
+        return logFactorial(n) - logFactorial(x) - logFactorial(n - x);
+    }
+
+    // Calculate the natural log of the binomial probability of exactly `x` successes in `n` trials with success probability
+    // `p`, or -infinity when that outcome is impossible.
+    double logBinomialDistribution(unsigned int n, unsigned int x, double p) {
+        checkProbability(p);
+
+        if (x > n) {
+            return -INFINITY;
+        } else if (p == 0.0) {
+            return x == 0 ? 0.0 : -INFINITY;
+        } else if (p == 1.0) {
+            return x == n ? 0.0 : -INFINITY;
+        }
+
+        return logBinomialCoefficient(n, x) + x * std::log(p) + (n - (double) x) * std::log1p(-p);
     }
 
     // Calculate the binomial distribution with `n` number of trials, `x` number of times for a specific 
     // outcome within `n` trials, and `p` probability of success on a single trial.
     double binomialDistribution(unsigned int n, unsigned int x, double p) {
-        double prob = 0.0;
-        double q = 1 - p;
+        return std::exp(logBinomialDistribution(n, x, p));
+    }
+
+    // Sum the binomial probabilities from `x` outward, one step of `step` (+1 or -1) at a time, and return the log of the sum.
+    // The caller picks the direction in which the terms shrink, so the first term is the largest: every later term is kept
+    // relative to it (log-sum-exp with the maximum factored out) and the sum stops once the terms no longer register.
+    static double logBinomialRun(unsigned int n, unsigned int x, double p, int step) {
+        double first = logBinomialDistribution(n, x, p);
+        double odds = p / (1.0 - p);
+        double term = 1.0;
+        double sum = 1.0;
+        unsigned int i = x;
+
+        if (step > 0) {
+            for (; i < n; ++i) {
+                term *= (n - (double) i) / (i + 1.0) * odds;
+
+                if (term < TAIL_TERM_CUTOFF) {
+                    break;
+                }
+
+                sum += term;
+            }
+        } else {
+            for (; i > 0; --i) {
+                term *= i / ((n - (double) i + 1.0) * odds);
 
-        prob = ( factorial(n) / (factorial(n-x) * factorial(x)) ) * pow(p, x) * pow(q, n - x);
+                if (term < TAIL_TERM_CUTOFF) {
+                    break;
+                }
 
-        return prob;
+                sum += term;
+            }
+        }
+
+        return first + std::log(sum);
     }
 
+    // Calculate the natural log of the probability of at least `x` successes in `n` trials with success probability `p`.
+    // Only the terms that matter are summed, about the standard deviation's worth around the mode, so the cost does not grow
+    // with `n` the way a full sum would.
+    double logBinomialTail(unsigned int n, unsigned int x, double p) {
+        unsigned int mode;
+
+        checkProbability(p);
+
+        if (x == 0 || p == 1.0) {
+            return x <= n ? 0.0 : -INFINITY;
+        } else if (x > n || p == 0.0) {
+            return -INFINITY;
+        }
+
+        mode = (unsigned int) std::min<double>(std::floor((n + 1.0) * p), n);
+
+        if (x > mode) {
+            return logBinomialRun(n, x, p, 1);
+        }
+
+        // Below the mode the terms shrink toward 0, so sum the lower tail instead and take its complement
+        return std::log1p(-std::exp(logBinomialRun(n, x - 1, p, -1)));
+    }
+
+    // Calculate the probability of at least `x` successes in `n` trials with success probability `p`.
+    double binomialTail(unsigned int n, unsigned int x, double p) {
+        return std::exp(logBinomialTail(n, x, p));
+    }
+
+    // Calculate the probability of at most `x` successes in `n` trials with success probability `p`, which is the chance of
+    // at least `n` - `x` failures.
+    double binomialCDF(unsigned int n, unsigned int x, double p) {
+        checkProbability(p);
+
+        if (x >= n) {
+            return 1.0;
+        }
+
+        return std::exp(logBinomialTail(n, n - x, 1.0 - p));
+    }
+
+    // Evaluate `f(n[i], x[i], p[i])` for every entry of the three arrays across `threads` threads.
+    template <typename F> static std::vector<double> evaluateBinomials(const std::vector<unsigned int> &n,
+                                                                      const std::vector<unsigned int> &x,
+                                                                      const std::vector<double> &p, unsigned int threads,
+                                                                      F f) {
+        std::vector<double> values(n.size());
+        size_t tasks = (n.size() + BIOMATH_TASK_ITEMS - 1) / BIOMATH_TASK_ITEMS;
+
+        if (x.size() != n.size() || p.size() != n.size()) {
+            throw std::invalid_argument("ERROR: Binomial parameter arrays must have the same length!");
+        }
+
+        logFactorialTable();
+
+        parallelFor(tasks, threads, [&](size_t t) {
+            size_t end = std::min(n.size(), (t + 1) * BIOMATH_TASK_ITEMS);
+            size_t i;
+
+            for (i = t * BIOMATH_TASK_ITEMS; i < end; ++i) {
+                values[i] = f(n[i], x[i], p[i]);
+            }
+        });
+
+        return values;
+    }
+
+    // Calculate the binomial distribution of every (`n`[i], `x`[i], `p`[i]) triple across `threads` threads.
+    std::vector<double> binomialDistribution(const std::vector<unsigned int> &n, const std::vector<unsigned int> &x,
+                                             const std::vector<double> &p, unsigned int threads) {
+        return evaluateBinomials(n, x, p, threads, [](unsigned int ni, unsigned int xi, double pi) {
+            return binomialDistribution(ni, xi, pi);
+        });
+    }
+
+    // Calculate the binomial tail of every (`n`[i], `x`[i], `p`[i]) triple across `threads` threads.
+    std::vector<double> binomialTail(const std::vector<unsigned int> &n, const std::vector<unsigned int> &x,
+                                     const std::vector<double> &p, unsigned int threads) {
+        return evaluateBinomials(n, x, p, threads, [](unsigned int ni, unsigned int xi, double pi) {
+            return binomialTail(ni, xi, pi);
+        });
+    }
+
+    const uint32_t PHILOX_M0 = 0xD2511F53;
+    const uint32_t PHILOX_M1 = 0xCD9E8D57;
+    const uint32_t PHILOX_W0 = 0x9E3779B9; // Weyl increments of the key between rounds
+    const uint32_t PHILOX_W1 = 0xBB67AE85;
+    const unsigned int PHILOX_ROUNDS = 10;
+    const double BINOMIAL_INVERSION_MEAN = 10.0; // Largest n * p drawn by inversion instead of rejection
+
+    // Create a new `PhiloxRandom` generator for sequence `stream` of `seed`.
+    PhiloxRandom::PhiloxRandom(uint64_t seed, uint64_t stream) {
+        (*this).key[0] = (uint32_t) seed;
+        (*this).key[1] = (uint32_t) (seed >> 32);
+        (*this).counter[0] = 0;
+        (*this).counter[1] = 0;
+        (*this).counter[2] = (uint32_t) stream;
+        (*this).counter[3] = (uint32_t) (stream >> 32);
+        (*this).used = 4;
+    }
+
+    // Encrypt the counter into the next block of four words and step the counter.
+    void PhiloxRandom::refill() {
+        uint32_t c[4] = {(*this).counter[0], (*this).counter[1], (*this).counter[2], (*this).counter[3]};
+        uint32_t k0 = (*this).key[0];
+        uint32_t k1 = (*this).key[1];
+        uint64_t p0;
+        uint64_t p1;
+        unsigned int r;
+
+        for (r = 0; r < PHILOX_ROUNDS; ++r) {
+            p0 = (uint64_t) PHILOX_M0 * c[0];
+            p1 = (uint64_t) PHILOX_M1 * c[2];
+            c[0] = (uint32_t) (p1 >> 32) ^ c[1] ^ k0;
+            c[1] = (uint32_t) p1;
+            c[2] = (uint32_t) (p0 >> 32) ^ c[3] ^ k1;
+            c[3] = (uint32_t) p0;
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+
+        std::memcpy((*this).block, c, sizeof(c));
+        (*this).used = 0;
+
+        if (++(*this).counter[0] == 0) {
+            ++(*this).counter[1];
+        }
+    }
+
+    // Return the next 32 random bits.
+    uint32_t PhiloxRandom::next() {
+        if ((*this).used == 4) {
+            (*this).refill();
+        }
+
+        return (*this).block[(*this).used++];
+    }
+
+    // Return a uniform double in the open interval (0, 1) with 53 random bits.
+    double PhiloxRandom::uniform() {
+        uint64_t hi = (*this).next() >> 5;
+        uint64_t lo = (*this).next() >> 6;
+
+        return ((double) ((hi << 26) | lo) + 0.5) / 9007199254740992.0;
+    }
+
+    // Create a new `BinomialSampler` for `n` trials with success probability `p`.
+    BinomialSampler::BinomialSampler(unsigned long int n, double p) {
+        double spq;
+
+        checkProbability(p);
+
+        (*this).n = n;
+        (*this).flipped = p > 0.5;
+        (*this).p = (*this).flipped ? 1.0 - p : p;
+        (*this).q = 1.0 - (*this).p;
+        (*this).odds = (*this).p / (*this).q;
+        (*this).inversion = n * (*this).p < BINOMIAL_INVERSION_MEAN;
+
+        if (!(*this).inversion) {
+            spq = std::sqrt(n * (*this).p * (*this).q);
+            (*this).b = 1.15 + 2.53 * spq;
+            (*this).a = -0.0873 + 0.0248 * (*this).b + 0.01 * (*this).p;
+            (*this).c = n * (*this).p + 0.5;
+            (*this).alpha = (2.83 + 5.1 / (*this).b) * spq;
+            (*this).vr = 0.92 - 4.2 / (*this).b;
+            (*this).logOdds = std::log((*this).odds);
+            (*this).mode = (unsigned long int) std::floor((n + 1.0) * (*this).p);
+            (*this).logModeTerms = logFactorial((*this).mode) + logFactorial(n - (*this).mode);
+        }
+    }
+
+    // Walk the distribution from 0 until the uniform draw is used up.
+    unsigned long int BinomialSampler::sampleInversion(PhiloxRandom &rng) const {
+        double u;
+        double term;
+        unsigned long int x;
+
+        while (true) {
+            u = rng.uniform();
+            term = std::pow((*this).q, (double) (*this).n);
+
+            for (x = 0; u > term && x < (*this).n; ++x) {
+                u -= term;
+                term *= (*this).odds * ((*this).n - x) / (x + 1.0);
+            }
+
+            // Rounding can leave a sliver of `u` past the last term, which is drawn again
+            if (u <= term) {
+                return x;
+            }
+        }
+    }
+
+    // Transformed rejection with squeeze (BTRS), Hoermann 1993. Most draws are accepted by the squeeze without evaluating
+    // the distribution.
+    unsigned long int BinomialSampler::sampleRejection(PhiloxRandom &rng) const {
+        double u;
+        double v;
+        double us;
+        double k;
+
+        while (true) {
+            u = rng.uniform() - 0.5;
+            v = rng.uniform();
+            us = 0.5 - std::fabs(u);
+            k = std::floor((2.0 * (*this).a / us + (*this).b) * u + (*this).c);
+
+            if (k < 0.0 || k > (*this).n) {
+                continue;
+            } else if (us >= 0.07 && v <= (*this).vr) {
+                return (unsigned long int) k;
+            }
+
+            v = std::log(v * (*this).alpha / ((*this).a / (us * us) + (*this).b));
+
+            if (v <= (*this).logModeTerms - logFactorial((unsigned long int) k) -
+                     logFactorial((*this).n - (unsigned long int) k) + (k - (*this).mode) * (*this).logOdds) {
+                return (unsigned long int) k;
+            }
+        }
+    }
+
+    // Draw one number of successes.
+    unsigned long int BinomialSampler::operator()(PhiloxRandom &rng) const {
+        unsigned long int x = (*this).inversion ? (*this).sampleInversion(rng) : (*this).sampleRejection(rng);
+
+        return (*this).flipped ? (*this).n - x : x;
+    }
+
+    // Fill `out` with `count` independent draws.
+    void BinomialSampler::sample(PhiloxRandom &rng, unsigned long int *out, size_t count) const {
+        size_t i;
+
+        for (i = 0; i < count; ++i) {
+            out[i] = (*this)(rng);
+        }
+    }
+
+    // Draw the number of successes in `n` trials with success probability `p`.
+    unsigned long int sampleBinomial(PhiloxRandom &rng, unsigned long int n, double p) {
+        return BinomialSampler(n, p)(rng);
+    }
+
+    // Split `n` trials among `k` outcomes with weights `p` and write the count of each outcome to `out`. The weights are
+    // normalized, and each count is a binomial draw from the trials left given the weight left.
+    void sampleMultinomial(PhiloxRandom &rng, unsigned long int n, const double *p, unsigned long int *out, size_t k) {
+        double remaining = 0.0;
+        size_t i;
+
+        for (i = 0; i < k; ++i) {
+            if (!(p[i] >= 0.0)) {
+                throw std::invalid_argument("ERROR: Multinomial weights cannot be negative!");
+            }
+
+            remaining += p[i];
+        }
+
+        if (k == 0 || remaining <= 0.0) {
+            throw std::invalid_argument("ERROR: Multinomial weights must have a positive sum!");
+        }
+
+        for (i = 0; i + 1 < k; ++i) {
+            out[i] = n > 0 && p[i] > 0.0 ? sampleBinomial(rng, n, std::min(1.0, p[i] / remaining)) : 0;
+            n -= out[i];
+            remaining -= p[i];
+        }
+
+        out[k - 1] = n;
+    }
+
+    // Split `n` trials among the outcomes with weights `p` and return the count of each outcome.
+    std::vector<unsigned long int> sampleMultinomial(PhiloxRandom &rng, unsigned long int n, const std::vector<double> &p) {
+        std::vector<unsigned long int> counts(p.size());
+
+        sampleMultinomial(rng, n, p.data(), counts.data(), p.size());
+        return counts;
+    }
+
+    const size_t PERMUTATION_WRITE_BUFFER = 1 << 16; // Bytes of formatted permutations handed to the output at a time
+
     // Create a new `TotalPermutations` object that has all possible permuations of the positive integers with a 
-    // permutations length of `n`.
+    // permutations length of `n`. Nothing is generated until the permutations are walked.
     TotalPermutations::TotalPermutations(unsigned int n) {
+        unsigned int i;
+
+        if (n > MAX_PERMUTATION_LENGTH) {
+            throw std::invalid_argument("ERROR: Permutation length cannot be above 20!");
+        }
+
         (*this).n = n;
-        std::vector<std::vector<unsigned int>> p;
-        std::vector<unsigned int> v;
+        (*this).total = 1;
+
+        for (i = 2; i <= n; ++i) {
+            (*this).total *= i;
+        }
+    }
+
+    unsigned int TotalPermutations::getLength() const {
+        return (*this).n;
+    }
+
+    // Return the number of permutations, `n`!.
+    unsigned long int TotalPermutations::size() const {
+        return (*this).total;
+    }
+
+    // Return the permutation with lexicographic rank `r`. Each digit of the Lehmer code of `r` picks which of the values not
+    // yet used comes next.
+    std::vector<unsigned int> TotalPermutations::unrank(unsigned long int r) const {
+        std::vector<unsigned int> unused;
+        std::vector<unsigned int> perm;
+        unsigned long int block = (*this).total;
+        unsigned int i;
+
+        if (r >= (*this).total) {
+            throw std::out_of_range("ERROR: Permutation rank is out of range!");
+        }
+
+        for (i = 1; i <= (*this).n; ++i) {
+            unused.push_back(i);
+        }
+
+        for (i = (*this).n; i > 0; --i) {
+            block /= i;
+            perm.push_back(unused[r / block]);
+            unused.erase(unused.begin() + r / block);
+            r %= block;
+        }
+
+        return perm;
+    }
+
+    // Return the lexicographic rank of `perm`, which must be a permutation of 1 to `n`. Its Lehmer code counts, for every
+    // position, the later values that are smaller.
+    unsigned long int TotalPermutations::rank(const std::vector<unsigned int> &perm) const {
+        std::vector<bool> seen((*this).n + 1, false);
+        unsigned long int r = 0;
+        unsigned int smaller;
+        unsigned int i;
+        unsigned int j;
+
+        if (perm.size() != (*this).n) {
+            throw std::invalid_argument("ERROR: Permutation has the wrong length!");
+        }
 
-        int i;
+        for (i = 0; i < (*this).n; ++i) {
+            if (perm[i] == 0 || perm[i] > (*this).n || seen[perm[i]]) {
+                throw std::invalid_argument("ERROR: Vector is not a permutation of 1 to n!");
+            }
+
+            seen[perm[i]] = true;
+            smaller = 0;
 
-        if (n > 0) {
-            for (i = 1; i < n + 1; ++i) {
-                v.push_back(i);
+            for (j = i + 1; j < (*this).n; ++j) {
+                smaller += perm[j] < perm[i];
             }
 
-            do {
-                p.push_back(v);
-            } while (std::next_permutation(v.begin(), v.end()));
+            r = r * ((*this).n - i) + smaller;
         }
 
-        (*this).p = p;
+        return r;
     }
 
-    // Returns a string summary with the total number of permutaions on the first line with a new permutations on each of the
-    // following lines.
-    std::string TotalPermutations::getPermutationSummary() {
-        std::stringstream ss;
-        std::vector<std::vector<unsigned int>>::iterator row;
-        std::vector<unsigned int>::iterator col;
+    // Get an iterator positioned at the first permutation, 1 2 ... n.
+    TotalPermutations::iterator TotalPermutations::begin() const {
+        return (*this).at(0);
+    }
+
+    // Get the iterator that marks the end of the permutations.
+    TotalPermutations::iterator TotalPermutations::end() const {
+        return iterator((*this).total, std::vector<unsigned int>());
+    }
+
+    // Get an iterator positioned at the permutation with rank `r`, or the end when `r` is past the last one.
+    TotalPermutations::iterator TotalPermutations::at(unsigned long int r) const {
+        if (r >= (*this).total) {
+            return (*this).end();
+        }
+
+        return iterator(r, (*this).unrank(r));
+    }
+
+    // Split the ranks into at most `parts` contiguous [first, last) ranges of near equal size, in order.
+    std::vector<std::pair<unsigned long int, unsigned long int>> TotalPermutations::split(unsigned long int parts) const {
+        std::vector<std::pair<unsigned long int, unsigned long int>> ranges;
+        unsigned long int first = 0;
+        unsigned long int length;
+        unsigned long int i;
+
+        if (parts == 0) {
+            throw std::invalid_argument("ERROR: Permutations cannot be split into 0 parts!");
+        }
+
+        parts = std::min(parts, (*this).total);
+
+        for (i = 0; i < parts; ++i) {
+            length = (*this).total / parts + (i < (*this).total % parts ? 1 : 0);
+            ranges.push_back(std::make_pair(first, first + length));
+            first += length;
+        }
+
+        return ranges;
+    }
 
-        ss << factorial(n) << "\n";
+    // Format the permutations with ranks in [`first`, `last`) one per line, every value followed by a space, and hand the text
+    // to `sink(data, length)` in blocks of about PERMUTATION_WRITE_BUFFER bytes. Lines are separated rather than terminated
+    // by newlines, so the last permutation of the whole order has none.
+    template <typename W> void TotalPermutations::writeRange(unsigned long int first, unsigned long int last, W sink) const {
+        char labels[MAX_PERMUTATION_LENGTH + 1][4] = {}; // "i " padded to 4 bytes so every copy has a fixed size
+        unsigned char labelLengths[MAX_PERMUTATION_LENGTH + 1];
+        std::vector<char> buffer(PERMUTATION_WRITE_BUFFER + 4 * (*this).n + 1);
+        std::string label;
+        size_t used = 0;
+        iterator it = (*this).at(first);
+        unsigned int i;
+
+        if (first > last || last > (*this).total) {
+            throw std::out_of_range("ERROR: Permutation rank range is out of range!");
+        }
+
+        for (i = 0; i <= (*this).n; ++i) {
+            label = std::to_string(i) + " ";
+            std::memcpy(labels[i], label.data(), label.length());
+            labelLengths[i] = label.length();
+        }
+
+        for (; it.rank() < last; ++it) {
+            for (i = 0; i < (*this).n; ++i) {
+                std::memcpy(buffer.data() + used, labels[(*it)[i]], 4);
+                used += labelLengths[(*it)[i]];
+            }
+
+            if (it.rank() + 1 < (*this).total) {
+                buffer[used++] = '\n';
+            }
+
+            if (used >= PERMUTATION_WRITE_BUFFER) {
+                sink(buffer.data(), used);
+                used = 0;
+            }
+        }
 
-        for (row = (*this).p.begin(); row != (*this).p.end(); row++) {
-            for (col = row->begin(); col != row->end(); col++) {
-                ss << *col << " ";
+        if (used > 0) {
+            sink(buffer.data(), used);
+        }
+    }
+
+    // Write the permutations with ranks in [`first`, `last`) to `os`.
+    void TotalPermutations::writePermutations(std::ostream &os, unsigned long int first, unsigned long int last) const {
+        (*this).writeRange(first, last, [&](const char *data, size_t length) {
+            if (!os.write(data, length)) {
+                throw std::runtime_error("ERROR: Could not write permutations!");
             }
+        });
+    }
+
+    // Write all `length` bytes of `data` to the file descriptor `fd`, resuming after partial writes and interrupts.
+    static void writeDescriptor(int fd, const char *data, size_t length) {
+        ssize_t written;
+
+        while (length > 0) {
+            written = ::write(fd, data, length);
 
-            if (row != (*this).p.end() - 1) {
-                ss << "\n";
+            if (written < 0 && errno == EINTR) {
+                continue;
+            } else if (written <= 0) {
+                throw std::runtime_error("ERROR: Could not write permutations!");
             }
+
+            data += written;
+            length -= written;
+        }
+    }
+
+    // Write the permutations with ranks in [`first`, `last`) to the file descriptor `fd`.
+    void TotalPermutations::writePermutations(int fd, unsigned long int first, unsigned long int last) const {
+        (*this).writeRange(first, last, [&](const char *data, size_t length) {
+            writeDescriptor(fd, data, length);
+        });
+    }
+
+    // Write the total number of permutaions on the first line and then every permutation to `os`.
+    void TotalPermutations::writePermutationSummary(std::ostream &os) const {
+        if (!(os << (*this).total << "\n")) {
+            throw std::runtime_error("ERROR: Could not write permutations!");
         }
 
+        (*this).writePermutations(os, 0, (*this).total);
+    }
+
+    // Write the total number of permutaions on the first line and then every permutation to the file descriptor `fd`.
+    void TotalPermutations::writePermutationSummary(int fd) const {
+        std::string header = std::to_string((*this).total) + "\n";
+
+        writeDescriptor(fd, header.data(), header.length());
+        (*this).writePermutations(fd, 0, (*this).total);
+    }
+
+    // Returns a string summary with the total number of permutaions on the first line with a new permutations on each of the
+    // following lines.
+    std::string TotalPermutations::getPermutationSummary() {
+        std::stringstream ss;
+
+        (*this).writePermutationSummary(ss);
         return ss.str();
     }
+
+    TotalPermutations::iterator::iterator(unsigned long int r, std::vector<unsigned int> current) {
+        (*this).r = r;
+        (*this).current = std::move(current);
+    }
+
+    const std::vector<unsigned int> &TotalPermutations::iterator::operator*() const {
+        return (*this).current;
+    }
+
+    const std::vector<unsigned int> *TotalPermutations::iterator::operator->() const {
+        return &(*this).current;
+    }
+
+    // Return the lexicographic rank of the current permutation.
+    unsigned long int TotalPermutations::iterator::rank() const {
+        return (*this).r;
+    }
+
+    // Step to the next permutation in lexicographic order.
+    TotalPermutations::iterator &TotalPermutations::iterator::operator++() {
+        ++(*this).r;
+        std::next_permutation((*this).current.begin(), (*this).current.end());
+        return *this;
+    }
+
+    bool TotalPermutations::iterator::operator==(const iterator &other) const {
+        return (*this).r == other.r;
+    }
+
+    bool TotalPermutations::iterator::operator!=(const iterator &other) const {
+        return (*this).r != other.r;
+    }
 }
\ No newline at end of file
@@ -0,0 +1,551 @@
+#include <fmindex.hpp>
+#include <fundamentals.hpp>
+#include <parallel.hpp>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <stdexcept>
+#include <algorithm>
+#include <cstdint>
+#include <climits>
+
+namespace bioinfo {
+    // Text symbols of the index. Every base other than A, C, G and T/U shares SYMBOL_OTHER with the separator between
+    // sequences, so no motif can match across an ambiguity code or from one sequence into the next.
+    const unsigned char SYMBOL_SENTINEL = 0;
+    const unsigned char SYMBOL_OTHER = 5;
+    const unsigned int SYMBOL_COUNT = 6;
+    const uint32_t SA_EMPTY = UINT32_MAX;
+    const size_t FM_BUILD_CHUNK = 4096; // OccBlocks handled by one task of the parallel passes
+    const char FM_INDEX_MAGIC[8] = {'B', 'I', 'O', 'F', 'M', 'I', 'X', '1'};
+
+    // Map a character to its text symbol, case insensitively
+    static unsigned char symbolOf(char c) {
+        switch (c) {
+            case 'A': case 'a': return 1;
+            case 'C': case 'c': return 2;
+            case 'G': case 'g': return 3;
+            case 'T': case 't': case 'U': case 'u': return 4;
+            default: return SYMBOL_OTHER;
+        }
+    }
+
+    // Fill `bkt` with the start (or one past the end, when `end` is set) of the bucket of every symbol in the suffix array.
+    template <typename T> static void getBuckets(const T *s, uint32_t n, uint32_t k, std::vector<uint32_t> &bkt, bool end) {
+        uint32_t i;
+        uint32_t sum = 0;
+
+        bkt.assign(k, 0);
+
+        for (i = 0; i < n; ++i) {
+            ++bkt[s[i]];
+        }
+
+        for (i = 0; i < k; ++i) {
+            sum += bkt[i];
+            bkt[i] = end ? sum : sum - bkt[i];
+        }
+    }
+
+    // Induce the order of the L-type suffixes from the sorted LMS suffixes, then the S-type suffixes from the L-type ones.
+    template <typename T> static void induceSort(const T *s, uint32_t *sa, uint32_t n, uint32_t k, const std::vector<bool> &stype,
+                                                 std::vector<uint32_t> &bkt) {
+        uint32_t i;
+        uint32_t j;
+
+        getBuckets(s, n, k, bkt, false);
+
+        for (i = 0; i < n; ++i) {
+            if (sa[i] != SA_EMPTY && sa[i] > 0) {
+                j = sa[i] - 1;
+
+                if (!stype[j]) {
+                    sa[bkt[s[j]]++] = j;
+                }
+            }
+        }
+
+        getBuckets(s, n, k, bkt, true);
+
+        for (i = n; i-- > 0;) {
+            if (sa[i] != SA_EMPTY && sa[i] > 0) {
+                j = sa[i] - 1;
+
+                if (stype[j]) {
+                    sa[--bkt[s[j]]] = j;
+                }
+            }
+        }
+    }
+
+    // Build the suffix array `sa` of the `n` symbols of `s` from an alphabet of size `k` with SA-IS (Nong, Zhang and Chan). The
+    // last symbol of `s` must be a unique smallest sentinel. The reduced problem is solved recursively inside `sa` itself.
+    template <typename T> static void suffixArrayIS(const T *s, uint32_t *sa, uint32_t n, uint32_t k) {
+        std::vector<bool> stype(n, false);
+        std::vector<uint32_t> bkt;
+        uint32_t i;
+        uint32_t j;
+        uint32_t d;
+        uint32_t n1 = 0;
+        uint32_t name = 0;
+        uint32_t pos;
+        uint32_t prev = SA_EMPTY;
+        uint32_t *s1;
+        bool diff;
+
+        if (n == 1) {
+            sa[0] = 0;
+            return;
+        }
+
+        stype[n - 1] = true;
+
+        for (i = n - 1; i-- > 0;) {
+            stype[i] = s[i] < s[i + 1] || (s[i] == s[i + 1] && stype[i + 1]);
+        }
+
+        auto isLMS = [&](uint32_t x) {
+            return x > 0 && stype[x] && !stype[x - 1];
+        };
+
+        // Sort the LMS substrings by placing them at the ends of their buckets and inducing
+        getBuckets(s, n, k, bkt, true);
+        std::fill(sa, sa + n, SA_EMPTY);
+
+        for (i = 1; i < n; ++i) {
+            if (isLMS(i)) {
+                sa[--bkt[s[i]]] = i;
+            }
+        }
+
+        induceSort(s, sa, n, k, stype, bkt);
+
+        // Move the sorted LMS substrings to the front and name them, equal substrings sharing a name
+        for (i = 0; i < n; ++i) {
+            if (isLMS(sa[i])) {
+                sa[n1++] = sa[i];
+            }
+        }
+
+        std::fill(sa + n1, sa + n, SA_EMPTY);
+
+        for (i = 0; i < n1; ++i) {
+            pos = sa[i];
+            diff = false;
+
+            for (d = 0; d < n; ++d) {
+                if (prev == SA_EMPTY || s[pos + d] != s[prev + d] || stype[pos + d] != stype[prev + d]) {
+                    diff = true;
+                    break;
+                } else if (d > 0 && (isLMS(pos + d) || isLMS(prev + d))) {
+                    break;
+                }
+            }
+
+            if (diff) {
+                ++name;
+                prev = pos;
+            }
+
+            sa[n1 + pos / 2] = name - 1;
+        }
+
+        for (i = n, j = n; i-- > n1;) {
+            if (sa[i] != SA_EMPTY) {
+                sa[--j] = sa[i];
+            }
+        }
+
+        // Sort the LMS suffixes, recursing when two LMS substrings share a name
+        s1 = sa + n - n1;
+
+        if (name < n1) {
+            suffixArrayIS<uint32_t>(s1, sa, n1, name);
+        } else {
+            for (i = 0; i < n1; ++i) {
+                sa[s1[i]] = i;
+            }
+        }
+
+        // Induce the full suffix array from the sorted LMS suffixes
+        getBuckets(s, n, k, bkt, true);
+
+        for (i = 1, j = 0; i < n; ++i) {
+            if (isLMS(i)) {
+                s1[j++] = i;
+            }
+        }
+
+        for (i = 0; i < n1; ++i) {
+            sa[i] = s1[sa[i]];
+        }
+
+        std::fill(sa + n1, sa + n, SA_EMPTY);
+
+        for (i = n1; i-- > 0;) {
+            j = sa[i];
+            sa[i] = SA_EMPTY;
+            sa[--bkt[s[j]]] = j;
+        }
+
+        induceSort(s, sa, n, k, stype, bkt);
+    }
+
+    // --------------------------------------------------------------------------
+
+    // Build the index of a single DNAString `ds`, keeping the text position of every `sampleRate`-th base for locate queries.
+    // The parallel passes of the build run on `threads` threads (0 for one per core).
+    FMIndex::FMIndex(DNAString &ds, unsigned int sampleRate, unsigned int threads) {
+        std::vector<SequenceView> seqs(1, ds.getSequenceView());
+
+        (*this).headers.push_back(ds.getHeader());
+        (*this).sampleRate = sampleRate;
+        (*this).build(seqs, threads);
+    }
+
+    // Build the index of every DNAString in `vec`. Hits are reported by the index of the sequence in `vec`.
+    FMIndex::FMIndex(std::vector<DNAString> &vec, unsigned int sampleRate, unsigned int threads) {
+        std::vector<SequenceView> seqs;
+        std::vector<DNAString>::iterator it;
+
+        for (it = vec.begin(); it != vec.end(); it++) {
+            seqs.push_back(it->getSequenceView());
+            (*this).headers.push_back(it->getHeader());
+        }
+
+        (*this).sampleRate = sampleRate;
+        (*this).build(seqs, threads);
+    }
+
+    // Concatenate the sequences, sort the suffixes with SA-IS and derive the rank directory and the sampled suffix array from
+    // the suffix array. Only the suffix sort is sequential, the BWT passes work on independent ranges of rows.
+    void FMIndex::build(const std::vector<SequenceView> &seqs, unsigned int threads) {
+        std::vector<unsigned char> text;
+        std::vector<uint32_t> sa;
+        uint64_t symbolCounts[SYMBOL_COUNT] = {0};
+        uint32_t running[4] = {0};
+        uint32_t sampledRunning = 0;
+        uint64_t total = 0;
+        uint64_t n;
+        size_t blocks;
+        size_t chunks;
+        size_t i;
+        unsigned int c;
+
+        if ((*this).sampleRate == 0) {
+            throw std::invalid_argument("ERROR: FMIndex sample rate cannot be 0!");
+        }
+
+        threads = resolveThreadCount(threads);
+
+        for (i = 0; i < seqs.size(); ++i) {
+            (*this).starts.push_back(total);
+            total += seqs[i].length() + 1;
+        }
+
+        n = std::max<uint64_t>(total, 1);
+
+        if (n >= SA_EMPTY) {
+            throw std::invalid_argument("ERROR: FMIndex sequences are too long to index!");
+        }
+
+        (*this).length = n;
+        text.resize(n);
+
+        parallelFor(seqs.size(), threads, [&](size_t k) {
+            unsigned char *out = &text[(*this).starts[k]];
+            size_t j;
+
+            for (j = 0; j < seqs[k].length(); ++j) {
+                out[j] = symbolOf(seqs[k][j]);
+            }
+
+            out[j] = SYMBOL_OTHER;
+        });
+
+        text[n - 1] = SYMBOL_SENTINEL;
+
+        sa.resize(n);
+        suffixArrayIS<unsigned char>(text.data(), sa.data(), n, SYMBOL_COUNT);
+
+        for (i = 0; i < n; ++i) {
+            ++symbolCounts[text[i]];
+        }
+
+        for (c = 0; c < SYMBOL_COUNT; ++c) {
+            (*this).firstRow[c] = c == 0 ? 0 : (*this).firstRow[c - 1] + symbolCounts[c - 1];
+        }
+
+        // Fill the BWT bit vectors of every block of 64 rows. A row is sampled when its text position is a multiple of the
+        // sample rate, or when the base before it is not A, C, G or T so locate never has to step across it.
+        blocks = n / 64 + 1;
+        chunks = (blocks + FM_BUILD_CHUNK - 1) / FM_BUILD_CHUNK;
+        (*this).occ.assign(blocks, OccBlock());
+        (*this).sampledBits.assign(blocks, 0);
+        (*this).sampledRanks.assign(blocks + 1, 0);
+
+        parallelFor(chunks, threads, [&](size_t chunk) {
+            uint64_t row;
+            uint64_t end = std::min<uint64_t>(n, (chunk + 1) * FM_BUILD_CHUNK * 64);
+            unsigned char symbol;
+
+            for (row = chunk * FM_BUILD_CHUNK * 64; row < end; ++row) {
+                symbol = sa[row] == 0 ? SYMBOL_SENTINEL : text[sa[row] - 1];
+
+                if (symbol >= 1 && symbol <= 4) {
+                    (*this).occ[row / 64].bits[symbol - 1] |= 1ULL << (row % 64);
+                }
+
+                if (sa[row] % (*this).sampleRate == 0 || symbol < 1 || symbol > 4) {
+                    (*this).sampledBits[row / 64] |= 1ULL << (row % 64);
+                }
+            }
+        });
+
+        // Turn the per block popcounts into counts of everything before each block
+        for (i = 0; i < blocks; ++i) {
+            for (c = 0; c < 4; ++c) {
+                (*this).occ[i].counts[c] = running[c];
+                running[c] += __builtin_popcountll((*this).occ[i].bits[c]);
+            }
+
+            (*this).sampledRanks[i] = sampledRunning;
+            sampledRunning += __builtin_popcountll((*this).sampledBits[i]);
+        }
+
+        (*this).sampledRanks[blocks] = sampledRunning;
+        (*this).samples.resize(sampledRunning);
+
+        parallelFor(chunks, threads, [&](size_t chunk) {
+            uint64_t row;
+            uint64_t end = std::min<uint64_t>(n, (chunk + 1) * FM_BUILD_CHUNK * 64);
+            uint32_t next = (*this).sampledRanks[chunk * FM_BUILD_CHUNK];
+
+            for (row = chunk * FM_BUILD_CHUNK * 64; row < end; ++row) {
+                if (((*this).sampledBits[row / 64] >> (row % 64)) & 1) {
+                    (*this).samples[next++] = sa[row];
+                }
+            }
+        });
+    }
+
+    // Count the rows before `row` whose BWT symbol is base `c` (0 to 3 for A, C, G and T).
+    uint64_t FMIndex::rank(unsigned int c, uint64_t row) const {
+        const OccBlock &block = (*this).occ[row / 64];
+
+        return block.counts[c] + __builtin_popcountll(block.bits[c] & ((1ULL << (row % 64)) - 1));
+    }
+
+    // Backward search for `motif`, leaving the rows of the suffixes it prefixes in [lo, hi). One rank lookup per base and end,
+    // so the cost depends only on the motif length.
+    bool FMIndex::findRows(SequenceView motif, uint64_t &lo, uint64_t &hi) const {
+        size_t i;
+        unsigned char symbol;
+
+        if (motif.empty()) {
+            throw std::invalid_argument("ERROR: FMIndex motif cannot be empty!");
+        }
+
+        lo = 0;
+        hi = (*this).length;
+
+        for (i = motif.length(); i-- > 0 && lo < hi;) {
+            symbol = symbolOf(motif[i]);
+
+            if (symbol == SYMBOL_OTHER) {
+                return false;
+            }
+
+            lo = (*this).firstRow[symbol] + (*this).rank(symbol - 1, lo);
+            hi = (*this).firstRow[symbol] + (*this).rank(symbol - 1, hi);
+        }
+
+        return lo < hi;
+    }
+
+    // Get the text position of the suffix at `row` by stepping back through the BWT until a sampled row is reached.
+    uint64_t FMIndex::textPosition(uint64_t row) const {
+        uint64_t steps = 0;
+        uint64_t word;
+        unsigned int c;
+
+        while (!(((*this).sampledBits[row / 64] >> (row % 64)) & 1)) {
+            for (c = 0; c < 4 && !(((*this).occ[row / 64].bits[c] >> (row % 64)) & 1); ++c) {}
+
+            row = (*this).firstRow[c + 1] + (*this).rank(c, row);
+            ++steps;
+        }
+
+        word = (*this).sampledBits[row / 64] & ((1ULL << (row % 64)) - 1);
+        return (*this).samples[(*this).sampledRanks[row / 64] + __builtin_popcountll(word)] + steps;
+    }
+
+    // Get how many sequences are in the index
+    unsigned int FMIndex::getSequenceCount() const {
+        return (*this).headers.size();
+    }
+
+    // Get the header of the sequence with index `i`
+    const std::string &FMIndex::getHeader(unsigned int i) const {
+        return (*this).headers.at(i);
+    }
+
+    // Get how many times `motif` occurs in the indexed sequences, overlapping occurrences included.
+    unsigned long int FMIndex::count(SequenceView motif) const {
+        uint64_t lo;
+        uint64_t hi;
+
+        return (*this).findRows(motif, lo, hi) ? hi - lo : 0;
+    }
+
+    // Get every occurrence of `motif` in the indexed sequences, overlapping occurrences included, sorted by sequence and
+    // position.
+    std::vector<IndexHit> FMIndex::locate(SequenceView motif) const {
+        std::vector<IndexHit> hits;
+        std::vector<uint64_t>::const_iterator it;
+        uint64_t lo;
+        uint64_t hi;
+        uint64_t row;
+        uint64_t position;
+        IndexHit hit;
+
+        if (!(*this).findRows(motif, lo, hi)) {
+            return hits;
+        }
+
+        for (row = lo; row < hi; ++row) {
+            position = (*this).textPosition(row);
+            it = std::upper_bound((*this).starts.begin(), (*this).starts.end(), position) - 1;
+            hit.sequence = it - (*this).starts.begin();
+            hit.position = position - *it;
+            hits.push_back(hit);
+        }
+
+        std::sort(hits.begin(), hits.end(), [](const IndexHit &a, const IndexHit &b) {
+            return a.sequence != b.sequence ? a.sequence < b.sequence : a.position < b.position;
+        });
+
+        return hits;
+    }
+
+    // --------------------------------------------------------------------------
+
+    template <typename T> static void writeValue(std::ofstream &out, const T &v) {
+        out.write((const char *) &v, sizeof(T));
+    }
+
+    template <typename T> static void writeVector(std::ofstream &out, const std::vector<T> &v) {
+        writeValue<uint64_t>(out, v.size());
+        out.write((const char *) v.data(), v.size() * sizeof(T));
+    }
+
+    template <typename T> static void readValue(std::ifstream &in, T &v) {
+        if (!in.read((char *) &v, sizeof(T))) {
+            throw std::runtime_error("ERROR: FMIndex file is truncated!");
+        }
+    }
+
+    // Count the bytes between the read position of `in` and the end of the file.
+    static uint64_t bytesLeft(std::ifstream &in) {
+        std::streampos position = in.tellg();
+        std::streampos end;
+
+        in.seekg(0, std::ios::end);
+        end = in.tellg();
+        in.seekg(position);
+
+        return (uint64_t) (end - position);
+    }
+
+    // Read a vector written by `writeVector`, checking its stored length against the bytes left before allocating it.
+    template <typename T> static void readVector(std::ifstream &in, std::vector<T> &v) {
+        uint64_t size;
+
+        readValue(in, size);
+
+        if (size > bytesLeft(in) / sizeof(T)) {
+            throw std::runtime_error("ERROR: FMIndex file is truncated!");
+        }
+
+        v.resize(size);
+
+        if (!in.read((char *) v.data(), size * sizeof(T))) {
+            throw std::runtime_error("ERROR: FMIndex file is truncated!");
+        }
+    }
+
+    // Load an index written by `writeIndex` from the file with name `fn`.
+    FMIndex::FMIndex(const std::string &fn) {
+        std::ifstream in(fn, std::ios::binary);
+        char magic[sizeof(FM_INDEX_MAGIC)];
+        uint64_t headerCount;
+        uint64_t i;
+
+        if (!in.good()) {
+            throw std::invalid_argument("ERROR: FMIndex could not open index file!");
+        }
+
+        if (!in.read(magic, sizeof(magic)) || !std::equal(magic, magic + sizeof(magic), FM_INDEX_MAGIC)) {
+            throw std::runtime_error("ERROR: FMIndex file is not an index written by this version!");
+        }
+
+        readValue(in, (*this).length);
+        readValue(in, (*this).sampleRate);
+        readValue(in, (*this).firstRow);
+        readValue(in, headerCount);
+
+        // Every header is stored with at least its 8 byte length
+        if (headerCount > bytesLeft(in) / sizeof(uint64_t)) {
+            throw std::runtime_error("ERROR: FMIndex file is truncated!");
+        }
+
+        (*this).headers.resize(headerCount);
+
+        for (i = 0; i < headerCount; ++i) {
+            std::vector<char> header;
+            readVector(in, header);
+            (*this).headers[i].assign(header.begin(), header.end());
+        }
+
+        readVector(in, (*this).starts);
+        readVector(in, (*this).occ);
+        readVector(in, (*this).sampledBits);
+        readVector(in, (*this).sampledRanks);
+        readVector(in, (*this).samples);
+
+        if ((*this).starts.size() != headerCount || (*this).occ.size() != (*this).length / 64 + 1 ||
+            (*this).sampledBits.size() != (*this).occ.size() || (*this).sampledRanks.size() != (*this).occ.size() + 1) {
+            throw std::runtime_error("ERROR: FMIndex file is corrupt!");
+        }
+    }
+
+    // Write the index to the file with name `fn` in a binary format that `FMIndex(fn)` loads back without rebuilding.
+    void FMIndex::writeIndex(const std::string &fn) const {
+        std::ofstream out(fn, std::ios::binary);
+        std::vector<std::string>::const_iterator it;
+
+        if (!out.good()) {
+            throw std::invalid_argument("ERROR: FMIndex could not open index file for writing!");
+        }
+
+        out.write(FM_INDEX_MAGIC, sizeof(FM_INDEX_MAGIC));
+        writeValue(out, (*this).length);
+        writeValue(out, (*this).sampleRate);
+        writeValue(out, (*this).firstRow);
+        writeValue<uint64_t>(out, (*this).headers.size());
+
+        for (it = (*this).headers.begin(); it != (*this).headers.end(); it++) {
+            writeVector(out, std::vector<char>(it->begin(), it->end()));
+        }
+
+        writeVector(out, (*this).starts);
+        writeVector(out, (*this).occ);
+        writeVector(out, (*this).sampledBits);
+        writeVector(out, (*this).sampledRanks);
+        writeVector(out, (*this).samples);
+
+        if (!out.good()) {
+            throw std::runtime_error("ERROR: FMIndex failed to write index file!");
+        }
+    }
+}
@@ -1,9 +1,17 @@
 #include <fundamentals.hpp>
+#include <seqio.hpp>
 #include <string>
 #include <iostream>
 #include <unordered_map>
 #include <vector>
-#include <fstream>
+#include <utility>
+#include <cctype>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define BIOINFO_X86_KERNELS 1
+#endif
 
 namespace bioinfo {
     // Create a new empty DNAString
@@ -11,25 +19,45 @@ namespace bioinfo {
         (*this).header = "";
         (*this).sequence = "";
         (*this).sequenceLength = 0;
+        (*this).packed = false;
     }
 
     // Create a new DNAString with a header and sequence
     DNAString::DNAString(std::string h, std::string s) {
-        (*this).header = h;
-        (*this).sequence = toUpper(s);
+        (*this).header = std::move(h);
         (*this).sequenceLength = s.length();
+        (*this).sequence = toUpper(std::move(s));
+        (*this).packed = false;
+    }
+
+    // Create a new DNAString with a header and an already packed sequence
+    DNAString::DNAString(std::string h, PackedSequence ps) {
+        (*this).header = std::move(h);
+        (*this).sequenceLength = ps.getLength();
+        (*this).packedSequence = std::move(ps);
+        (*this).packed = true;
     }
 
     // Get the header of the DNAString
-    std::string DNAString::getHeader() {
+    const std::string &DNAString::getHeader() {
         return (*this).header;
     }
 
-    // Get the sequence of the DNAString
-    std::string DNAString::getSequence() {
+    // Get the sequence of the DNAString. A packed sequence is unpacked once and kept until the sequence changes or the DNAString is
+    // packed again.
+    const std::string &DNAString::getSequence() {
+        if ((*this).packed && (*this).sequence.length() != (*this).sequenceLength) {
+            (*this).sequence = (*this).packedSequence.unpack('T');
+        }
+
         return (*this).sequence;
     }
 
+    // Get a view of the sequence of the DNAString that stays valid until the sequence is changed
+    SequenceView DNAString::getSequenceView() {
+        return SequenceView((*this).getSequence());
+    }
+
     // Get the how many nucleotides are in the DNAString
     unsigned int DNAString::getSequenceLength() {
         return (*this).sequenceLength;
@@ -37,13 +65,57 @@ namespace bioinfo {
 
     // Change the header of the DNAString
     void DNAString::setHeader(std::string h) {
-        (*this).sequence = h;
+        (*this).header = std::move(h);
     }
 
     // Change the seuqence of the DNAString
     void DNAString::setSequence(std::string s) {
-        (*this).sequence = toUpper(s);
         (*this).sequenceLength = s.length();
+        (*this).sequence = std::move(s);
+        toUpperInPlace((*this).sequence);
+
+        if ((*this).packed) {
+            (*this).packedSequence = PackedSequence((*this).sequence);
+            std::string().swap((*this).sequence);
+        }
+    }
+
+    // Switch the DNAString to 2-bit packed storage, with ambiguity codes kept in a side mask
+    void DNAString::pack() {
+        if (!(*this).packed) {
+            (*this).packedSequence = PackedSequence((*this).sequence);
+            (*this).packed = true;
+            std::string().swap((*this).sequence);
+        }
+    }
+
+    // Switch the DNAString back to one character per base storage
+    void DNAString::unpack() {
+        if ((*this).packed) {
+            (*this).sequence = (*this).packedSequence.unpack('T');
+            (*this).packed = false;
+            (*this).packedSequence = PackedSequence();
+        }
+    }
+
+    // Reverse complement the sequence of the DNAString without allocating a new sequence
+    void DNAString::reverseComplementInPlace() {
+        if ((*this).packed) {
+            (*this).packedSequence = (*this).packedSequence.reverseComplement();
+            std::string().swap((*this).sequence);
+        } else {
+            bioinfo::reverseComplementInPlace((*this).sequence);
+        }
+    }
+
+    // Check if the DNAString is stored as a PackedSequence
+    bool DNAString::isPacked() {
+        return (*this).packed;
+    }
+
+    // Get the packed sequence of the DNAString (only filled when `isPacked()` is true)
+    const PackedSequence &DNAString::getPackedSequence() {
+        return (*this).packedSequence;
     }
 
     // --------------------------------------------------------------------------
@@ -53,31 +125,72 @@ namespace bioinfo {
         (*this).header = "";
         (*this).sequence = "";
         (*this).sequenceLength = 0;
+        (*this).packed = false;
     }
 
     // Create a new RNAString with a header and sequence
     RNAString::RNAString(std::string h, std::string s) {
-        (*this).header = h;
-        (*this).sequence = transcribe(s);
+        (*this).header = std::move(h);
         (*this).sequenceLength = s.length();
+        (*this).sequence = transcribe(std::move(s));
+        (*this).packed = false;
     }
 
+    // Create a new RNAString with a header and an already packed sequence
+    RNAString::RNAString(std::string h, PackedSequence ps) {
+        (*this).header = std::move(h);
+        (*this).sequenceLength = ps.getLength();
+        (*this).packedSequence = std::move(ps);
+        (*this).packed = true;
+    }
+
+    // Create a new RNAString by transcribing a DNAString. A packed DNAString stays packed since T and U share a 2-bit code.
     RNAString::RNAString(DNAString &ds) {
         (*this).header = ds.getHeader();
-        (*this).sequence = transcribe(ds.getSequence());
         (*this).sequenceLength = ds.getSequenceLength();
+        (*this).packed = ds.isPacked();
+
+        if ((*this).packed) {
+            (*this).packedSequence = ds.getPackedSequence();
+        } else {
+            (*this).sequence = transcribe(ds.getSequence());
+        }
+    }
+
+    // Create a new RNAString by transcribing a DNAString in place, taking over its sequence buffer
+    RNAString::RNAString(DNAString &&ds) {
+        (*this).header = std::move(ds.header);
+        (*this).sequenceLength = ds.sequenceLength;
+        (*this).packed = ds.packed;
+
+        if ((*this).packed) {
+            (*this).packedSequence = std::move(ds.packedSequence);
+        } else {
+            (*this).sequence = std::move(ds.sequence);
+            transcribeInPlace((*this).sequence);
+        }
     }
 
     // Get the header of the RNAString
-    std::string RNAString::getHeader() {
+    const std::string &RNAString::getHeader() {
         return (*this).header;
     }
 
-    // Get the sequence of the RNAString
-    std::string RNAString::getSequence() {
+    // Get the sequence of the RNAString. A packed sequence is unpacked once and kept until the sequence changes or the RNAString is
+    // packed again.
+    const std::string &RNAString::getSequence() {
+        if ((*this).packed && (*this).sequence.length() != (*this).sequenceLength) {
+            (*this).sequence = (*this).packedSequence.unpack('U');
+        }
+
         return (*this).sequence;
     }
 
+    // Get a view of the sequence of the RNAString that stays valid until the sequence is changed
+    SequenceView RNAString::getSequenceView() {
+        return SequenceView((*this).getSequence());
+    }
+
     // Get the how many nucleotides are in the RNAString
     unsigned int RNAString::getSequenceLength() {
         return (*this).sequenceLength;
@@ -85,28 +198,74 @@ namespace bioinfo {
 
     // Change the header of the RNAString
     void RNAString::setHeader(std::string h) {
-        (*this).sequence = h;
+        (*this).header = std::move(h);
     }
 
     // Change the seuqence of the RNAString
     void RNAString::setSequence(std::string s) {
-        (*this).sequence = transcribe(s);
         (*this).sequenceLength = s.length();
+        (*this).sequence = std::move(s);
+        transcribeInPlace((*this).sequence);
+
+        if ((*this).packed) {
+            (*this).packedSequence = PackedSequence((*this).sequence);
+            std::string().swap((*this).sequence);
+        }
+    }
+
+    // Switch the RNAString to 2-bit packed storage, with ambiguity codes kept in a side mask
+    void RNAString::pack() {
+        if (!(*this).packed) {
+            (*this).packedSequence = PackedSequence((*this).sequence);
+            (*this).packed = true;
+            std::string().swap((*this).sequence);
+        }
+    }
+
+    // Switch the RNAString back to one character per base storage
+    void RNAString::unpack() {
+        if ((*this).packed) {
+            (*this).sequence = (*this).packedSequence.unpack('U');
+            (*this).packed = false;
+            (*this).packedSequence = PackedSequence();
+        }
+    }
+
+    // Reverse complement the sequence of the RNAString without allocating a new sequence
+    void RNAString::reverseComplementInPlace() {
+        if ((*this).packed) {
+            (*this).packedSequence = (*this).packedSequence.reverseComplement();
+            std::string().swap((*this).sequence);
+        } else {
+            bioinfo::reverseComplementInPlace((*this).sequence);
+            transcribeInPlace((*this).sequence);
+        }
+    }
+
+    // Check if the RNAString is stored as a PackedSequence
+    bool RNAString::isPacked() {
+        return (*this).packed;
+    }
+
+    // Get the packed sequence of the RNAString (only filled when `isPacked()` is true)
+    const PackedSequence &RNAString::getPackedSequence() {
+        return (*this).packedSequence;
     }
 
     // --------------------------------------------------------------------------
 
     // Create a new AAString with header `h`, sequence `s`, and using a certain genetic code table (`code`)
     AAString::AAString(std::string h, std::string s, const AATable &code) {
-        (*this).header = h;
-        (*this).sequence = toUpper(s);
+        (*this).header = std::move(h);
+        (*this).sequence = std::move(s);
+        toUpperInPlace((*this).sequence);
         (*this).sequenceLength = (*this).sequence.length();
     }
 
     // Create a new AAString from a DNAstring object (`ds`) using a certain genetic code table (`code`)
     AAString::AAString(DNAString &ds, const AATable &code) {
         (*this).header = ds.getHeader();
-        (*this).sequence = translate(transcribe(ds.getSequence()), code);
+        (*this).sequence = translate(ds.getSequence(), code);
         (*this).sequenceLength = (*this).sequence.length();
     }
 
@@ -118,15 +277,20 @@ namespace bioinfo {
     }
 
     // Get the header of the AAString
-    std::string AAString::getHeader() {
+    const std::string &AAString::getHeader() {
         return (*this).header;
     }
 
     // Get the sequence of the AAString
-    std::string AAString::getSequence() {
+    const std::string &AAString::getSequence() {
         return (*this).sequence;
     }
 
+    // Get a view of the sequence of the AAString that stays valid until the sequence is changed
+    SequenceView AAString::getSequenceView() {
+        return SequenceView((*this).sequence);
+    }
+
     // Get how many amino acids are in the sequence (including stop codons)
     unsigned int AAString::getSequenceLength() {
         return (*this).sequenceLength;
@@ -134,151 +298,326 @@ namespace bioinfo {
 
     // Change the header of the AAString
     void AAString::setHeader(std::string h) {
-        (*this).sequence = h;
+        (*this).header = std::move(h);
     }
 
     // Change the seuqence of the AAString
     void AAString::setSequence(std::string s, const AATable &code) {
-        (*this).sequence = translate(transcribe(s), code);
+        (*this).sequence = translate(std::move(s), code);
         (*this).sequenceLength = (*this).sequence.length();
     }
 
     // --------------------------------------------------------------------------
 
-    // Return a version of the string `s` with all uppercase letters
-    std::string toUpper(std::string s) {
-        unsigned int i;
-        unsigned int sLength = s.length();
+    // Uppercase the ASCII letters of `s` in place, 16 characters at a time where SSE2 is available.
+    void toUpperInPlace(std::string &s) {
+        toUpperInPlace(&s[0], s.length());
+    }
+
+    // Uppercase the ASCII letters of the `n` characters at `p` in place.
+    void toUpperInPlace(char *p, size_t n) {
+        size_t i = 0;
+
+#ifdef __SSE2__
+        const __m128i before = _mm_set1_epi8('a' - 1);
+        const __m128i after = _mm_set1_epi8('z' + 1);
+        const __m128i caseBit = _mm_set1_epi8(0x20);
+        __m128i c;
+        __m128i lower;
+
+        for (; i + 16 <= n; i += 16) {
+            c = _mm_loadu_si128((const __m128i *) (p + i));
+            lower = _mm_and_si128(_mm_cmpgt_epi8(c, before), _mm_cmpgt_epi8(after, c));
+            _mm_storeu_si128((__m128i *) (p + i), _mm_sub_epi8(c, _mm_and_si128(lower, caseBit)));
+        }
+#endif
+
+        for (; i < n; ++i) {
+            if (p[i] >= 'a' && p[i] <= 'z') {
+                p[i] -= 0x20;
+            }
+        }
+    }
+
+    // Uppercase `s` and replace every T with U in place, 16 characters at a time where SSE2 is available.
+    void transcribeInPlace(std::string &s) {
+        char *p = &s[0];
+        size_t n = s.length();
+        size_t i = 0;
+
+        toUpperInPlace(s);
+
+#ifdef __SSE2__
+        const __m128i thymine = _mm_set1_epi8('T');
+        const __m128i one = _mm_set1_epi8(1);
+        __m128i c;
+
+        // 'U' is the character right after 'T'
+        for (; i + 16 <= n; i += 16) {
+            c = _mm_loadu_si128((const __m128i *) (p + i));
+            _mm_storeu_si128((__m128i *) (p + i), _mm_add_epi8(c, _mm_and_si128(_mm_cmpeq_epi8(c, thymine), one)));
+        }
+#endif
+
+        for (; i < n; ++i) {
+            if (p[i] == 'T') {
+                p[i] = 'U';
+            }
+        }
+    }
+
+    // IUPAC complement of every uppercase letter, indexed by the low 5 bits of the character. Letters that are not IUPAC
+    // nucleotide codes complement to 'N'.
+    static const char IUPAC_COMPLEMENTS[32] = {
+        'N', 'T', 'V', 'G', 'H', 'N', 'N', 'C', 'D', 'N', 'N', 'M', 'N', 'K', 'N', 'N',
+        'N', 'N', 'Y', 'S', 'A', 'A', 'B', 'W', 'N', 'R', 'N', 'N', 'N', 'N', 'N', 'N'
+    };
+
+    // Lookup table from a character to its IUPAC complement, keeping the case of letters. Anything that is not a letter
+    // complements to 'N'.
+    static const std::vector<char> COMPLEMENT_TABLE = []() {
+        std::vector<char> table(256, 'N');
+        unsigned int c;
+
+        for (c = 'A'; c <= 'Z'; ++c) {
+            table[c] = IUPAC_COMPLEMENTS[c & 0x1F];
+            table[c | 0x20] = IUPAC_COMPLEMENTS[c & 0x1F] | 0x20;
+        }
+
+        return table;
+    }();
+
+    // Reverse complement `n` characters from both ends of `p` towards the middle with the lookup table.
+    static void reverseComplementScalar(char *p, size_t n) {
+        size_t i;
+        char front;
+
+        for (i = 0; i < n / 2; ++i) {
+            front = COMPLEMENT_TABLE[(unsigned char) p[i]];
+            p[i] = COMPLEMENT_TABLE[(unsigned char) p[n - i - 1]];
+            p[n - i - 1] = front;
+        }
+
+        if (n % 2 == 1) {
+            p[n / 2] = COMPLEMENT_TABLE[(unsigned char) p[n / 2]];
+        }
+    }
+
+#ifdef BIOINFO_X86_KERNELS
+    // Complement and reverse 16 characters. The complement is two 16 entry `pshufb` lookups on the low 5 bits of each letter,
+    // with the case bit copied back from the input.
+    __attribute__((target("ssse3"))) static inline __m128i reverseComplementBlock(__m128i c) {
+        const __m128i lowTable = _mm_loadu_si128((const __m128i *) IUPAC_COMPLEMENTS);
+        const __m128i highTable = _mm_loadu_si128((const __m128i *) (IUPAC_COMPLEMENTS + 16));
+        const __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+        const __m128i lowBits = _mm_set1_epi8(0x0F);
+        const __m128i highBit = _mm_set1_epi8(0x10);
+        const __m128i caseBit = _mm_set1_epi8(0x20);
+        const __m128i before = _mm_set1_epi8('a' - 1);
+        const __m128i after = _mm_set1_epi8('z' + 1);
+
+        __m128i index = _mm_and_si128(c, lowBits);
+        __m128i high = _mm_cmpeq_epi8(_mm_and_si128(c, highBit), highBit);
+        __m128i complement = _mm_or_si128(_mm_and_si128(high, _mm_shuffle_epi8(highTable, index)),
+                                          _mm_andnot_si128(high, _mm_shuffle_epi8(lowTable, index)));
+        __m128i folded = _mm_or_si128(c, caseBit);
+        __m128i letter = _mm_and_si128(_mm_cmpgt_epi8(folded, before), _mm_cmpgt_epi8(after, folded));
+
+        complement = _mm_or_si128(complement, _mm_and_si128(c, caseBit));
+        complement = _mm_or_si128(_mm_and_si128(letter, complement), _mm_andnot_si128(letter, _mm_set1_epi8('N')));
+
+        return _mm_shuffle_epi8(complement, reverse);
+    }
+
+    // Reverse complement in place 16 characters at a time from both ends, finishing the middle with the lookup table.
+    __attribute__((target("ssse3"))) static void reverseComplementSSSE3(char *p, size_t n) {
+        size_t i = 0;
+        __m128i front;
+        __m128i back;
+
+        for (; (i + 16) * 2 <= n; i += 16) {
+            front = _mm_loadu_si128((const __m128i *) (p + i));
+            back = _mm_loadu_si128((const __m128i *) (p + n - i - 16));
+            _mm_storeu_si128((__m128i *) (p + i), reverseComplementBlock(back));
+            _mm_storeu_si128((__m128i *) (p + n - i - 16), reverseComplementBlock(front));
+        }
+
+        reverseComplementScalar(p + i, n - i * 2);
+    }
+#endif
 
-        for (i = 0; i < sLength; ++i) {
-            s.at(i) = std::toupper(s.at(i));
+    // Reverse complement the nucleotide string `s` in place, including the IUPAC ambiguity codes (R <-> Y, K <-> M, B <-> V,
+    // D <-> H, with S, W and N unchanged). U complements to A, and anything that is not a letter becomes 'N'.
+    void reverseComplementInPlace(std::string &s) {
+#ifdef BIOINFO_X86_KERNELS
+        static const bool ssse3 = __builtin_cpu_supports("ssse3");
+
+        if (ssse3) {
+            reverseComplementSSSE3(&s[0], s.length());
+            return;
         }
+#endif
+
+        reverseComplementScalar(&s[0], s.length());
+    }
 
+    // Return a version of the string `s` with all uppercase letters
+    std::string toUpper(std::string s) {
+        toUpperInPlace(s);
         return s;
     }
 
     // Transcribe a string of DNA to RNA
     std::string transcribe(std::string s) {
+        transcribeInPlace(s);
+        return s;
+    }
+
+    // Lookup table from a character to its 2-bit nucleotide code (T and U share a code), or 4 if it is not a base
+    static const std::vector<unsigned char> CODON_BASE_CODES = []() {
+        std::vector<unsigned char> table(256, 4);
+        const std::string bases = "ACGU";
+
+        for (unsigned int i = 0; i < bases.length(); ++i) {
+            table[(unsigned char) bases[i]] = i;
+            table[(unsigned char) std::tolower(bases[i])] = i;
+        }
+
+        table['T'] = 3;
+        table['t'] = 3;
+
+        return table;
+    }();
+
+    // Create a flat 64 entry codon table from the genetic code table `code`, whose codons may be spelled with U or T. Codons
+    // missing from `code` in both spellings translate to 'X'.
+    CodonTable::CodonTable(const AATable &code) {
+        const std::string bases = "ACGU";
+        AATable::const_iterator it;
+        std::string codon = "AAA";
         unsigned int i;
-        unsigned int sLength = s.length();
 
-        for (i = 0; i < sLength; ++i) {
-            s.at(i) = std::toupper(s.at(i));
+        for (i = 0; i < 64; ++i) {
+            codon[0] = bases[i >> 4];
+            codon[1] = bases[(i >> 2) & 3];
+            codon[2] = bases[i & 3];
 
-            if (s.at(i) == 'T') {
-                s.at(i) = 'U';
+            it = code.find(codon);
+
+            if (it == code.end()) {
+                std::replace(codon.begin(), codon.end(), 'U', 'T');
+                it = code.find(codon);
             }
+
+            (*this).aminoAcids[i] = it != code.end() ? it->second : 'X';
         }
+    }
 
-        return s;
+    // Get the amino acid of the codon with index `index`
+    char CodonTable::translateCodon(unsigned int index) const {
+        return (*this).aminoAcids[index & 63];
     }
 
-    // Translate a string of RNA to AA
-    std::string translate(std::string s, const AATable &code) {
-        unsigned int i;
-        unsigned int sLength = s.length();
-        AATable::const_iterator it;
-        std::string window = "";
-        std::string newSeq = "";
-        
-        if (sLength > 2) {
-            for (i = 0; i < sLength-2; i += 3) {
-                s.at(i) = std::toupper(s.at(i));
-                s.at(i+1) = std::toupper(s.at(i+1));
-                s.at(i+2) = std::toupper(s.at(i+2));
-
-                window = s.substr(i, 3);
-                it = code.find(window);
-
-                if (it != code.end()) {
-                    newSeq += code.at(window);
-                } else {
-                    newSeq += "X";
-                }
+    // Translate a string of DNA or RNA to AA in reading frame 1. The output is sized up front and every codon is a single
+    // table lookup; codons containing anything other than A, C, G, T or U translate to 'X'.
+    std::string CodonTable::translate(const std::string &s) const {
+        std::string protein(s.length() / 3, 'X');
+        unsigned int a;
+        unsigned int b;
+        unsigned int c;
+        size_t i;
+
+        for (i = 0; i < protein.length(); ++i) {
+            a = CODON_BASE_CODES[(unsigned char) s[i * 3]];
+            b = CODON_BASE_CODES[(unsigned char) s[i * 3 + 1]];
+            c = CODON_BASE_CODES[(unsigned char) s[i * 3 + 2]];
+
+            if ((a | b | c) < 4) {
+                protein[i] = (*this).aminoAcids[(a << 4) | (b << 2) | c];
             }
         }
 
-        return newSeq;
+        return protein;
     }
 
-    // Reverse complement the sequence of a DNAString
-    DNAString reverseComplement(DNAString &ds) {
-        DNAString rc = DNAString(ds.getHeader(), "");
-        std::string s = "";
+    // Translate all six reading frames of a string of DNA or RNA in one pass. Frames 0 to 2 read the forward strand from
+    // offsets 0 to 2, and frames 3 to 5 read the reverse complement from offsets 0 to 2. A rolling 6-bit index is kept for
+    // both strands, so every base is decoded once.
+    std::vector<std::string> CodonTable::translateSixFrames(const std::string &s) const {
+        std::vector<std::string> frames(6);
+        size_t n = s.length();
+        size_t lastInvalid = 0;
+        size_t i;
+        size_t j;
+        unsigned int code;
+        unsigned int forward = 0;
+        unsigned int reverse = 0;
+        unsigned int f;
+
+        for (f = 0; f < 3; ++f) {
+            frames[f].assign(n > f ? (n - f) / 3 : 0, 'X');
+            frames[f + 3].assign(n > f ? (n - f) / 3 : 0, 'X');
+        }
 
-        unsigned int i;
-        char oldC;
-        char newC;
-
-        for (i = 0; i < ds.getSequenceLength(); ++i) {
-            oldC = ds.getSequence().at(ds.getSequenceLength() - i - 1);
-
-            switch (oldC) {
-                case 'A':
-                    newC = 'T';
-                    break;
-                case 'C':
-                    newC = 'G';
-                    break;
-                case 'G':
-                    newC = 'C';
-                    break;
-                case 'T':
-                    newC = 'A';
-                    break;
-                default:
-                    newC = 'N';
+        for (i = 0; i < n; ++i) {
+            code = CODON_BASE_CODES[(unsigned char) s[i]];
+
+            if (code > 3) {
+                lastInvalid = i + 1;
+                code = 0;
             }
 
-            s += newC;
+            forward = ((forward << 2) | code) & 63;
+            reverse = (reverse >> 2) | ((3 - code) << 4);
+
+            if (i < 2 || i < lastInvalid + 2) {
+                continue;
+            }
+
+            // Forward codon [i - 2, i] and the reverse strand codon starting at j = n - 1 - i
+            f = (i - 2) % 3;
+            frames[f][(i - 2 - f) / 3] = (*this).aminoAcids[forward];
+
+            j = n - 1 - i;
+            f = j % 3;
+
+            if ((j - f) / 3 < frames[f + 3].length()) {
+                frames[f + 3][(j - f) / 3] = (*this).aminoAcids[reverse];
+            }
         }
 
-        rc.setSequence(s);
+        return frames;
+    }
+
+    // Translate a string of RNA to AA
+    std::string translate(std::string s, const AATable &code) {
+        return CodonTable(code).translate(s);
+    }
+
+    // Translate the six reading frames of a DNAString with the codon table `ct`
+    std::vector<std::string> translateSixFrames(DNAString &ds, const CodonTable &ct) {
+        return ct.translateSixFrames(ds.getSequence());
+    }
+
+    // Reverse complement the sequence of a DNAString
+    DNAString reverseComplement(DNAString &ds) {
+        DNAString rc = ds;
+
+        rc.reverseComplementInPlace();
         return rc;
     }
 
-    // Read a FASTA file with name `fn` and return a vector of DNAString objects.
+    // Read a FASTA file with name `fn` and return a vector of DNAString objects. The file is streamed through a FASTAReader
+    // so that only one record is being parsed at a time.
     std::vector<DNAString> readDNAStringFile(std::string &fn) {
         std::vector<DNAString> vec;
-        std::ifstream file(fn);
+        FASTAReader reader(fn);
+        DNAString ds;
 
-        std::string txt;
-        std::string header = "";
-        std::string seq = "";
-
-        if (!file.good()) {
-            throw std::invalid_argument("ERROR: readDNAStringFile could not open file!");
-        } else {
-            while (std::getline(file, txt)) {
-                if (txt.empty()) {
-                    continue;
-                } else if (txt.at(0) == '>') {
-                    if (!header.empty()) {
-                        DNAString ds = DNAString(header, seq);
-                        vec.push_back(ds);
-                    }
-
-                    header = txt.substr(1);
-                    while (header.back() == '\n' || header.back() == '\r') {
-                        header.pop_back();
-                    }
-                    seq = "";
-                } else {
-                    seq += txt;
-                    while (seq.back() == '\n' || seq.back() == '\r') {
-                        seq.pop_back();
-                    }
-                }
-            }
-
-            if (!header.empty()) {
-                DNAString ds = DNAString(header, seq);
-                vec.push_back(ds);
-            }
+        while (reader.next(ds)) {
+            vec.push_back(std::move(ds));
         }
 
-        file.close();
-
         return vec;
     }
 
@@ -287,4 +626,10 @@ namespace bioinfo {
         std::string fn = std::string(fnp);
         return readDNAStringFile(fn);
     }
+
+    // Read a FASTA file with name `fn` on `threads` threads (0 for one per core) and return a vector of DNAString objects in
+    // file order.
+    std::vector<DNAString> readDNAStringFile(std::string &fn, unsigned int threads) {
+        return readFASTAFileParallel(fn, threads);
+    }
 }
\ No newline at end of file
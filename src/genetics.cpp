@@ -1,6 +1,5 @@
 #include <genetics.hpp>
 #include <biomath.hpp>
-#include <unordered_map>
 #include <limits.h>
 #include <stdexcept>
 #include <vector>
@@ -44,72 +43,41 @@ namespace bioinfo {
 
     // Calculate how many rabbits exists after `n` generations.
     unsigned long int WascallyWabbits::simulate(unsigned int n) {
-        return fibonacci(n);
+        try {
+            return fibonacciRecurrence((*this).rabbitPairs).termChecked(n);
+        } catch (const std::overflow_error &e) {
+            throw std::overflow_error("ERROR: WascallyWabbits calculated too many wabbits!");
+        }
     }
 
-    // Calculate how many rabbits exists after `n` generations with a rabbit lifespan of `m`.
-    unsigned long int WascallyWabbits::simulateMortal(unsigned int n, unsigned int m) {
-        return MortalFibonacci(n, m);
-    }
-
-    unsigned long int WascallyWabbits::fibonacci(unsigned int n) {
-        unsigned long int fn = 0;
-
-        if (n == 0) {
-            fn = 0;
-        } else if (n == 1) {
-            fn = 1;
-        }  else {
-            unsigned long int fnMinusOne;
-            unsigned long int fnMinusTwo;
-
-            // See if Fn-1 has not yet been added to the timeline hashtable
-            // Calculate and add it if it hasn't
-            if ((*this).timeline.find(n - 1) == (*this).timeline.end()) {
-                fnMinusOne = fibonacci(n - 1);
-                (*this).timeline[n - 1] = fnMinusOne;
-            } else {
-                fnMinusOne = (*this).timeline[n - 1];
-            }
-
-            fnMinusTwo = (*this).timeline[n - 2];
+    // Calculate how many rabbits exists after `n` generations modulo `modulus`.
+    unsigned long int WascallyWabbits::simulate(unsigned int n, unsigned long int modulus) {
+        return fibonacciRecurrence((*this).rabbitPairs).term(n, modulus);
+    }
 
-            // See if there will be an overflow when adding together Fn-1 and Fn-2
-            if (fnMinusTwo > 0 && fnMinusOne > ULONG_MAX - fnMinusTwo) {
-                throw std::overflow_error("ERROR: WascallyWabbits calculated too many wabbits!");
-            }
+    // Calculate exactly how many rabbits exists after `n` generations.
+    BigUnsigned WascallyWabbits::simulateBig(unsigned int n) {
+        return fibonacciRecurrence((*this).rabbitPairs).term(n);
+    }
 
-            fn = fnMinusOne + fnMinusTwo * (*this).rabbitPairs;
+    // Calculate how many rabbits exists after `n` generations with a rabbit lifespan of `m`. Rabbits with a lifespan of 1 die
+    // before they can breed, so with `m` = 1 none are left after the first generation.
+    unsigned long int WascallyWabbits::simulateMortal(unsigned int n, unsigned int m) {
+        try {
+            return mortalFibonacciRecurrence((*this).rabbitPairs, m).termChecked(n > 0 ? n - 1 : 0);
+        } catch (const std::overflow_error &e) {
+            throw std::overflow_error("ERROR: WascallyWabbits calculated too many wabbits!");
         }
-
-        return fn;
     }
 
-    unsigned long int WascallyWabbits::MortalFibonacci(unsigned int n, unsigned int m) {
-        unsigned long int fn = 0;
-        unsigned int i;
-        unsigned long int currPop;
-
-        std::vector<unsigned long int> populations = {1, 1};
-
-        for(i = 2; i < n; ++i) {
-            if (populations.at(i - 2) > 0 && populations.at(i - 1) > ULONG_MAX - populations.at(i - 2)) {
-                throw std::overflow_error("ERROR: WascallyWabbits calculated too many wabbits!");
-            }
-
-            currPop = populations.at(i - 1) + populations.at(i - 2) * (*this).rabbitPairs;
-
-            if (i == m) {
-                currPop = currPop - 1;
-            } else if (i > m) {
-                currPop = currPop - populations.at(i - m - 1);
-            }
-
-            populations.push_back(currPop);
-        }
+    // Calculate how many rabbits exists after `n` generations with a rabbit lifespan of `m` modulo `modulus`.
+    unsigned long int WascallyWabbits::simulateMortal(unsigned int n, unsigned int m, unsigned long int modulus) {
+        return mortalFibonacciRecurrence((*this).rabbitPairs, m).term(n > 0 ? n - 1 : 0, modulus);
+    }
 
-        fn = populations.back();
-        return fn;
+    // Calculate exactly how many rabbits exists after `n` generations with a rabbit lifespan of `m`.
+    BigUnsigned WascallyWabbits::simulateMortalBig(unsigned int n, unsigned int m) {
+        return mortalFibonacciRecurrence((*this).rabbitPairs, m).term(n > 0 ? n - 1 : 0);
     }
 
     // Calculate the expected number of offspring displaying the dominant phenotype in the next generation with `n` number of
@@ -121,7 +89,7 @@ namespace bioinfo {
         unsigned int genotypes[6] = {mg.dd, mg.dh, mg.dr, mg.hh, mg.hr, mg.rr};
         double dominantPhenotypeCoefficients[6] = {1.0, 1.0, 1.0, 0.75, 0.5, 0.0};
 
-        for (i = 0; i <= 6; ++i) {
+        for (i = 0; i < 6; ++i) {
             expected += genotypes[i] * dominantPhenotypeCoefficients[i] * n;
         }
 
@@ -135,14 +103,154 @@ namespace bioinfo {
     // - Toms has two children, who each have two children, and so on
     // - Each organism always mates with another Aa Bb organism
     double tomsIndependentAlleles(unsigned int k, unsigned long int n) {
-        double prob = 0.0;
-        unsigned int i;
         unsigned int pop = pow(2, k);
 
-        for (i = n; i < pop + 1; ++i) {
-            prob += binomialDistribution(pop, i, 0.25);
+        if (n > pop) {
+            return 0.0;
+        }
+
+        return binomialTail(pop, n, 0.25);
+    }
+
+    // Offspring genotype (AA, Aa, aa) probabilities of the mating groups in `GenotypesCount` order
+    static const double MATING_OFFSPRING[6][3] = {
+        {1.0, 0.0, 0.0}, // AA-AA
+        {0.5, 0.5, 0.0}, // AA-Aa
+        {0.0, 1.0, 0.0}, // AA-aa
+        {0.25, 0.5, 0.25}, // Aa-Aa
+        {0.0, 0.5, 0.5}, // Aa-aa
+        {0.0, 0.0, 1.0} // aa-aa
+    };
+
+    // Simulate the genotypes of the next generation `replicates` times when every mating group of `mg` has `n` offspring,
+    // the stochastic counterpart of `calculateExpectedOffspring`. Replicate i draws from stream i of `seed`, so the results
+    // do not depend on `threads`.
+    std::vector<PopulationGenotypes> simulateOffspring(GenotypesCount mg, unsigned int n, unsigned int replicates,
+                                                       uint64_t seed, unsigned int threads) {
+        std::vector<PopulationGenotypes> results(replicates);
+        unsigned long int groups[6] = {mg.dd, mg.dh, mg.dr, mg.hh, mg.hr, mg.rr};
+
+        parallelFor(replicates, threads, [&](size_t r) {
+            PhiloxRandom rng(seed, r);
+            unsigned long int counts[3];
+            unsigned int i;
+
+            for (i = 0; i < 6; ++i) {
+                if (groups[i] == 0 || n == 0) {
+                    continue;
+                }
+
+                sampleMultinomial(rng, groups[i] * n, MATING_OFFSPRING[i], counts, 3);
+                results[r].dominant += counts[0];
+                results[r].heterozygous += counts[1];
+                results[r].recessive += counts[2];
+            }
+        });
+
+        return results;
+    }
+
+    // Throw unless `start` and `model` describe a population that can be simulated.
+    static void checkPopulationModel(const PopulationGenotypes &start, const PopulationModel &model) {
+        if (start.dominant + start.heterozygous + start.recessive == 0) {
+            throw std::invalid_argument("ERROR: Starting population cannot be empty!");
+        } else if (!(model.dominantFitness >= 0.0 && model.heterozygousFitness >= 0.0 && model.recessiveFitness >= 0.0)) {
+            throw std::invalid_argument("ERROR: Fitness cannot be negative!");
+        } else if (!(model.dominantMutation >= 0.0 && model.dominantMutation <= 1.0 && model.recessiveMutation >= 0.0 &&
+                     model.recessiveMutation <= 1.0)) {
+            throw std::invalid_argument("ERROR: Mutation rates must be between 0 and 1!");
+        }
+    }
+
+    // Draw the generation after `current`: selection weights the parents by fitness, mutation changes the alleles of their
+    // gametes, and drift comes from drawing `size` offspring by random union of those gametes.
+    static PopulationGenotypes nextGeneration(PhiloxRandom &rng, const PopulationGenotypes &current,
+                                              const PopulationModel &model, unsigned long int size) {
+        PopulationGenotypes next;
+        double dominantWeight = current.dominant * model.dominantFitness;
+        double heterozygousWeight = current.heterozygous * model.heterozygousFitness;
+        double totalWeight = dominantWeight + heterozygousWeight + current.recessive * model.recessiveFitness;
+        double p;
+        double genotypes[3];
+        unsigned long int counts[3];
+
+        if (totalWeight <= 0.0) {
+            throw std::runtime_error("ERROR: No individual of the population can reproduce!");
+        }
+
+        // Frequency of A among the gametes after selection and then mutation
+        p = (dominantWeight + 0.5 * heterozygousWeight) / totalWeight;
+        p = p * (1.0 - model.dominantMutation) + (1.0 - p) * model.recessiveMutation;
+
+        genotypes[0] = p * p;
+        genotypes[1] = 2.0 * p * (1.0 - p);
+        genotypes[2] = (1.0 - p) * (1.0 - p);
+
+        sampleMultinomial(rng, size, genotypes, counts, 3);
+        next.dominant = counts[0];
+        next.heterozygous = counts[1];
+        next.recessive = counts[2];
+
+        return next;
+    }
+
+    // Run replicate `r` of a Wright-Fisher simulation for `generations` generations, keeping every generation in
+    // `trajectory` when it is not null, and return the last generation.
+    static PopulationGenotypes wrightFisherReplicate(PopulationGenotypes start, const PopulationModel &model,
+                                                    unsigned int generations, uint64_t seed, size_t r,
+                                                    std::vector<PopulationGenotypes> *trajectory) {
+        PhiloxRandom rng(seed, r);
+        PopulationGenotypes current = start;
+        unsigned long int size = model.size > 0 ? model.size : start.dominant + start.heterozygous + start.recessive;
+        unsigned int g;
+
+        if (trajectory != nullptr) {
+            trajectory->reserve(generations + 1);
+            trajectory->push_back(current);
         }
 
-        return prob;
+        for (g = 0; g < generations; ++g) {
+            current = nextGeneration(rng, current, model, size);
+
+            if (trajectory != nullptr) {
+                trajectory->push_back(current);
+            }
+        }
+
+        return current;
+    }
+
+    // Simulate `replicates` independent Wright-Fisher populations descending from `start` under `model` for `generations`
+    // generations and return the last generation of each. Replicate i draws from stream i of `seed`, so the results do not
+    // depend on `threads`.
+    std::vector<PopulationGenotypes> wrightFisher(PopulationGenotypes start, const PopulationModel &model,
+                                                  unsigned int generations, unsigned int replicates, uint64_t seed,
+                                                  unsigned int threads) {
+        std::vector<PopulationGenotypes> results(replicates);
+
+        checkPopulationModel(start, model);
+
+        parallelFor(replicates, threads, [&](size_t r) {
+            results[r] = wrightFisherReplicate(start, model, generations, seed, r, nullptr);
+        });
+
+        return results;
+    }
+
+    // Simulate like `wrightFisher` but return every generation of each replicate, starting with `start`.
+    std::vector<std::vector<PopulationGenotypes>> wrightFisherTrajectories(PopulationGenotypes start,
+                                                                           const PopulationModel &model,
+                                                                           unsigned int generations,
+                                                                           unsigned int replicates, uint64_t seed,
+                                                                           unsigned int threads) {
+        std::vector<std::vector<PopulationGenotypes>> results(replicates);
+
+        checkPopulationModel(start, model);
+
+        parallelFor(replicates, threads, [&](size_t r) {
+            wrightFisherReplicate(start, model, generations, seed, r, &results[r]);
+        });
+
+        return results;
     }
 }
\ No newline at end of file
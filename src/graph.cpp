@@ -0,0 +1,448 @@
+#include <graph.hpp>
+#include <analysis.hpp>
+#include <fundamentals.hpp>
+#include <parallel.hpp>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+#include <climits>
+
+namespace bioinfo {
+    const unsigned int NO_NODE = UINT_MAX;
+    const size_t GRAPH_TASK_NODES = 4096; // Nodes or unitig starts handled by one task of the parallel passes
+
+    // Create an empty graph, filled in by the builders
+    CompactGraph::CompactGraph() {
+        (*this).outOffsets.push_back(0);
+        (*this).inOffsets.push_back(0);
+        (*this).overlap = 0;
+    }
+
+    // Create a graph with a node for every label in `labels` and the directed edges (tail, head) in `edges`, given by node ID.
+    // Out-edges keep the order they are given in. `overlap` is how many characters the labels of neighbouring nodes share,
+    // used to spell paths.
+    CompactGraph::CompactGraph(std::vector<std::string> labels, const std::vector<std::pair<unsigned int, unsigned int>> &edges,
+                               unsigned int overlap) {
+        std::vector<size_t> next;
+        size_t n = labels.size();
+        size_t i;
+
+        (*this).labels = std::move(labels);
+        (*this).weights.assign(n, 1);
+        (*this).overlap = overlap;
+        (*this).outOffsets.assign(n + 1, 0);
+
+        for (const std::pair<unsigned int, unsigned int> &e : edges) {
+            if (e.first >= n || e.second >= n) {
+                throw std::out_of_range("ERROR: Graph edge refers to a node that does not exist!");
+            }
+
+            ++(*this).outOffsets[e.first + 1];
+        }
+
+        for (i = 0; i < n; ++i) {
+            (*this).outOffsets[i + 1] += (*this).outOffsets[i];
+        }
+
+        next.assign((*this).outOffsets.begin(), (*this).outOffsets.end() - 1);
+        (*this).outTargets.resize(edges.size());
+
+        for (const std::pair<unsigned int, unsigned int> &e : edges) {
+            (*this).outTargets[next[e.first]++] = e.second;
+        }
+
+        (*this).buildInEdges();
+    }
+
+    // Create the graph of an overlap AdjacencyList, one node per distinct header in the order they first appear in its edges.
+    // The labels are headers rather than sequences, so the overlap is 0 and spelt paths are the headers back to back.
+    CompactGraph::CompactGraph(const AdjacencyList &al) : CompactGraph() {
+        std::unordered_map<std::string, unsigned int> ids;
+        std::vector<std::pair<unsigned int, unsigned int>> edges;
+        std::vector<std::string> names;
+
+        auto idOf = [&](const std::string &h) {
+            std::pair<std::unordered_map<std::string, unsigned int>::iterator, bool> it = ids.emplace(h, names.size());
+
+            if (it.second) {
+                names.push_back(h);
+            }
+
+            return it.first->second;
+        };
+
+        edges.reserve(al.getEdges().size());
+
+        for (const DirectedEdge &e : al.getEdges()) {
+            unsigned int tail = idOf(e.tail);
+
+            edges.emplace_back(tail, idOf(e.head));
+        }
+
+        *this = CompactGraph(std::move(names), edges, 0);
+    }
+
+    // Fill in the in-edges from the out-edges. Sources of every node are in increasing order.
+    void CompactGraph::buildInEdges() {
+        std::vector<size_t> next;
+        size_t n = (*this).labels.size();
+        size_t i;
+        size_t e;
+
+        (*this).inOffsets.assign(n + 1, 0);
+
+        for (unsigned int t : (*this).outTargets) {
+            ++(*this).inOffsets[t + 1];
+        }
+
+        for (i = 0; i < n; ++i) {
+            (*this).inOffsets[i + 1] += (*this).inOffsets[i];
+        }
+
+        next.assign((*this).inOffsets.begin(), (*this).inOffsets.end() - 1);
+        (*this).inSources.resize((*this).outTargets.size());
+
+        for (i = 0; i < n; ++i) {
+            for (e = (*this).outOffsets[i]; e < (*this).outOffsets[i + 1]; ++e) {
+                (*this).inSources[next[(*this).outTargets[e]]++] = i;
+            }
+        }
+    }
+
+    // Get how many nodes are in the graph
+    size_t CompactGraph::getNodeCount() const {
+        return (*this).labels.size();
+    }
+
+    // Get how many directed edges are in the graph
+    size_t CompactGraph::getEdgeCount() const {
+        return (*this).outTargets.size();
+    }
+
+    // Get how many characters the labels of neighbouring nodes share
+    unsigned int CompactGraph::getOverlap() const {
+        return (*this).overlap;
+    }
+
+    // Get the header or k-mer of node `i`
+    const std::string &CompactGraph::getLabel(unsigned int i) const {
+        if (i >= (*this).getNodeCount()) {
+            throw std::out_of_range("ERROR: Graph node is out of range!");
+        }
+
+        return (*this).labels[i];
+    }
+
+    // Get the coverage of node `i`
+    unsigned long int CompactGraph::getWeight(unsigned int i) const {
+        if (i >= (*this).getNodeCount()) {
+            throw std::out_of_range("ERROR: Graph node is out of range!");
+        }
+
+        return (*this).weights[i];
+    }
+
+    // Get how many edges leave node `i`
+    unsigned int CompactGraph::getOutDegree(unsigned int i) const {
+        return (*this).outOffsets[i + 1] - (*this).outOffsets[i];
+    }
+
+    // Get how many edges enter node `i`
+    unsigned int CompactGraph::getInDegree(unsigned int i) const {
+        return (*this).inOffsets[i + 1] - (*this).inOffsets[i];
+    }
+
+    // Get the head of the `j`th edge leaving node `i`
+    unsigned int CompactGraph::getOutNeighbour(unsigned int i, unsigned int j) const {
+        if (j >= (*this).getOutDegree(i)) {
+            throw std::out_of_range("ERROR: Graph edge is out of range!");
+        }
+
+        return (*this).outTargets[(*this).outOffsets[i] + j];
+    }
+
+    // Get the tail of the `j`th edge entering node `i`
+    unsigned int CompactGraph::getInNeighbour(unsigned int i, unsigned int j) const {
+        if (j >= (*this).getInDegree(i)) {
+            throw std::out_of_range("ERROR: Graph edge is out of range!");
+        }
+
+        return (*this).inSources[(*this).inOffsets[i] + j];
+    }
+
+    // Split the graph into unitigs, the maximal paths whose inner edges are the only edge out of their tail and the only edge
+    // into their head. Every node is in exactly one unitig. A unitig starts at every node whose in-edge cannot be merged,
+    // so those are walked in parallel; what is left over are isolated cycles, walked afterwards from their lowest node.
+    std::vector<std::vector<unsigned int>> CompactGraph::unitigs(unsigned int threads) const {
+        std::vector<std::vector<unsigned int>> paths;
+        std::vector<unsigned int> starts;
+        std::vector<unsigned char> visited((*this).getNodeCount(), 0);
+        size_t n = (*this).getNodeCount();
+        size_t tasks;
+        unsigned int i;
+        unsigned int cur;
+
+        for (i = 0; i < n; ++i) {
+            if ((*this).getInDegree(i) != 1 || (*this).getOutDegree((*this).inSources[(*this).inOffsets[i]]) != 1) {
+                starts.push_back(i);
+            }
+        }
+
+        paths.resize(starts.size());
+        tasks = (starts.size() + GRAPH_TASK_NODES - 1) / GRAPH_TASK_NODES;
+
+        parallelFor(tasks, threads, [&](size_t t) {
+            size_t end = std::min(starts.size(), (t + 1) * GRAPH_TASK_NODES);
+            size_t s;
+            unsigned int node;
+            unsigned int next;
+
+            for (s = t * GRAPH_TASK_NODES; s < end; ++s) {
+                node = starts[s];
+                paths[s].push_back(node);
+                visited[node] = 1;
+
+                while ((*this).getOutDegree(node) == 1) {
+                    next = (*this).outTargets[(*this).outOffsets[node]];
+
+                    if ((*this).getInDegree(next) != 1) {
+                        break;
+                    }
+
+                    paths[s].push_back(next);
+                    visited[next] = 1;
+                    node = next;
+                }
+            }
+        });
+
+        for (i = 0; i < n; ++i) {
+            if (visited[i]) {
+                continue;
+            }
+
+            paths.emplace_back();
+            cur = i;
+
+            do {
+                paths.back().push_back(cur);
+                visited[cur] = 1;
+                cur = (*this).outTargets[(*this).outOffsets[cur]];
+            } while (cur != i);
+        }
+
+        return paths;
+    }
+
+    // Spell the sequence along `path`: the label of the first node, then every following label without the characters it
+    // shares with the one before it
+    std::string CompactGraph::spellPath(const std::vector<unsigned int> &path) const {
+        std::string s;
+        size_t length = 0;
+        size_t i;
+
+        for (i = 0; i < path.size(); ++i) {
+            const std::string &label = (*this).getLabel(path[i]);
+
+            if (i > 0 && label.length() < (*this).overlap) {
+                throw std::invalid_argument("ERROR: Graph label is shorter than the overlap!");
+            }
+
+            length += i == 0 ? label.length() : label.length() - (*this).overlap;
+        }
+
+        s.reserve(length);
+
+        for (i = 0; i < path.size(); ++i) {
+            s.append((*this).labels[path[i]], i == 0 ? 0 : (*this).overlap, std::string::npos);
+        }
+
+        return s;
+    }
+
+    // --------------------------------------------------------------------------
+
+    // Build the de Bruijn graph of the `k`-mers of every sequence in `vec` seen at least `minCount` times. Nodes are k-mers
+    // weighted by their count, and there is an edge from every k-mer to each of its (up to 4) one base extensions that is
+    // also a node. K-mers are taken from the strand given, so reads from both strands give the two strands of the graph. The
+    // counting and the extension lookups both run across `threads` threads.
+    CompactGraph deBruijnGraph(std::vector<DNAString> &vec, unsigned int k, unsigned long int minCount, unsigned int threads) {
+        const char BASES[4] = {'A', 'C', 'G', 'T'};
+        CompactGraph g;
+        KmerCounts counts(k, false, {}, {});
+        std::vector<unsigned int> nodeOf;
+        std::vector<unsigned int> successors;
+        std::vector<unsigned char> degrees;
+        size_t n = 0;
+        size_t tasks;
+        size_t i;
+
+        if (k < 2) {
+            throw std::invalid_argument("ERROR: De Bruijn graph k-mers need at least 2 bases!");
+        }
+
+        counts = countKmers(vec, k, false, threads);
+        nodeOf.assign(counts.size(), NO_NODE);
+
+        for (i = 0; i < counts.size(); ++i) {
+            if (counts.getCount(i) >= minCount) {
+                nodeOf[i] = n++;
+            }
+        }
+
+        if (n >= NO_NODE) {
+            throw std::length_error("ERROR: De Bruijn graph has too many nodes!");
+        }
+
+        g.labels.resize(n);
+        g.weights.resize(n);
+        successors.resize(4 * n);
+        degrees.assign(n, 0);
+        tasks = (counts.size() + GRAPH_TASK_NODES - 1) / GRAPH_TASK_NODES;
+
+        parallelFor(tasks, threads, [&](size_t t) {
+            size_t end = std::min(counts.size(), (t + 1) * GRAPH_TASK_NODES);
+            std::string extension;
+            size_t j;
+            size_t found;
+            unsigned int node;
+            unsigned int c;
+
+            for (j = t * GRAPH_TASK_NODES; j < end; ++j) {
+                if ((node = nodeOf[j]) == NO_NODE) {
+                    continue;
+                }
+
+                g.labels[node] = counts.getKmer(j);
+                g.weights[node] = counts.getCount(j);
+                extension.assign(g.labels[node], 1, std::string::npos);
+                extension.push_back('A');
+
+                for (c = 0; c < 4; ++c) {
+                    extension.back() = BASES[c];
+                    found = counts.find(extension);
+
+                    if (found < counts.size() && nodeOf[found] != NO_NODE) {
+                        successors[4 * node + degrees[node]++] = nodeOf[found];
+                    }
+                }
+            }
+        });
+
+        g.overlap = k - 1;
+        g.outOffsets.resize(n + 1);
+
+        for (i = 0; i < n; ++i) {
+            g.outOffsets[i + 1] = g.outOffsets[i] + degrees[i];
+        }
+
+        g.outTargets.resize(g.outOffsets[n]);
+
+        for (i = 0; i < n; ++i) {
+            std::copy(successors.begin() + 4 * i, successors.begin() + 4 * i + degrees[i], g.outTargets.begin() + g.outOffsets[i]);
+        }
+
+        g.buildInEdges();
+
+        return g;
+    }
+
+    // Spell every unitig of `g` as a DNAString with header "unitig_<i>". The unitigs are found and spelt in parallel.
+    std::vector<DNAString> compactUnitigs(const CompactGraph &g, unsigned int threads) {
+        std::vector<std::vector<unsigned int>> paths = g.unitigs(threads);
+        std::vector<DNAString> contigs(paths.size());
+
+        parallelFor(paths.size(), threads, [&](size_t i) {
+            contigs[i] = DNAString("unitig_" + std::to_string(i + 1), g.spellPath(paths[i]));
+        });
+
+        return contigs;
+    }
+
+    // Greedily join the unitigs of `g` into contigs. Starting from the unused unitig with the highest mean coverage, the
+    // contig is extended forwards and backwards across branches into the unused neighbouring unitig with the highest mean
+    // coverage, until every neighbour has been used. Contigs have headers "contig_<i>" in the order they were seeded.
+    std::vector<DNAString> greedyAssemble(const CompactGraph &g, unsigned int threads) {
+        std::vector<std::vector<unsigned int>> paths = g.unitigs(threads);
+        std::vector<unsigned int> headOf(g.getNodeCount(), NO_NODE);
+        std::vector<unsigned int> tailOf(g.getNodeCount(), NO_NODE);
+        std::vector<double> coverage(paths.size(), 0);
+        std::vector<unsigned int> order(paths.size());
+        std::vector<unsigned char> used(paths.size(), 0);
+        std::vector<DNAString> contigs;
+        std::deque<unsigned int> chain;
+        std::vector<unsigned int> nodes;
+        unsigned int best;
+        unsigned int j;
+        size_t i;
+
+        for (i = 0; i < paths.size(); ++i) {
+            headOf[paths[i].front()] = i;
+            tailOf[paths[i].back()] = i;
+
+            for (unsigned int v : paths[i]) {
+                coverage[i] += g.getWeight(v);
+            }
+
+            coverage[i] /= paths[i].size();
+            order[i] = i;
+        }
+
+        std::stable_sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+            return coverage[a] > coverage[b] || (coverage[a] == coverage[b] && paths[a].size() > paths[b].size());
+        });
+
+        // Pick the unused unitig next to node `n` (after it when `forwards`) with the highest coverage, NO_NODE when none
+        auto pickNext = [&](unsigned int n, bool forwards) {
+            unsigned int degree = forwards ? g.getOutDegree(n) : g.getInDegree(n);
+            unsigned int choice = NO_NODE;
+            unsigned int c;
+            unsigned int k;
+
+            for (k = 0; k < degree; ++k) {
+                c = forwards ? headOf[g.getOutNeighbour(n, k)] : tailOf[g.getInNeighbour(n, k)];
+
+                if (c != NO_NODE && !used[c] && (choice == NO_NODE || coverage[c] > coverage[choice])) {
+                    choice = c;
+                }
+            }
+
+            return choice;
+        };
+
+        for (unsigned int u : order) {
+            if (used[u]) {
+                continue;
+            }
+
+            used[u] = 1;
+            chain.assign(1, u);
+
+            while ((best = pickNext(paths[chain.back()].back(), true)) != NO_NODE) {
+                used[best] = 1;
+                chain.push_back(best);
+            }
+
+            while ((best = pickNext(paths[chain.front()].front(), false)) != NO_NODE) {
+                used[best] = 1;
+                chain.push_front(best);
+            }
+
+            nodes.clear();
+
+            for (j = 0; j < chain.size(); ++j) {
+                for (unsigned int node : paths[chain[j]]) {
+                    nodes.push_back(node);
+                }
+            }
+
+            contigs.push_back(DNAString("contig_" + std::to_string(contigs.size() + 1), g.spellPath(nodes)));
+        }
+
+        return contigs;
+    }
+}
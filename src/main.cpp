@@ -2,6 +2,10 @@
 #include <iostream>
 #include <iomanip>
 #include <vector>
+#include <string>
+#include <stdexcept>
+#include <cstdio>
+#include <cstdlib>
 // Bioinformatics libs
 #include <fundamentals.hpp>
 #include <genetics.hpp>
@@ -9,18 +13,118 @@
 #include <biomath.hpp>
 #include <query.hpp>
 
-int main() {
+/*
+    Usage: testing [BASE_URL]
+
+    Without arguments the UniProt client is exercised against a LocalUniProtServer: accessions are fetched in batches
+    over two connections while the server fails the first requests, then fetched again from the cache without any
+    requests. With BASE_URL, an http:// UniProt mirror or proxy, the example accession is queried there instead.
+*/
+
+// Throw with `message` unless `condition` holds.
+static void check(bool condition, const std::string &message) {
+    if (!condition) {
+        throw std::runtime_error("ERROR: " + message + "!");
+    }
+}
+
+// Remove the cache directory `dir` and the entries of `accessions` cached in it.
+static void removeCache(const std::string &dir, const std::vector<std::string> &accessions) {
+    size_t i;
+
+    for (i = 0; i < accessions.size(); ++i) {
+        std::remove((dir + "/" + accessions[i] + ".fasta").c_str());
+    }
+
+    std::remove(dir.c_str());
+}
+
+// Fetch accessions from a local stand-in server twice, once over the network with retries and once from the cache, and
+// check that both fetches return the served entries in order.
+static std::vector<bioinfo::AAString> exerciseLocalUniProt() {
+    const std::vector<std::string> sequences = {
+        "MVLSPADKTNVKAAWGKVGAHAGEYGAEALERMFLSFPTTKTYFPHF",
+        "MVHLTPEEKSAVTALWGKVNVDEVGGEALGRLLVVYPWTQRFFESF",
+        "MGLSDGEWQLVLNVWGKVEADIPGHGQEVLIRLFKGHPETLEKFDKF",
+        "MSKGEELFTGVVPILVELDGDVNGHKFSVSGEGEGDATYGKLTLKF",
+        "MKTAYIAKQRQISFVKSHFSRQ"
+    };
+    // The first five are served, Q00000 is unknown to the server and P68871 is asked for twice
+    std::vector<std::string> accessions = {"P69905", "P68871", "P02144", "P42212", "A2Z669", "Q00000", "P68871"};
+    std::vector<bioinfo::AAString> proteins;
+    std::vector<bioinfo::AAString> cached;
+    bioinfo::LocalUniProtServer server;
+    bioinfo::UniProtOptions options;
+    char cacheDir[] = "/tmp/bioinfo-uniprot-XXXXXX";
+    unsigned long int requests;
+    size_t i;
+
+    for (i = 0; i < sequences.size(); ++i) {
+        server.addEntry(accessions[i], "sp|" + accessions[i] + "|TEST" + std::to_string(i) + " Test protein", sequences[i]);
+    }
+
+    check(mkdtemp(cacheDir) != NULL, "Could not create the UniProt cache directory");
+
+    server.start();
+    server.failNext(2);
+
+    options.baseURL = server.getURL();
+    options.cacheDir = cacheDir;
+    options.batchSize = 2;
+    options.connections = 2;
+    options.backoffMs = 10;
+
+    try {
+        // Six distinct accessions make three batches, and the two failed requests are retried
+        proteins = bioinfo::UniProtClient(options).fetch(accessions);
+        requests = server.getRequestCount();
+        check(requests == 5, "Expected 3 batches and 2 retries, got " + std::to_string(requests) + " requests");
+
+        // Everything found is cached now, so only the unknown Q00000 is asked for again
+        cached = bioinfo::UniProtClient(options).fetch(accessions);
+        check(server.getRequestCount() == requests + 1, "Cached accessions were requested again");
+    } catch (...) {
+        removeCache(cacheDir, accessions);
+        throw;
+    }
+
+    removeCache(cacheDir, accessions);
+    check(proteins.size() == 6 && cached.size() == 6, "Expected 6 proteins");
+
+    for (i = 0; i < proteins.size(); ++i) {
+        check(proteins[i].getSequence() == sequences[i < sequences.size() ? i : 1], "Proteins came back out of order");
+        check(cached[i].getSequence() == proteins[i].getSequence(), "Cached proteins differ from fetched ones");
+    }
+
+    return proteins;
+}
+
+int main(int argc, char **argv) {
     std::cout << std::fixed << std::setprecision(3);
 
-    const std::string host = "uniprot.org";
-    const std::string path = "/uniprot/A2Z669";
+    std::vector<std::string> accessions = {"A2Z669"};
+    std::vector<bioinfo::AAString> proteins;
+    std::vector<bioinfo::AAString>::iterator it;
 
-    std::string response = bioinfo::httpGet(host, path);
+    try {
+        if (argc > 1) {
+            proteins = bioinfo::queryUniProt(accessions, argv[1]);
+        } else {
+            proteins = exerciseLocalUniProt();
+        }
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
 
-    if (!response.empty()) {
+    if (!proteins.empty()) {
         std::cout << "Response:" << std::endl;
-        std::cout << response << std::endl;
+
+        for (it = proteins.begin(); it != proteins.end(); ++it) {
+            std::cout << ">" << it->getHeader() << std::endl;
+            std::cout << it->getSequence() << std::endl;
+        }
     }
 
     return 0;
-}
\ No newline at end of file
+}
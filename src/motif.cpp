@@ -0,0 +1,440 @@
+#include <motif.hpp>
+#include <fundamentals.hpp>
+#include <string>
+#include <vector>
+#include <deque>
+#include <climits>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+namespace bioinfo {
+    // Compile a multi-pattern matcher for the dictionary `patterns`. Empty patterns are kept so pattern indices line up with
+    // the input, but they never match.
+    MotifMatcher::MotifMatcher(const std::vector<std::string> &patterns) {
+        (*this).patterns = patterns;
+        (*this).compile();
+    }
+
+    // Compile a multi-pattern matcher using the sequences of the DNAStrings in `motifs` as the dictionary.
+    MotifMatcher::MotifMatcher(std::vector<DNAString> &motifs) {
+        std::vector<DNAString>::iterator it;
+
+        for (it = motifs.begin(); it != motifs.end(); it++) {
+            (*this).patterns.push_back(it->getSequence());
+        }
+
+        (*this).compile();
+    }
+
+    // Compile a multi-pattern matcher using the sequences of the RNAStrings in `motifs` as the dictionary.
+    MotifMatcher::MotifMatcher(std::vector<RNAString> &motifs) {
+        std::vector<RNAString>::iterator it;
+
+        for (it = motifs.begin(); it != motifs.end(); it++) {
+            (*this).patterns.push_back(it->getSequence());
+        }
+
+        (*this).compile();
+    }
+
+    // Build the Aho-Corasick automaton. The trie is turned into a complete transition table over the symbol classes, so the
+    // scan does exactly one table lookup per character of the sequence.
+    void MotifMatcher::compile() {
+        const unsigned int NONE = UINT_MAX;
+
+        std::vector<std::vector<unsigned int>> terminals(1);
+        std::vector<unsigned int> failure(1, 0);
+        std::deque<unsigned int> queue;
+
+        unsigned int i;
+        unsigned int state;
+        unsigned int child;
+        unsigned int symbol;
+        unsigned char c;
+
+        (*this).symbols.assign(256, 0);
+        (*this).symbolCount = 1;
+
+        for (i = 0; i < (*this).patterns.size(); ++i) {
+            for (char pc : (*this).patterns[i]) {
+                c = (unsigned char) pc;
+
+                if ((*this).symbols[c] == 0) {
+                    (*this).symbols[c] = (*this).symbolCount++;
+                }
+            }
+        }
+
+        // Insert every pattern into the trie
+        (*this).transitions.assign((*this).symbolCount, NONE);
+
+        for (i = 0; i < (*this).patterns.size(); ++i) {
+            if ((*this).patterns[i].empty()) {
+                continue;
+            }
+
+            state = 0;
+
+            for (char pc : (*this).patterns[i]) {
+                symbol = (*this).symbols[(unsigned char) pc];
+
+                if ((*this).transitions[state * (*this).symbolCount + symbol] == NONE) {
+                    (*this).transitions[state * (*this).symbolCount + symbol] = terminals.size();
+                    (*this).transitions.resize((*this).transitions.size() + (*this).symbolCount, NONE);
+                    terminals.emplace_back();
+                }
+
+                state = (*this).transitions[state * (*this).symbolCount + symbol];
+            }
+
+            terminals[state].push_back(i);
+        }
+
+        // Breadth first pass to fill in failure links, missing transitions and dictionary links
+        failure.resize(terminals.size(), 0);
+        (*this).dictionaryLinks.assign(terminals.size(), 0);
+
+        for (symbol = 0; symbol < (*this).symbolCount; ++symbol) {
+            child = (*this).transitions[symbol];
+
+            if (child == NONE) {
+                (*this).transitions[symbol] = 0;
+            } else {
+                queue.push_back(child);
+            }
+        }
+
+        while (!queue.empty()) {
+            state = queue.front();
+            queue.pop_front();
+
+            for (symbol = 0; symbol < (*this).symbolCount; ++symbol) {
+                child = (*this).transitions[state * (*this).symbolCount + symbol];
+
+                if (child == NONE) {
+                    (*this).transitions[state * (*this).symbolCount + symbol] =
+                        (*this).transitions[failure[state] * (*this).symbolCount + symbol];
+                } else {
+                    failure[child] = (*this).transitions[failure[state] * (*this).symbolCount + symbol];
+                    (*this).dictionaryLinks[child] = terminals[failure[child]].empty() ?
+                        (*this).dictionaryLinks[failure[child]] : failure[child];
+                    queue.push_back(child);
+                }
+            }
+        }
+
+        // Flatten the pattern lists of every state
+        (*this).outputStart.assign(terminals.size() + 1, 0);
+        (*this).outputIds.clear();
+
+        for (state = 0; state < terminals.size(); ++state) {
+            (*this).outputIds.insert((*this).outputIds.end(), terminals[state].begin(), terminals[state].end());
+            (*this).outputStart[state + 1] = (*this).outputIds.size();
+        }
+    }
+
+    // Run the automaton over `s` once and call `report(pattern, position)` for every hit in the order the hits end. The scan
+    // stops early if `report` returns false.
+    template <typename F> void MotifMatcher::scan(SequenceView s, F report) const {
+        unsigned int state = 0;
+        unsigned int t;
+        unsigned int k;
+        size_t i;
+
+        for (i = 0; i < s.length(); ++i) {
+            state = (*this).transitions[state * (*this).symbolCount + (*this).symbols[(unsigned char) s[i]]];
+            t = (*this).outputStart[state] != (*this).outputStart[state + 1] ? state : (*this).dictionaryLinks[state];
+
+            while (t != 0) {
+                for (k = (*this).outputStart[t]; k < (*this).outputStart[t + 1]; ++k) {
+                    if (!report((*this).outputIds[k], i + 1 - (*this).patterns[(*this).outputIds[k]].length())) {
+                        return;
+                    }
+                }
+
+                t = (*this).dictionaryLinks[t];
+            }
+        }
+    }
+
+    // Get how many patterns are in the dictionary
+    unsigned int MotifMatcher::getPatternCount() const {
+        return (*this).patterns.size();
+    }
+
+    // Get the pattern with index `i`
+    const std::string &MotifMatcher::getPattern(unsigned int i) const {
+        return (*this).patterns.at(i);
+    }
+
+    // Get every hit of every pattern in `s` in a single pass. With `overlap` set to false hits of the same pattern do not
+    // overlap each other, the same as `exactDNAStringMotif`. Hits are listed in the order they end in the sequence.
+    std::vector<MotifHit> MotifMatcher::findAll(SequenceView s, bool overlap) const {
+        std::vector<MotifHit> hits;
+        std::vector<size_t> nextAllowed((*this).patterns.size(), 0);
+
+        (*this).scan(s, [&](unsigned int pattern, size_t position) {
+            if (position >= nextAllowed[pattern]) {
+                hits.push_back(MotifHit{pattern, (unsigned int) position});
+                nextAllowed[pattern] = overlap ? position + 1 : position + (*this).patterns[pattern].length();
+            }
+
+            return true;
+        });
+
+        return hits;
+    }
+
+    // Get every hit of every pattern in the sequence of a DNAString `ds`.
+    std::vector<MotifHit> MotifMatcher::findAll(DNAString &ds, bool overlap) const {
+        return (*this).findAll(ds.getSequenceView(), overlap);
+    }
+
+    // Get every hit of every pattern in the sequence of a RNAString `rs`.
+    std::vector<MotifHit> MotifMatcher::findAll(RNAString &rs, bool overlap) const {
+        return (*this).findAll(rs.getSequenceView(), overlap);
+    }
+
+    // Get the hit positions of every pattern in `s`, grouped by pattern index.
+    std::vector<std::vector<unsigned int>> MotifMatcher::findPositions(SequenceView s, bool overlap) const {
+        std::vector<std::vector<unsigned int>> positions((*this).patterns.size());
+        std::vector<MotifHit> hits = (*this).findAll(s, overlap);
+        std::vector<MotifHit>::iterator it;
+
+        for (it = hits.begin(); it != hits.end(); it++) {
+            positions[it->pattern].push_back(it->position);
+        }
+
+        return positions;
+    }
+
+    // Get the position of the first hit of every pattern in `s`, or -1 for patterns that are not found. The scan stops as soon
+    // as every pattern has been seen.
+    std::vector<long int> MotifMatcher::findFirst(SequenceView s) const {
+        std::vector<long int> first((*this).patterns.size(), -1);
+        size_t remaining = 0;
+        size_t i;
+
+        for (i = 0; i < (*this).patterns.size(); ++i) {
+            remaining += !(*this).patterns[i].empty();
+        }
+
+        if (remaining == 0) {
+            return first;
+        }
+
+        (*this).scan(s, [&](unsigned int pattern, size_t position) {
+            if (first[pattern] < 0) {
+                first[pattern] = position;
+                --remaining;
+            }
+
+            return remaining > 0;
+        });
+
+        return first;
+    }
+
+    // --------------------------------------------------------------------------
+
+    // Build one bit vector per byte value with bit i set when `motif[i]` is that byte, split into 64-bit blocks.
+    static std::vector<uint64_t> buildPatternMasks(SequenceView motif, size_t blocks) {
+        std::vector<uint64_t> masks(256 * blocks, 0);
+        size_t i;
+
+        for (i = 0; i < motif.length(); ++i) {
+            masks[(unsigned char) motif[i] * blocks + i / 64] |= 1ULL << (i % 64);
+        }
+
+        return masks;
+    }
+
+    // Shift-and with substitutions (Wu-Manber) over multi-word bit vectors. `states[d]` has bit i set when the motif prefix of
+    // length i + 1 ends at the current base with at most `d` mismatches.
+    static std::vector<ApproximateMotifHit> hammingMotifSearch(SequenceView s, SequenceView motif, unsigned int k,
+                                                               bool overlap) {
+        std::vector<ApproximateMotifHit> hits;
+        size_t m = motif.length();
+        size_t blocks = (m + 63) / 64;
+        size_t i;
+        size_t b;
+        size_t start;
+        size_t nextAllowed = 0;
+        unsigned int d;
+
+        uint64_t lastBit = 1ULL << ((m - 1) % 64);
+        uint64_t carry;
+        uint64_t shifted;
+        uint64_t previousShifted;
+        uint64_t old;
+
+        std::vector<uint64_t> masks = buildPatternMasks(motif, blocks);
+        std::vector<uint64_t> states((k + 1) * blocks, 0);
+        const uint64_t *eq;
+
+        for (i = 0; i < s.length(); ++i) {
+            eq = &masks[(unsigned char) s[i] * blocks];
+
+            // Walk the distances from high to low so states[d - 1] still holds the previous column when it is read
+            for (d = k + 1; d-- > 0;) {
+                carry = 1;
+
+                for (b = 0; b < blocks; ++b) {
+                    old = states[d * blocks + b];
+                    shifted = (old << 1) | carry;
+                    carry = old >> 63;
+                    states[d * blocks + b] = shifted & eq[b];
+                }
+
+                if (d > 0) {
+                    carry = 1;
+
+                    for (b = 0; b < blocks; ++b) {
+                        old = states[(d - 1) * blocks + b];
+                        previousShifted = (old << 1) | carry;
+                        carry = old >> 63;
+                        states[d * blocks + b] |= previousShifted;
+                    }
+                }
+            }
+
+            if (i + 1 < m) {
+                continue;
+            }
+
+            for (d = 0; d <= k; ++d) {
+                if (states[d * blocks + blocks - 1] & lastBit) {
+                    start = i + 1 - m;
+
+                    if (start >= nextAllowed) {
+                        hits.push_back(ApproximateMotifHit{(unsigned int) start, d});
+                        nextAllowed = overlap ? start + 1 : start + m;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        return hits;
+    }
+
+    // Myers' bit-vector algorithm for approximate matching, using Hyyro's blocks for motifs longer than 64 bases. The score
+    // tracked is the edit distance of the whole motif against the best substring ending at the current base.
+    static std::vector<ApproximateMotifHit> editMotifSearch(SequenceView s, SequenceView motif, unsigned int k,
+                                                            bool overlap) {
+        std::vector<ApproximateMotifHit> hits;
+        size_t m = motif.length();
+        size_t blocks = (m + 63) / 64;
+        size_t i;
+        size_t b;
+        size_t nextAllowed = 0;
+        unsigned int lastRow = (m - 1) % 64;
+        unsigned int score = m;
+        int hin;
+        int hout;
+
+        uint64_t eq;
+        uint64_t xv;
+        uint64_t xh;
+        uint64_t ph;
+        uint64_t mh;
+
+        std::vector<uint64_t> masks = buildPatternMasks(motif, blocks);
+        std::vector<uint64_t> pv(blocks, ~0ULL);
+        std::vector<uint64_t> mv(blocks, 0);
+
+        bool inRun = false;
+        ApproximateMotifHit best;
+
+        for (i = 0; i < s.length(); ++i) {
+            // The motif may start anywhere, so the top row of every column is 0
+            hin = 0;
+
+            for (b = 0; b < blocks; ++b) {
+                eq = masks[(unsigned char) s[i] * blocks + b];
+                xv = eq | mv[b];
+
+                if (hin < 0) {
+                    eq |= 1;
+                }
+
+                xh = (((eq & pv[b]) + pv[b]) ^ pv[b]) | eq;
+                ph = mv[b] | ~(xh | pv[b]);
+                mh = pv[b] & xh;
+
+                if (b + 1 == blocks) {
+                    score += (ph >> lastRow) & 1;
+                    score -= (mh >> lastRow) & 1;
+                }
+
+                hout = (ph >> 63) ? 1 : ((mh >> 63) ? -1 : 0);
+
+                ph <<= 1;
+                mh <<= 1;
+
+                if (hin < 0) {
+                    mh |= 1;
+                } else if (hin > 0) {
+                    ph |= 1;
+                }
+
+                pv[b] = mh | ~(xv | ph);
+                mv[b] = ph & xv;
+                hin = hout;
+            }
+
+            if (overlap) {
+                if (score <= k) {
+                    hits.push_back(ApproximateMotifHit{(unsigned int) i, score});
+                }
+
+                continue;
+            }
+
+            // Without overlap a run of neighbouring end positions is one occurrence, reported at its lowest distance
+            if (score <= k && i >= nextAllowed) {
+                if (!inRun || score < best.distance) {
+                    best = ApproximateMotifHit{(unsigned int) i, score};
+                }
+
+                inRun = true;
+            } else if (inRun) {
+                hits.push_back(best);
+                nextAllowed = best.position + m;
+                inRun = false;
+            }
+        }
+
+        if (inRun) {
+            hits.push_back(best);
+        }
+
+        return hits;
+    }
+
+    // Get every occurrence of `motif` in `s` within a distance of `k`, using bit-parallel kernels that update 64 motif
+    // positions per machine word. With `overlap` set to false the occurrences do not overlap each other.
+    std::vector<ApproximateMotifHit> approximateMotif(SequenceView s, SequenceView motif, unsigned int k, bool overlap,
+                                                      MotifDistance mode) {
+        if (motif.empty()) {
+            throw std::invalid_argument("ERROR: approximateMotif motif cannot be empty!");
+        }
+
+        k = std::min<size_t>(k, motif.length());
+
+        if (mode == MotifDistance::EDIT) {
+            return editMotifSearch(s, motif, k, overlap);
+        }
+
+        return hammingMotifSearch(s, motif, k, overlap);
+    }
+
+    // Get the indices in the DNAString `ds` where a DNA motif (`motif`) is found with at most `k` mismatches (or edits when
+    // `mode` is MotifDistance::EDIT).
+    std::vector<ApproximateMotifHit> approximateDNAStringMotif(DNAString &ds, DNAString &motif, unsigned int k, bool overlap,
+                                                               MotifDistance mode) {
+        return approximateMotif(ds.getSequenceView(), motif.getSequenceView(), k, overlap, mode);
+    }
+}
\ No newline at end of file
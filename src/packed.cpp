@@ -0,0 +1,376 @@
+#include <packed.hpp>
+#include <fundamentals.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cctype>
+#include <stdexcept>
+#include <algorithm>
+
+namespace bioinfo {
+    // Lookup table from a character to its 2-bit nucleotide code, or 4 if the character is ambiguous
+    static const std::vector<unsigned char> NUCLEOTIDE_CODE_TABLE = []() {
+        std::vector<unsigned char> table(256, 4);
+
+        table['A'] = NucleotideCodes::A; table['a'] = NucleotideCodes::A;
+        table['C'] = NucleotideCodes::C; table['c'] = NucleotideCodes::C;
+        table['G'] = NucleotideCodes::G; table['g'] = NucleotideCodes::G;
+        table['T'] = NucleotideCodes::T; table['t'] = NucleotideCodes::T;
+        table['U'] = NucleotideCodes::T; table['u'] = NucleotideCodes::T;
+
+        return table;
+    }();
+
+    // Spread the 32 bits of `x` so that bit i lands on bit 2 * i (one bit per 2-bit base slot).
+    static inline uint64_t spreadMaskBits(uint64_t x) {
+        x &= 0xFFFFFFFFULL;
+        x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+        x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+        x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        x = (x | (x << 2)) & 0x3333333333333333ULL;
+        x = (x | (x << 1)) & 0x5555555555555555ULL;
+
+        return x;
+    }
+
+    // Reverse the order of the 32 2-bit bases held in a word.
+    static inline uint64_t reverseBases(uint64_t x) {
+        x = ((x >> 2) & 0x3333333333333333ULL) | ((x & 0x3333333333333333ULL) << 2);
+        x = ((x >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x & 0x0F0F0F0F0F0F0F0FULL) << 4);
+
+        return __builtin_bswap64(x);
+    }
+
+    // Reverse the order of the 64 bits held in a word.
+    static inline uint64_t reverseBits(uint64_t x) {
+        x = ((x >> 1) & 0x5555555555555555ULL) | ((x & 0x5555555555555555ULL) << 1);
+
+        return reverseBases(x);
+    }
+
+    // Get the 32 mask bits that belong to the data word `w`.
+    static inline uint64_t maskSlice(const std::vector<uint64_t> &mask, unsigned int w) {
+        return (mask[w >> 1] >> ((w & 1) * 32)) & 0xFFFFFFFFULL;
+    }
+
+    // Extract `count` (at most 32) bases starting at base `pos` as a right aligned word.
+    static inline uint64_t extractBases(const std::vector<uint64_t> &words, unsigned int pos, unsigned int count) {
+        unsigned int w = pos / NucleotideCodes::BASES_PER_WORD;
+        unsigned int offset = (pos % NucleotideCodes::BASES_PER_WORD) * 2;
+        uint64_t x = words[w] >> offset;
+
+        if (offset != 0 && w + 1 < words.size()) {
+            x |= words[w + 1] << (64 - offset);
+        }
+
+        if (count < NucleotideCodes::BASES_PER_WORD) {
+            x &= (1ULL << (count * 2)) - 1;
+        }
+
+        return x;
+    }
+
+    // Shift a multi-word bit array towards bit 0 by `bits` (less than 64) bits.
+    static void shiftWordsDown(std::vector<uint64_t> &v, unsigned int bits) {
+        unsigned int i;
+
+        if (bits == 0) {
+            return;
+        }
+
+        for (i = 0; i < v.size(); ++i) {
+            v[i] >>= bits;
+
+            if (i + 1 < v.size()) {
+                v[i] |= v[i + 1] << (64 - bits);
+            }
+        }
+    }
+
+    // Create a new empty PackedSequence
+    PackedSequence::PackedSequence() {
+        (*this).length = 0;
+    }
+
+    // Pack the nucleotide string `s` into 2-bit codes. Any character other than A, C, G, T or U (in either case) is flagged in
+    // the ambiguity mask and kept as an uppercase character so that unpacking gives back the original sequence.
+    PackedSequence::PackedSequence(const std::string &s) {
+        unsigned int i;
+        unsigned char code;
+        uint64_t word = 0;
+
+        (*this).length = s.length();
+        (*this).words.assign((s.length() + NucleotideCodes::BASES_PER_WORD - 1) / NucleotideCodes::BASES_PER_WORD, 0);
+        (*this).mask.assign((s.length() + NucleotideCodes::BASES_PER_MASK_WORD - 1) / NucleotideCodes::BASES_PER_MASK_WORD, 0);
+
+        for (i = 0; i < (*this).length; ++i) {
+            code = NUCLEOTIDE_CODE_TABLE[(unsigned char) s[i]];
+
+            if (code < 4) {
+                word |= (uint64_t) code << ((i % NucleotideCodes::BASES_PER_WORD) * 2);
+            } else {
+                (*this).mask[i / NucleotideCodes::BASES_PER_MASK_WORD] |= 1ULL << (i % NucleotideCodes::BASES_PER_MASK_WORD);
+                (*this).ambiguityCodes += std::toupper(s[i]);
+            }
+
+            if (i % NucleotideCodes::BASES_PER_WORD == NucleotideCodes::BASES_PER_WORD - 1) {
+                (*this).words[i / NucleotideCodes::BASES_PER_WORD] = word;
+                word = 0;
+            }
+        }
+
+        if ((*this).length % NucleotideCodes::BASES_PER_WORD != 0) {
+            (*this).words.back() = word;
+        }
+    }
+
+    // Unpack the sequence into a string, writing the fourth nucleotide code as `t` ('T' for DNA and 'U' for RNA)
+    std::string PackedSequence::unpack(char t) const {
+        const char alphabet[4] = {'A', 'C', 'G', t};
+        std::string s((*this).length, 'A');
+
+        unsigned int i;
+        unsigned int j;
+        unsigned int end;
+        unsigned int k = 0;
+        uint64_t word;
+        uint64_t bits;
+
+        for (i = 0; i < (*this).words.size(); ++i) {
+            word = (*this).words[i];
+            end = std::min((*this).length - i * NucleotideCodes::BASES_PER_WORD, NucleotideCodes::BASES_PER_WORD);
+
+            for (j = 0; j < end; ++j) {
+                s[i * NucleotideCodes::BASES_PER_WORD + j] = alphabet[word & 3];
+                word >>= 2;
+            }
+        }
+
+        for (i = 0; i < (*this).mask.size(); ++i) {
+            bits = (*this).mask[i];
+
+            while (bits != 0) {
+                s[i * NucleotideCodes::BASES_PER_MASK_WORD + __builtin_ctzll(bits)] = (*this).ambiguityCodes[k++];
+                bits &= bits - 1;
+            }
+        }
+
+        return s;
+    }
+
+    // Get the 2-bit code of the base at position `i` (ambiguous bases read as 0)
+    unsigned char PackedSequence::codeAt(unsigned int i) const {
+        return ((*this).words[i / NucleotideCodes::BASES_PER_WORD] >> ((i % NucleotideCodes::BASES_PER_WORD) * 2)) & 3;
+    }
+
+    // Check if the base at position `i` is flagged as an ambiguity code
+    bool PackedSequence::isAmbiguous(unsigned int i) const {
+        return ((*this).mask[i / NucleotideCodes::BASES_PER_MASK_WORD] >> (i % NucleotideCodes::BASES_PER_MASK_WORD)) & 1;
+    }
+
+    // Get how many ambiguous bases come before position `i`, which is the index of base `i` in the ambiguity code string
+    unsigned int PackedSequence::ambiguityRank(unsigned int i) const {
+        unsigned int rank = 0;
+        unsigned int w;
+        unsigned int last = i / NucleotideCodes::BASES_PER_MASK_WORD;
+
+        for (w = 0; w < last; ++w) {
+            rank += __builtin_popcountll((*this).mask[w]);
+        }
+
+        if (i % NucleotideCodes::BASES_PER_MASK_WORD != 0) {
+            rank += __builtin_popcountll((*this).mask[last] & ((1ULL << (i % NucleotideCodes::BASES_PER_MASK_WORD)) - 1));
+        }
+
+        return rank;
+    }
+
+    // Get how many bases are in the PackedSequence
+    unsigned int PackedSequence::getLength() const {
+        return (*this).length;
+    }
+
+    // Get the packed 2-bit words of the PackedSequence
+    const std::vector<uint64_t> &PackedSequence::getWords() const {
+        return (*this).words;
+    }
+
+    // Get the ambiguity bit mask of the PackedSequence
+    const std::vector<uint64_t> &PackedSequence::getMask() const {
+        return (*this).mask;
+    }
+
+    // Get the characters of the ambiguous bases in sequence order
+    const std::string &PackedSequence::getAmbiguityCodes() const {
+        return (*this).ambiguityCodes;
+    }
+
+    // Check if the PackedSequence has any bases flagged in the ambiguity mask
+    bool PackedSequence::hasAmbiguity() const {
+        return !(*this).ambiguityCodes.empty();
+    }
+
+    // Reverse complement the PackedSequence a word at a time. Ambiguous bases get their IUPAC complement, the same as the
+    // unpacked `reverseComplement`.
+    PackedSequence PackedSequence::reverseComplement() const {
+        PackedSequence rc;
+        unsigned int i;
+        unsigned int wordCount = (*this).words.size();
+        unsigned int maskCount = (*this).mask.size();
+
+        rc.length = (*this).length;
+        rc.words.resize(wordCount);
+        rc.mask.resize(maskCount);
+
+        // Complementing is flipping both bits of every code (A <-> T, C <-> G)
+        for (i = 0; i < wordCount; ++i) {
+            rc.words[wordCount - i - 1] = reverseBases(~(*this).words[i]);
+        }
+
+        for (i = 0; i < maskCount; ++i) {
+            rc.mask[maskCount - i - 1] = reverseBits((*this).mask[i]);
+        }
+
+        // The padding at the end of the last word is now at the start of the first word, so shift it out
+        shiftWordsDown(rc.words, (wordCount * NucleotideCodes::BASES_PER_WORD - rc.length) * 2);
+        shiftWordsDown(rc.mask, maskCount * NucleotideCodes::BASES_PER_MASK_WORD - rc.length);
+
+        // Ambiguous bases are stored with a code of 0
+        if ((*this).hasAmbiguity()) {
+            for (i = 0; i < wordCount; ++i) {
+                rc.words[i] &= ~(spreadMaskBits(maskSlice(rc.mask, i)) * 3);
+            }
+        }
+
+        rc.ambiguityCodes = (*this).ambiguityCodes;
+        reverseComplementInPlace(rc.ambiguityCodes);
+        return rc;
+    }
+
+    // Get the hamming distance between two PackedSequences (`s` and `t`) by comparing 32 bases per word. Ambiguous bases only
+    // match an identical ambiguous base.
+    unsigned int hammingDistance(const PackedSequence &s, const PackedSequence &t) {
+        unsigned int hd = 0;
+        unsigned int i;
+        unsigned int j;
+        unsigned int sRank = 0;
+        unsigned int tRank = 0;
+
+        uint64_t x;
+        uint64_t diff;
+        uint64_t sMask;
+        uint64_t tMask;
+        uint64_t both;
+
+        const std::vector<uint64_t> &sWords = s.getWords();
+        const std::vector<uint64_t> &tWords = t.getWords();
+        const std::string &sCodes = s.getAmbiguityCodes();
+        const std::string &tCodes = t.getAmbiguityCodes();
+
+        if (s.getLength() != t.getLength()) {
+            throw std::invalid_argument("ERROR: PackedSequence sequences are not the same length!");
+        }
+
+        for (i = 0; i < sWords.size(); ++i) {
+            // One bit per base that differs, kept in the low bit of each 2-bit slot
+            x = sWords[i] ^ tWords[i];
+            diff = (x | (x >> 1)) & 0x5555555555555555ULL;
+
+            sMask = maskSlice(s.getMask(), i);
+            tMask = maskSlice(t.getMask(), i);
+
+            if ((sMask | tMask) == 0) {
+                hd += __builtin_popcountll(diff);
+            } else {
+                both = sMask & tMask;
+
+                hd += __builtin_popcountll(diff & ~spreadMaskBits(sMask | tMask));
+                hd += __builtin_popcountll((sMask | tMask) & ~both);
+
+                while (both != 0) {
+                    j = __builtin_ctzll(both);
+
+                    if (sCodes[sRank + __builtin_popcountll(sMask & ((1ULL << j) - 1))] !=
+                        tCodes[tRank + __builtin_popcountll(tMask & ((1ULL << j) - 1))]) {
+                        ++hd;
+                    }
+
+                    both &= both - 1;
+                }
+
+                sRank += __builtin_popcountll(sMask);
+                tRank += __builtin_popcountll(tMask);
+            }
+        }
+
+        return hd;
+    }
+
+    // Get the indices in the PackedSequence `ps` where `motif` is found by rolling a 2-bit window over the packed words. Motifs
+    // containing ambiguity codes are matched character by character on the unpacked sequence instead.
+    std::vector<unsigned int> exactPackedMotif(const PackedSequence &ps, const PackedSequence &motif, bool overlap) {
+        std::vector<unsigned int> positions;
+
+        unsigned int n = ps.getLength();
+        unsigned int m = motif.getLength();
+        unsigned int w = std::min(m, NucleotideCodes::BASES_PER_WORD);
+        unsigned int i;
+        unsigned int offset;
+        unsigned int count;
+        unsigned int start;
+        unsigned int nextAllowed = 0;
+        unsigned int ambiguousInWindow = 0;
+        bool found;
+
+        uint64_t window = 0;
+        uint64_t motifKey;
+
+        if (m > n || m == 0) {
+            return positions;
+        }
+
+        if (motif.hasAmbiguity()) {
+            std::string seq = ps.unpack('T');
+            std::string pattern = motif.unpack('T');
+            std::string::size_type pos = 0;
+
+            while ((pos = seq.find(pattern, pos)) != std::string::npos) {
+                positions.push_back(pos);
+                pos += overlap ? 1 : m;
+            }
+
+            return positions;
+        }
+
+        // The window holds the last `w` bases, which are compared with the last `w` bases of the motif
+        motifKey = extractBases(motif.getWords(), m - w, w);
+
+        for (i = 0; i < n; ++i) {
+            window = (window >> 2) | ((uint64_t) ps.codeAt(i) << ((w - 1) * 2));
+
+            ambiguousInWindow += ps.isAmbiguous(i);
+            if (i >= m) {
+                ambiguousInWindow -= ps.isAmbiguous(i - m);
+            }
+
+            if (i + 1 < m || window != motifKey || ambiguousInWindow != 0) {
+                continue;
+            }
+
+            start = i + 1 - m;
+            found = start >= nextAllowed;
+
+            for (offset = 0; found && offset < m - w; offset += NucleotideCodes::BASES_PER_WORD) {
+                count = std::min(m - w - offset, NucleotideCodes::BASES_PER_WORD);
+                found = extractBases(ps.getWords(), start + offset, count) == extractBases(motif.getWords(), offset, count);
+            }
+
+            if (found) {
+                positions.push_back(start);
+                nextAllowed = overlap ? start + 1 : start + m;
+            }
+        }
+
+        return positions;
+    }
+}
\ No newline at end of file
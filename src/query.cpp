@@ -1,19 +1,925 @@
 // Standard headers
 #include <vector>
 #include <string>
+#include <cstring>
+#include <cstdio>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <stdexcept>
+// POSIX headers
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <netdb.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
 // Bioinfo headers
 #include <fundamentals.hpp>
+#include <parallel.hpp>
 #include <query.hpp>
 
 namespace bioinfo {
-    std::vector<AAString> queryUniProt(std::vector<std::string> &vec) {
+    const size_t HTTP_READ_SIZE = 1 << 16; // Bytes asked of the socket per read
+    const size_t HTTP_MAX_HEAD = 1 << 16; // Longest status line plus headers accepted
+    const size_t FASTA_LINE_WIDTH = 60; // Residues per line of the records the local server sends
+
+    // Buffered reader over a connected socket. `pos` marks the first unread byte of `buffer`.
+    struct SocketReader {
+        int fd;
+        std::string buffer;
+        size_t pos = 0;
+
+        // Append the next bytes from the socket to the buffer and return false once the peer has closed.
+        bool fill() {
+            char chunk[HTTP_READ_SIZE];
+            ssize_t n;
+
+            if (pos > 0 && pos == buffer.length()) {
+                buffer.clear();
+                pos = 0;
+            }
+
+            do {
+                n = ::recv(fd, chunk, sizeof(chunk), 0);
+            } while (n < 0 && errno == EINTR);
+
+            if (n < 0) {
+                throw std::runtime_error("ERROR: HTTP receive failed!");
+            }
+
+            buffer.append(chunk, n);
+            return n > 0;
+        }
+
+        // Read the status or request line and the headers up to the empty line that ends them. Returns false when the peer
+        // closed the connection before sending anything.
+        bool head(std::string &text) {
+            size_t end;
+
+            while ((end = buffer.find("\r\n\r\n", pos)) == std::string::npos) {
+                if (buffer.length() - pos > HTTP_MAX_HEAD) {
+                    throw std::runtime_error("ERROR: HTTP header is too long!");
+                } else if (!fill()) {
+                    if (buffer.length() == pos) {
+                        return false;
+                    }
+
+                    throw std::runtime_error("ERROR: HTTP connection closed inside a header!");
+                }
+            }
+
+            text = buffer.substr(pos, end + 2 - pos);
+            pos = end + 4;
+            return true;
+        }
+
+        // Read one CRLF terminated line without its line ending.
+        std::string line() {
+            size_t end;
+            std::string text;
+
+            while ((end = buffer.find("\r\n", pos)) == std::string::npos) {
+                if (!fill()) {
+                    throw std::runtime_error("ERROR: HTTP connection closed inside a line!");
+                }
+            }
+
+            text = buffer.substr(pos, end - pos);
+            pos = end + 2;
+            return text;
+        }
+
+        // Append exactly `n` bytes to `out`.
+        void take(size_t n, std::string &out) {
+            size_t part;
+
+            while (n > 0) {
+                if (pos == buffer.length() && !fill()) {
+                    throw std::runtime_error("ERROR: HTTP connection closed inside a body!");
+                }
+
+                part = std::min(n, buffer.length() - pos);
+                out.append(buffer, pos, part);
+                pos += part;
+                n -= part;
+            }
+        }
+
+        // Append everything up to the end of the connection to `out`.
+        void rest(std::string &out) {
+            do {
+                out.append(buffer, pos, std::string::npos);
+                pos = buffer.length();
+            } while (fill());
+        }
+    } typedef SocketReader;
+
+    // Send all `length` bytes of `data` on the socket `fd`.
+    static void sendAll(int fd, const char *data, size_t length) {
+        ssize_t sent;
+
+        while (length > 0) {
+            sent = ::send(fd, data, length, MSG_NOSIGNAL);
+
+            if (sent < 0 && errno == EINTR) {
+                continue;
+            } else if (sent <= 0) {
+                throw std::runtime_error("ERROR: HTTP send failed!");
+            }
+
+            data += sent;
+            length -= sent;
+        }
+    }
+
+    // Return `s` with ASCII letters in lower case.
+    static std::string lowerCase(std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+        return s;
+    }
+
+    // Return `s` without leading and trailing spaces and tabs.
+    static std::string trimSpaces(const std::string &s) {
+        size_t first = s.find_first_not_of(" \t");
+        size_t last = s.find_last_not_of(" \t");
+
+        return first == std::string::npos ? "" : s.substr(first, last + 1 - first);
+    }
+
+    // Split the header lines after the first line of `head` into `headers`, with lower case names.
+    static void parseHeaders(const std::string &head, std::unordered_map<std::string, std::string> &headers) {
+        size_t start = head.find("\r\n");
+        size_t end;
+        size_t colon;
+
+        while (start != std::string::npos && (end = head.find("\r\n", start + 2)) != std::string::npos) {
+            colon = head.find(':', start + 2);
+
+            if (colon != std::string::npos && colon < end) {
+                headers[lowerCase(trimSpaces(head.substr(start + 2, colon - start - 2)))] =
+                    trimSpaces(head.substr(colon + 1, end - colon - 1));
+            }
+
+            start = end;
+        }
+    }
+
+    // Split an http:// `url` into host, port and path.
+    URL parseURL(const std::string &url) {
+        const std::string scheme = "http://";
+        URL parsed;
+        std::string authority;
+        size_t slash;
+        size_t colon;
+        unsigned long int port;
+
+        if (lowerCase(url.substr(0, scheme.length())) != scheme) {
+            throw std::invalid_argument("ERROR: Only http:// URLs are supported!");
+        }
+
+        slash = url.find('/', scheme.length());
+        authority = url.substr(scheme.length(), slash == std::string::npos ? std::string::npos : slash - scheme.length());
+        parsed.path = slash == std::string::npos ? "/" : url.substr(slash);
+        colon = authority.rfind(':');
+
+        if (colon != std::string::npos) {
+            if (colon + 1 == authority.length() ||
+                authority.find_first_not_of("0123456789", colon + 1) != std::string::npos ||
+                (port = std::stoul(authority.substr(colon + 1))) == 0 || port > 65535) {
+                throw std::invalid_argument("ERROR: URL has an invalid port!");
+            }
+
+            parsed.port = port;
+            authority = authority.substr(0, colon);
+        }
+
+        if (authority.empty()) {
+            throw std::invalid_argument("ERROR: URL has no host!");
+        }
+
+        parsed.host = authority;
+        return parsed;
+    }
+
+    // Create a new `HTTPClient` for `host`:`port` that keeps at most `maxConnections` connections and gives up on a socket
+    // that is silent for `timeoutMs` milliseconds.
+    HTTPClient::HTTPClient(const std::string &host, unsigned short port, unsigned int maxConnections, int timeoutMs) {
+        if (maxConnections == 0) {
+            throw std::invalid_argument("ERROR: HTTPClient needs at least one connection!");
+        }
+
+        (*this).host = host;
+        (*this).port = port;
+        (*this).maxConnections = maxConnections;
+        (*this).timeoutMs = timeoutMs;
+        (*this).open = 0;
+    }
+
+    HTTPClient::~HTTPClient() {
+        std::vector<int>::iterator it;
+
+        for (it = (*this).idle.begin(); it != (*this).idle.end(); ++it) {
+            close(*it);
+        }
+    }
+
+    // Open a new connection to the host, giving up after the timeout.
+    int HTTPClient::connectSocket() {
+        struct addrinfo hints;
+        struct addrinfo *addresses;
+        struct addrinfo *a;
+        struct pollfd pfd;
+        struct timeval tv;
+        socklen_t errorLength = sizeof(int);
+        int error = 0;
+        int flags;
+        int one = 1;
+        int fd = -1;
+
+        std::memset(&hints, 0, sizeof(hints));
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+
+        if (getaddrinfo((*this).host.c_str(), std::to_string((*this).port).c_str(), &hints, &addresses) != 0) {
+            throw std::runtime_error("ERROR: Could not resolve HTTP host!");
+        }
+
+        // Connect without blocking so the timeout also bounds the handshake
+        for (a = addresses; a != NULL; a = a->ai_next) {
+            fd = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+
+            if (fd < 0) {
+                continue;
+            }
+
+            flags = fcntl(fd, F_GETFL, 0);
+            fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+
+            if (connect(fd, a->ai_addr, a->ai_addrlen) == 0) {
+                error = 0;
+            } else if (errno == EINPROGRESS) {
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+
+                if (poll(&pfd, 1, (*this).timeoutMs) == 1) {
+                    getsockopt(fd, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+                } else {
+                    error = ETIMEDOUT;
+                }
+            } else {
+                error = errno;
+            }
+
+            if (error == 0) {
+                fcntl(fd, F_SETFL, flags);
+                break;
+            }
+
+            close(fd);
+            fd = -1;
+        }
+
+        freeaddrinfo(addresses);
+
+        if (fd < 0) {
+            throw std::runtime_error("ERROR: Could not connect to HTTP host!");
+        }
+
+        tv.tv_sec = (*this).timeoutMs / 1000;
+        tv.tv_usec = ((*this).timeoutMs % 1000) * 1000;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        return fd;
+    }
+
+    // Take an idle connection, or open one when fewer than `maxConnections` exist, waiting for a release otherwise.
+    // `reused` tells whether the connection already served a request, since the server may have closed it since.
+    int HTTPClient::acquire(bool &reused) {
+        std::unique_lock<std::mutex> guard((*this).lock);
+        int fd;
+
+        (*this).released.wait(guard, [&]() {
+            return !(*this).idle.empty() || (*this).open < (*this).maxConnections;
+        });
+
+        if (!(*this).idle.empty()) {
+            fd = (*this).idle.back();
+            (*this).idle.pop_back();
+            reused = true;
+            return fd;
+        }
+
+        ++(*this).open;
+        guard.unlock();
+        reused = false;
+
+        try {
+            return (*this).connectSocket();
+        } catch (...) {
+            guard.lock();
+            --(*this).open;
+            (*this).released.notify_one();
+            throw;
+        }
+    }
+
+    // Hand a connection back to the pool, or close it when it cannot serve another request.
+    void HTTPClient::release(int fd, bool keep) {
+        std::lock_guard<std::mutex> guard((*this).lock);
+
+        if (keep) {
+            (*this).idle.push_back(fd);
+        } else {
+            close(fd);
+            --(*this).open;
+        }
+
+        (*this).released.notify_one();
+    }
+
+    // Send a GET request for `path` and read the whole response. A pooled connection the server has dropped is replaced by
+    // a fresh one once; other network errors throw.
+    HTTPResponse HTTPClient::get(const std::string &path) {
+        HTTPResponse response;
+        SocketReader reader;
+        std::string request;
+        std::string head;
+        std::string line;
+        std::string version;
+        std::unordered_map<std::string, std::string>::iterator it;
+        unsigned long int length;
+        bool reused;
+        bool keep;
+
+        request = "GET " + path + " HTTP/1.1\r\nHost: " + (*this).host +
+                  ((*this).port != 80 ? ":" + std::to_string((*this).port) : "") +
+                  "\r\nAccept: text/plain\r\nConnection: keep-alive\r\n\r\n";
+
+        while (true) {
+            reader.fd = (*this).acquire(reused);
+            reader.buffer.clear();
+            reader.pos = 0;
+            response = HTTPResponse();
+
+            try {
+                sendAll(reader.fd, request.data(), request.length());
+
+                if (!reader.head(head)) {
+                    throw std::runtime_error("ERROR: HTTP connection closed before the response!");
+                }
+
+                line = head.substr(0, head.find("\r\n"));
+
+                if (line.compare(0, 5, "HTTP/") != 0 || line.length() < 12) {
+                    throw std::runtime_error("ERROR: Malformed HTTP status line!");
+                }
+
+                version = line.substr(0, 8);
+                response.status = std::atoi(line.c_str() + 9);
+                parseHeaders(head, response.headers);
+                keep = version == "HTTP/1.1";
+
+                if ((it = response.headers.find("connection")) != response.headers.end()) {
+                    keep = lowerCase(it->second) == "keep-alive" || (keep && lowerCase(it->second) != "close");
+                }
+
+                if (response.status / 100 == 1 || response.status == 204 || response.status == 304) {
+                    // No body
+                } else if ((it = response.headers.find("transfer-encoding")) != response.headers.end() &&
+                           lowerCase(it->second).find("chunked") != std::string::npos) {
+                    while ((length = std::stoul(reader.line(), NULL, 16)) > 0) {
+                        reader.take(length, response.body);
+                        reader.line();
+                    }
+
+                    while (!reader.line().empty()) {
+                        // Skip trailers
+                    }
+                } else if ((it = response.headers.find("content-length")) != response.headers.end()) {
+                    reader.take(std::stoul(it->second), response.body);
+                } else {
+                    reader.rest(response.body);
+                    keep = false;
+                }
+            } catch (const std::runtime_error &e) {
+                (*this).release(reader.fd, false);
+
+                if (reused) {
+                    continue;
+                }
+
+                throw;
+            } catch (const std::exception &e) {
+                (*this).release(reader.fd, false);
+                throw std::runtime_error("ERROR: Malformed HTTP response!");
+            }
+
+            (*this).release(reader.fd, keep && reader.pos == reader.buffer.length());
+            return response;
+        }
+    }
+
+    // Build the error for a 3xx `response` to a request made by `who`. Redirects are not followed because they usually lead
+    // to https://, which this client cannot speak.
+    static std::string redirectError(const std::string &who, const HTTPResponse &response) {
+        std::unordered_map<std::string, std::string>::const_iterator location = response.headers.find("location");
+
+        return "ERROR: " + who + " request was redirected with status " + std::to_string(response.status) +
+               (location != response.headers.end() ? " to " + location->second : "") +
+               ", but only plain http:// is supported, so use an http:// mirror or proxy!";
+    }
+
+    // Fetch http://`host``path` and return the response body, throwing when the host cannot be reached or answers with an
+    // error status.
+    std::string httpGet(const std::string &host, const std::string &path) {
+        HTTPClient client(host, 80, 1);
+        HTTPResponse response = client.get(path.empty() || path[0] != '/' ? "/" + path : path);
+
+        if (response.status / 100 == 3) {
+            throw std::runtime_error(redirectError("HTTP", response));
+        } else if (response.status < 200 || response.status >= 300) {
+            throw std::runtime_error("ERROR: HTTP request failed with status " + std::to_string(response.status) + "!");
+        }
+
+        return response.body;
+    }
+
+    // Split FASTA `text` into its records, each starting at a '>' line.
+    static std::vector<std::string> splitFASTARecords(const std::string &text) {
+        std::vector<std::string> records;
+        size_t start = text.find('>');
+        size_t next;
+
+        while (start != std::string::npos) {
+            next = text.find("\n>", start);
+            records.push_back(text.substr(start, next == std::string::npos ? std::string::npos : next + 1 - start));
+            start = next == std::string::npos ? next : next + 1;
+        }
+
+        return records;
+    }
+
+    // Parse FASTA `text` held in memory into protein sequences. Headers lose their '>' and sequence lines are joined.
+    std::vector<AAString> parseFASTA(const std::string &text) {
+        std::vector<AAString> av;
+        std::vector<std::string> records = splitFASTARecords(text);
         std::vector<std::string>::iterator it;
+        std::string header;
+        std::string sequence;
+        size_t end;
+        size_t i;
+
+        for (it = records.begin(); it != records.end(); ++it) {
+            end = it->find('\n');
+            header = it->substr(1, end == std::string::npos ? std::string::npos : end - 1);
+            sequence.clear();
+
+            if (!header.empty() && header.back() == '\r') {
+                header.pop_back();
+            }
+
+            for (i = end == std::string::npos ? it->length() : end + 1; i < it->length(); ++i) {
+                if (!std::isspace((unsigned char) (*it)[i])) {
+                    sequence += (*it)[i];
+                }
+            }
+
+            av.push_back(AAString(header, sequence, GeneticCode::STANDARD_GENETIC_CODE));
+        }
+
+        return av;
+    }
+
+    // Return the accession of a UniProt FASTA header such as "sp|P69905|HBA_HUMAN ...", or its first word otherwise.
+    static std::string headerAccession(const std::string &record) {
+        size_t end = record.find_first_of(" \t\r\n");
+        std::string id = record.substr(1, end == std::string::npos ? std::string::npos : end - 1);
+        size_t first = id.find('|');
+        size_t second;
+
+        if (first == std::string::npos) {
+            return id;
+        }
+
+        second = id.find('|', first + 1);
+        return id.substr(first + 1, second == std::string::npos ? std::string::npos : second - first - 1);
+    }
+
+    // Throw unless `accession` only has the letters, digits and "_-." that accessions and isoform names use, which also
+    // keeps it safe inside URLs and file names.
+    static void checkAccession(const std::string &accession) {
+        if (accession.empty() || accession[0] == '.' ||
+            accession.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_-.") !=
+            std::string::npos) {
+            throw std::invalid_argument("ERROR: Invalid UniProt accession!");
+        }
+    }
+
+    // Create a new `UniProtClient` with `options`, creating the cache directory when it does not exist yet.
+    UniProtClient::UniProtClient(const UniProtOptions &options) :
+        options(options), base(parseURL(options.baseURL)),
+        http(base.host, base.port, std::max(1u, options.connections), options.timeoutMs) {
+        if ((*this).options.batchSize == 0) {
+            throw std::invalid_argument("ERROR: UniProt batch size cannot be 0!");
+        }
+
+        if ((*this).base.path.back() != '/') {
+            (*this).base.path += '/';
+        }
+
+        if (!(*this).options.cacheDir.empty() && mkdir((*this).options.cacheDir.c_str(), 0755) != 0 && errno != EEXIST) {
+            throw std::runtime_error("ERROR: Could not create the UniProt cache directory!");
+        }
+    }
+
+    std::string UniProtClient::cachePath(const std::string &accession) const {
+        return (*this).options.cacheDir + "/" + accession + ".fasta";
+    }
+
+    // Load the cached FASTA record of `accession` into `entry`, returning false when there is none.
+    bool UniProtClient::readCache(const std::string &accession, std::string &entry) const {
+        std::ifstream in;
+        std::stringstream ss;
+
+        if ((*this).options.cacheDir.empty()) {
+            return false;
+        }
+
+        in.open((*this).cachePath(accession), std::ios::binary);
+
+        if (!in) {
+            return false;
+        }
+
+        ss << in.rdbuf();
+        entry = ss.str();
+        return !entry.empty();
+    }
+
+    // Store the FASTA record of `accession`. The record is written to a temporary file and renamed into place, so readers
+    // never see half a record.
+    void UniProtClient::writeCache(const std::string &accession, const std::string &entry) const {
+        std::string path;
+        std::string tmp;
+        std::ofstream out;
+        std::stringstream suffix;
+
+        if ((*this).options.cacheDir.empty()) {
+            return;
+        }
+
+        path = (*this).cachePath(accession);
+        suffix << ".tmp." << getpid() << "." << std::this_thread::get_id();
+        tmp = path + suffix.str();
+        out.open(tmp, std::ios::binary);
+
+        if (!(out << entry) || (out.close(), !out) || std::rename(tmp.c_str(), path.c_str()) != 0) {
+            std::remove(tmp.c_str());
+            throw std::runtime_error("ERROR: Could not write the UniProt cache!");
+        }
+    }
+
+    // Request the FASTA records of `accessions`[`first`, `last`) in one call. Connection failures, 429 and 5xx answers are
+    // retried after `backoffMs`, doubling the wait every time; any other error status throws at once.
+    std::string UniProtClient::request(const std::vector<std::string> &accessions, size_t first, size_t last) {
+        HTTPResponse response;
+        std::string path = (*this).base.path + "accessions?accessions=";
+        bool retryable;
+        unsigned int attempt;
+        size_t i;
+
+        for (i = first; i < last; ++i) {
+            path += (i > first ? "," : "") + accessions[i];
+        }
+
+        path += "&format=fasta";
+
+        for (attempt = 0; ; ++attempt) {
+            try {
+                response = (*this).http.get(path);
+                retryable = response.status == 429 || response.status >= 500;
+            } catch (const std::runtime_error &e) {
+                retryable = true;
+            }
+
+            if (response.status == 200) {
+                return response.body;
+            } else if (response.status == 404) {
+                // None of the accessions exist
+                return "";
+            } else if (response.status / 100 == 3) {
+                throw std::runtime_error(redirectError("UniProt", response));
+            } else if (!retryable) {
+                throw std::runtime_error("ERROR: UniProt request failed with status " + std::to_string(response.status) +
+                                         "!");
+            } else if (attempt >= (*this).options.retries) {
+                throw std::runtime_error("ERROR: UniProt request failed after retrying!");
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds((unsigned long int) (*this).options.backoffMs << attempt));
+        }
+    }
+
+    // Resolve `accessions` to protein sequences in the same order, leaving out the accessions UniProt does not know.
+    // Cached entries are read from disk and the rest are fetched `batchSize` accessions per request over `connections`
+    // concurrent connections, then cached.
+    std::vector<AAString> UniProtClient::fetch(const std::vector<std::string> &accessions) {
+        std::unordered_map<std::string, std::string> found; // Accession to its FASTA record
+        std::unordered_map<std::string, std::string>::iterator it;
+        std::vector<std::string> missing;
         std::vector<AAString> av;
+        std::string entry;
+        std::mutex foundLock;
+        size_t batches;
+        size_t i;
 
-        for (it = vec.begin(); it != vec.end(); it++) {
+        for (i = 0; i < accessions.size(); ++i) {
+            checkAccession(accessions[i]);
 
+            if (found.count(accessions[i]) == 0) {
+                if ((*this).readCache(accessions[i], entry)) {
+                    found[accessions[i]] = entry;
+                } else {
+                    found[accessions[i]] = "";
+                    missing.push_back(accessions[i]);
+                }
+            }
+        }
+
+        batches = (missing.size() + (*this).options.batchSize - 1) / (*this).options.batchSize;
+
+        parallelFor(batches, std::max(1u, (*this).options.connections), [&](size_t b) {
+            size_t first = b * (*this).options.batchSize;
+            size_t last = std::min(missing.size(), first + (*this).options.batchSize);
+            std::vector<std::string> records = splitFASTARecords((*this).request(missing, first, last));
+            std::vector<std::string>::iterator r;
+            std::string accession;
+
+            for (r = records.begin(); r != records.end(); ++r) {
+                accession = headerAccession(*r);
+
+                {
+                    std::lock_guard<std::mutex> guard(foundLock);
+                    std::unordered_map<std::string, std::string>::iterator f = found.find(accession);
+
+                    // Skip records nobody asked for, such as other isoforms of a requested entry
+                    if (f == found.end() || !f->second.empty()) {
+                        continue;
+                    }
+
+                    f->second = *r;
+                }
+
+                (*this).writeCache(accession, *r);
+            }
+        });
+
+        for (i = 0; i < accessions.size(); ++i) {
+            it = found.find(accessions[i]);
+
+            if (!it->second.empty()) {
+                av.push_back(parseFASTA(it->second).front());
+            }
         }
 
         return av;
     }
-}
\ No newline at end of file
+
+    // Create a new `LocalUniProtServer`, which holds no entries and does not listen until started.
+    LocalUniProtServer::LocalUniProtServer() : running(false), requests(0), failures(0) {
+        (*this).listenFd = -1;
+        (*this).port = 0;
+    }
+
+    LocalUniProtServer::~LocalUniProtServer() {
+        (*this).stop();
+    }
+
+    // Serve `sequence` under `accession` with the FASTA header `header`. Entries must be added before the server starts.
+    void LocalUniProtServer::addEntry(const std::string &accession, const std::string &header, const std::string &sequence) {
+        std::string record = ">" + header + "\n";
+        size_t i;
+
+        for (i = 0; i < sequence.length(); i += FASTA_LINE_WIDTH) {
+            record += sequence.substr(i, FASTA_LINE_WIDTH) + "\n";
+        }
+
+        (*this).entries[accession] = record;
+    }
+
+    // Answer the next `n` requests with 503 Service Unavailable.
+    void LocalUniProtServer::failNext(unsigned int n) {
+        (*this).failures = n;
+    }
+
+    // Start listening on an unused port of 127.0.0.1.
+    void LocalUniProtServer::start() {
+        struct sockaddr_in address;
+        socklen_t addressLength = sizeof(address);
+        int one = 1;
+
+        if ((*this).running) {
+            return;
+        }
+
+        (*this).listenFd = socket(AF_INET, SOCK_STREAM, 0);
+
+        if ((*this).listenFd < 0) {
+            throw std::runtime_error("ERROR: LocalUniProtServer could not create a socket!");
+        }
+
+        setsockopt((*this).listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = 0;
+
+        if (bind((*this).listenFd, (struct sockaddr *) &address, sizeof(address)) != 0 || listen((*this).listenFd, 128) != 0 ||
+            getsockname((*this).listenFd, (struct sockaddr *) &address, &addressLength) != 0) {
+            close((*this).listenFd);
+            (*this).listenFd = -1;
+            throw std::runtime_error("ERROR: LocalUniProtServer could not listen!");
+        }
+
+        (*this).port = ntohs(address.sin_port);
+        (*this).running = true;
+        (*this).acceptThread = std::thread(&LocalUniProtServer::acceptLoop, this);
+    }
+
+    // Stop listening, drop every open connection and wait for the server threads to finish.
+    void LocalUniProtServer::stop() {
+        std::vector<int>::iterator it;
+        std::vector<std::thread>::iterator t;
+
+        if (!(*this).running.exchange(false)) {
+            return;
+        }
+
+        shutdown((*this).listenFd, SHUT_RDWR);
+        (*this).acceptThread.join();
+        close((*this).listenFd);
+        (*this).listenFd = -1;
+
+        {
+            std::lock_guard<std::mutex> guard((*this).lock);
+
+            for (it = (*this).connectionFds.begin(); it != (*this).connectionFds.end(); ++it) {
+                shutdown(*it, SHUT_RDWR);
+            }
+        }
+
+        for (t = (*this).connectionThreads.begin(); t != (*this).connectionThreads.end(); ++t) {
+            t->join();
+        }
+
+        (*this).connectionThreads.clear();
+    }
+
+    // Accept connections until the server stops, serving each on its own thread.
+    void LocalUniProtServer::acceptLoop() {
+        int fd;
+
+        while ((*this).running) {
+            fd = accept((*this).listenFd, NULL, NULL);
+
+            if (fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+
+                break;
+            }
+
+            std::lock_guard<std::mutex> guard((*this).lock);
+
+            if (!(*this).running) {
+                close(fd);
+                break;
+            }
+
+            (*this).connectionFds.push_back(fd);
+            (*this).connectionThreads.push_back(std::thread(&LocalUniProtServer::serve, this, fd));
+        }
+    }
+
+    // Answer keep-alive requests on the connection `fd` until the client closes it or the server stops.
+    void LocalUniProtServer::serve(int fd) {
+        SocketReader reader;
+        std::string head;
+        std::string target;
+        std::string body;
+        std::string response;
+        unsigned int pending;
+        size_t space;
+        int status;
+
+        reader.fd = fd;
+
+        try {
+            while (reader.head(head)) {
+                ++(*this).requests;
+                space = head.find(' ');
+                target = space == std::string::npos ? "" : head.substr(space + 1, head.find(' ', space + 1) - space - 1);
+                pending = (*this).failures;
+
+                while (pending > 0 && !(*this).failures.compare_exchange_weak(pending, pending - 1)) {
+                    // Another connection took a failure first, try again with the new count
+                }
+
+                if (head.compare(0, 4, "GET ") != 0) {
+                    status = 405;
+                    body = "Method not allowed\n";
+                } else if (pending > 0) {
+                    status = 503;
+                    body = "Service unavailable\n";
+                } else {
+                    body = (*this).answer(target, status);
+                }
+
+                response = "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK" : " Error") +
+                           "\r\nContent-Type: text/plain\r\nContent-Length: " + std::to_string(body.length()) +
+                           "\r\nConnection: keep-alive\r\n\r\n" + body;
+                sendAll(fd, response.data(), response.length());
+            }
+        } catch (const std::exception &e) {
+            // The client went away or the server is stopping
+        }
+
+        std::lock_guard<std::mutex> guard((*this).lock);
+        (*this).connectionFds.erase(std::find((*this).connectionFds.begin(), (*this).connectionFds.end(), fd));
+        close(fd);
+    }
+
+    // Build the body answering `target`, a path ending in "/accessions" with an accessions=A,B,... query, and set `status`.
+    std::string LocalUniProtServer::answer(const std::string &target, int &status) {
+        const std::string endpoint = "/accessions";
+        const std::string key = "accessions=";
+        std::unordered_map<std::string, std::string>::const_iterator it;
+        std::string path = target.substr(0, target.find('?'));
+        std::string query = target.find('?') == std::string::npos ? "" : target.substr(target.find('?') + 1);
+        std::string list;
+        std::string body;
+        size_t start;
+        size_t end;
+
+        if (path.length() < endpoint.length() || path.compare(path.length() - endpoint.length(), endpoint.length(), endpoint) != 0) {
+            status = 404;
+            return "Not found\n";
+        }
+
+        start = query.find(key);
+
+        while (start != std::string::npos && start > 0 && query[start - 1] != '&') {
+            start = query.find(key, start + 1);
+        }
+
+        if (start != std::string::npos) {
+            list = query.substr(start + key.length(), query.find('&', start) - start - key.length());
+        }
+
+        for (start = 0; start < list.length(); start = end + 1) {
+            end = list.find(',', start);
+
+            if (end == std::string::npos) {
+                end = list.length();
+            }
+
+            if ((it = (*this).entries.find(list.substr(start, end - start))) != (*this).entries.end()) {
+                body += it->second;
+            }
+        }
+
+        status = 200;
+        return body;
+    }
+
+    // Get the base URL a `UniProtClient` should use to reach this server.
+    std::string LocalUniProtServer::getURL() const {
+        return "http://127.0.0.1:" + std::to_string((*this).port) + "/uniprotkb/";
+    }
+
+    // Get the number of requests answered so far, failed ones included.
+    unsigned long int LocalUniProtServer::getRequestCount() const {
+        return (*this).requests;
+    }
+
+    // Resolve the UniProt accessions in `vec` to protein sequences with the default client options, sending the requests to
+    // `baseURL`.
+    std::vector<AAString> queryUniProt(std::vector<std::string> &vec, const std::string &baseURL) {
+        UniProtOptions options;
+
+        options.baseURL = baseURL;
+        return UniProtClient(options).fetch(vec);
+    }
+}
@@ -0,0 +1,715 @@
+#include <seqio.hpp>
+#include <fundamentals.hpp>
+#include <batch.hpp>
+#include <parallel.hpp>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <iterator>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace bioinfo {
+    // Open the FASTA file with name `fn` for streaming, reading it `blockSize` bytes at a time.
+    FASTAReader::FASTAReader(const std::string &fn, size_t blockSize) {
+        if (blockSize == 0) {
+            throw std::invalid_argument("ERROR: FASTAReader block size cannot be 0!");
+        }
+
+        (*this).file = std::fopen(fn.c_str(), "rb");
+
+        if ((*this).file == NULL) {
+            throw std::invalid_argument("ERROR: FASTAReader could not open file!");
+        }
+
+        (*this).buffer.resize(blockSize);
+        (*this).bufferPos = 0;
+        (*this).bufferEnd = 0;
+    }
+
+    FASTAReader::~FASTAReader() {
+        std::fclose((*this).file);
+    }
+
+    // Read the next block of the file into the buffer. Returns false once the end of the file is reached.
+    bool FASTAReader::fillBuffer() {
+        (*this).bufferPos = 0;
+        (*this).bufferEnd = std::fread((*this).buffer.data(), 1, (*this).buffer.size(), (*this).file);
+
+        if ((*this).bufferEnd == 0 && std::ferror((*this).file)) {
+            throw std::runtime_error("ERROR: FASTAReader failed to read from file!");
+        }
+
+        return (*this).bufferEnd > 0;
+    }
+
+    // Look at the next character without consuming it, or EOF if there is nothing left to read.
+    int FASTAReader::peekChar() {
+        if ((*this).bufferPos == (*this).bufferEnd && !(*this).fillBuffer()) {
+            return EOF;
+        }
+
+        return (unsigned char) (*this).buffer[(*this).bufferPos];
+    }
+
+    // Append the rest of the current line to `s` straight from the buffer and consume the newline. A trailing '\r' is dropped.
+    void FASTAReader::appendLine(std::string &s) {
+        const char *start;
+        const char *newline;
+        size_t available;
+
+        while ((*this).bufferPos < (*this).bufferEnd || (*this).fillBuffer()) {
+            start = (*this).buffer.data() + (*this).bufferPos;
+            available = (*this).bufferEnd - (*this).bufferPos;
+            newline = (const char *) std::memchr(start, '\n', available);
+
+            if (newline != NULL) {
+                s.append(start, newline - start);
+                (*this).bufferPos += newline - start + 1;
+                break;
+            }
+
+            s.append(start, available);
+            (*this).bufferPos = (*this).bufferEnd;
+        }
+
+        if (!s.empty() && s.back() == '\r') {
+            s.pop_back();
+        }
+    }
+
+    // Consume the rest of the current line without keeping it.
+    void FASTAReader::skipLine() {
+        const char *start;
+        const char *newline;
+
+        while ((*this).bufferPos < (*this).bufferEnd || (*this).fillBuffer()) {
+            start = (*this).buffer.data() + (*this).bufferPos;
+            newline = (const char *) std::memchr(start, '\n', (*this).bufferEnd - (*this).bufferPos);
+
+            if (newline != NULL) {
+                (*this).bufferPos += newline - start + 1;
+                break;
+            }
+
+            (*this).bufferPos = (*this).bufferEnd;
+        }
+    }
+
+    // Parse the next record into a header `h` and sequence `s`. Lines before the first header are ignored and records with an
+    // empty header are skipped, the same as the original whole-file reader.
+    bool FASTAReader::readRecord(std::string &h, std::string &s) {
+        int c;
+
+        while ((c = (*this).peekChar()) != '>') {
+            if (c == EOF) {
+                return false;
+            }
+
+            (*this).skipLine();
+        }
+
+        do {
+            h.clear();
+            s.clear();
+
+            // Consume the '>' and read the header line
+            ++(*this).bufferPos;
+            (*this).appendLine(h);
+
+            while ((c = (*this).peekChar()) != EOF && c != '>') {
+                (*this).appendLine(s);
+            }
+        } while (h.empty() && c != EOF);
+
+        return !h.empty();
+    }
+
+    // Read the next record of the file into `ds`. Returns false when there are no records left.
+    bool FASTAReader::next(DNAString &ds) {
+        std::string header;
+        std::string seq;
+
+        if (!(*this).readRecord(header, seq)) {
+            return false;
+        }
+
+        ds = DNAString(std::move(header), std::move(seq));
+        return true;
+    }
+
+    // Replace the contents of `batch` with up to `n` records and return how many were read.
+    size_t FASTAReader::nextBatch(std::vector<DNAString> &batch, size_t n) {
+        DNAString ds;
+
+        batch.clear();
+
+        while (batch.size() < n && (*this).next(ds)) {
+            batch.push_back(std::move(ds));
+        }
+
+        return batch.size();
+    }
+
+    // Replace the contents of `batch` with up to `n` records and return how many were read. Reading also stops once the batch
+    // holds `maxBases` bases, so a batch is never much larger than that plus one record. The batch and the record buffers of
+    // the reader keep their memory between calls, so reading batches of a similar size does not allocate.
+    size_t FASTAReader::nextBatch(SequenceBatch &batch, size_t n, size_t maxBases) {
+        batch.clear();
+
+        while (batch.size() < n && batch.getTotalLength() < maxBases &&
+               (*this).readRecord((*this).recordHeader, (*this).recordSequence)) {
+            batch.append((*this).recordHeader, (*this).recordSequence);
+        }
+
+        return batch.size();
+    }
+
+    // Get an iterator positioned at the next unread record of the file.
+    FASTAReader::iterator FASTAReader::begin() {
+        return iterator(this);
+    }
+
+    // Get the iterator that marks the end of the file.
+    FASTAReader::iterator FASTAReader::end() {
+        return iterator();
+    }
+
+    // --------------------------------------------------------------------------
+
+    FASTAReader::iterator::iterator() {
+        (*this).reader = NULL;
+    }
+
+    FASTAReader::iterator::iterator(FASTAReader *r) {
+        (*this).reader = r;
+        ++(*this);
+    }
+
+    DNAString &FASTAReader::iterator::operator*() {
+        return (*this).current;
+    }
+
+    DNAString *FASTAReader::iterator::operator->() {
+        return &(*this).current;
+    }
+
+    FASTAReader::iterator &FASTAReader::iterator::operator++() {
+        if ((*this).reader != NULL && !(*this).reader->next((*this).current)) {
+            (*this).reader = NULL;
+        }
+
+        return *this;
+    }
+
+    bool FASTAReader::iterator::operator==(const iterator &other) const {
+        return (*this).reader == other.reader;
+    }
+
+    bool FASTAReader::iterator::operator!=(const iterator &other) const {
+        return (*this).reader != other.reader;
+    }
+
+    // --------------------------------------------------------------------------
+
+    // Map the file with name `fn` read-only into memory.
+    MappedFile::MappedFile(const std::string &fn) {
+        struct stat st;
+        void *p;
+
+        (*this).fd = open(fn.c_str(), O_RDONLY);
+
+        if ((*this).fd < 0) {
+            throw std::invalid_argument("ERROR: MappedFile could not open file!");
+        }
+
+        if (fstat((*this).fd, &st) != 0) {
+            close((*this).fd);
+            throw std::runtime_error("ERROR: MappedFile could not get the size of the file!");
+        }
+
+        (*this).size = st.st_size;
+        (*this).data = NULL;
+
+        if ((*this).size > 0) {
+            p = mmap(NULL, (*this).size, PROT_READ, MAP_PRIVATE, (*this).fd, 0);
+
+            if (p == MAP_FAILED) {
+                close((*this).fd);
+                throw std::runtime_error("ERROR: MappedFile could not map the file!");
+            }
+
+            (*this).data = (const char *) p;
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        if ((*this).data != NULL) {
+            munmap((void *) (*this).data, (*this).size);
+        }
+
+        close((*this).fd);
+    }
+
+    // Get a pointer to the first byte of the mapped file
+    const char *MappedFile::getData() const {
+        return (*this).data;
+    }
+
+    // Get how many bytes are in the mapped file
+    size_t MappedFile::getSize() const {
+        return (*this).size;
+    }
+
+    // --------------------------------------------------------------------------
+
+    // Open the FASTA file with name `fn` for random access. The index is loaded from `fn`.fai when it exists and is otherwise
+    // built in memory by scanning the mapped file once.
+    IndexedFASTA::IndexedFASTA(const std::string &fn) : file(fn) {
+        if (!(*this).loadIndex(fn + ".fai")) {
+            (*this).buildIndex();
+        }
+    }
+
+    // Open the FASTA file with name `fn` for random access using the index file `indexFn`. If the index file does not exist yet
+    // it is built and written to `indexFn`.
+    IndexedFASTA::IndexedFASTA(const std::string &fn, const std::string &indexFn) : file(fn) {
+        if (!(*this).loadIndex(indexFn)) {
+            (*this).buildIndex();
+            (*this).writeIndex(indexFn);
+        }
+    }
+
+    // Build the index by scanning every line of the mapped file. Every line of a sequence except the last must have the same
+    // length, the same rule samtools uses.
+    void IndexedFASTA::buildIndex() {
+        const char *data = (*this).file.getData();
+        const char *end = data + (*this).file.getSize();
+        const char *p = data;
+        const char *newline;
+        const char *next;
+        const char *contentEnd;
+        const char *nameEnd;
+
+        FASTAIndexEntry entry;
+        bool inRecord = false;
+        bool sawLastLine = false;
+        unsigned long int bases;
+
+        (*this).entries.clear();
+        (*this).lookup.clear();
+
+        while (p < end) {
+            newline = (const char *) std::memchr(p, '\n', end - p);
+            next = newline != NULL ? newline + 1 : end;
+            contentEnd = newline != NULL ? newline : end;
+
+            if (contentEnd > p && contentEnd[-1] == '\r') {
+                --contentEnd;
+            }
+
+            if (*p == '>') {
+                if (inRecord) {
+                    (*this).entries.push_back(entry);
+                }
+
+                nameEnd = p + 1;
+                while (nameEnd < contentEnd && *nameEnd != ' ' && *nameEnd != '\t') {
+                    ++nameEnd;
+                }
+
+                entry = FASTAIndexEntry();
+                entry.name = std::string(p + 1, nameEnd);
+                entry.offset = next - data;
+                inRecord = true;
+                sawLastLine = false;
+            } else if (inRecord) {
+                bases = contentEnd - p;
+
+                if (bases == 0) {
+                    sawLastLine = true;
+                } else if (sawLastLine || (entry.lineBases != 0 && bases > entry.lineBases)) {
+                    throw std::runtime_error("ERROR: IndexedFASTA found lines of different lengths in sequence " + entry.name + "!");
+                } else if (entry.lineBases == 0) {
+                    entry.lineBases = bases;
+                    entry.lineWidth = next - p;
+                } else if (bases < entry.lineBases) {
+                    sawLastLine = true;
+                } else if ((unsigned long int) (next - p) != entry.lineWidth && next != end) {
+                    throw std::runtime_error("ERROR: IndexedFASTA found mixed line endings in sequence " + entry.name + "!");
+                }
+
+                entry.length += bases;
+            }
+
+            p = next;
+        }
+
+        if (inRecord) {
+            (*this).entries.push_back(entry);
+        }
+
+        for (size_t i = 0; i < (*this).entries.size(); ++i) {
+            if (!(*this).lookup.emplace((*this).entries[i].name, i).second) {
+                throw std::runtime_error("ERROR: IndexedFASTA found duplicate sequence name " + (*this).entries[i].name + "!");
+            }
+        }
+    }
+
+    // Load a .fai index from the file with name `fn`. Returns false if the file does not exist.
+    bool IndexedFASTA::loadIndex(const std::string &fn) {
+        std::ifstream indexFile(fn);
+        std::string line;
+        std::string field;
+        FASTAIndexEntry entry;
+
+        if (!indexFile.good()) {
+            return false;
+        }
+
+        (*this).entries.clear();
+        (*this).lookup.clear();
+
+        while (std::getline(indexFile, line)) {
+            if (line.empty()) {
+                continue;
+            }
+
+            std::stringstream ss(line);
+
+            // Reject lines that would make fetches divide by zero or read the wrong bytes, and names already indexed
+            if (!std::getline(ss, entry.name, '\t') || !(ss >> entry.length >> entry.offset >> entry.lineBases >> entry.lineWidth) ||
+                (entry.lineBases == 0 && entry.length > 0) || entry.lineWidth < entry.lineBases ||
+                !(*this).lookup.emplace(entry.name, (*this).entries.size()).second) {
+                throw std::runtime_error("ERROR: IndexedFASTA could not parse index line: " + line);
+            }
+
+            (*this).entries.push_back(entry);
+        }
+
+        return true;
+    }
+
+    // Write the index in samtools .fai format to the file with name `indexFn`.
+    void IndexedFASTA::writeIndex(const std::string &indexFn) const {
+        std::ofstream indexFile(indexFn);
+        std::vector<FASTAIndexEntry>::const_iterator it;
+
+        if (!indexFile.good()) {
+            throw std::invalid_argument("ERROR: IndexedFASTA could not open index file for writing!");
+        }
+
+        for (it = (*this).entries.begin(); it != (*this).entries.end(); it++) {
+            indexFile << it->name << "\t" << it->length << "\t" << it->offset << "\t" << it->lineBases << "\t" << it->lineWidth << "\n";
+        }
+    }
+
+    // Get every sequence in the index, in file order
+    const std::vector<FASTAIndexEntry> &IndexedFASTA::getEntries() const {
+        return (*this).entries;
+    }
+
+    // Check if the index has a sequence named `name`
+    bool IndexedFASTA::hasSequence(const std::string &name) const {
+        return (*this).lookup.find(name) != (*this).lookup.end();
+    }
+
+    const FASTAIndexEntry &IndexedFASTA::getEntry(const std::string &name) const {
+        std::unordered_map<std::string, size_t>::const_iterator it = (*this).lookup.find(name);
+
+        if (it == (*this).lookup.end()) {
+            throw std::invalid_argument("ERROR: IndexedFASTA has no sequence named " + name + "!");
+        }
+
+        return (*this).entries[it->second];
+    }
+
+    // Get the bases [`start`, `end`) (0-based) of the sequence `name` by copying whole line segments out of the mapped file.
+    // `end` is clamped to the length of the sequence.
+    std::string IndexedFASTA::fetchSequence(const std::string &name, unsigned long int start, unsigned long int end) const {
+        const FASTAIndexEntry &entry = (*this).getEntry(name);
+        std::string seq;
+
+        unsigned long int i;
+        unsigned long int col;
+        unsigned long int count;
+        unsigned long int byte;
+
+        end = std::min(end, entry.length);
+
+        if (start >= end) {
+            return seq;
+        }
+
+        seq.resize(end - start);
+
+        for (i = start; i < end; i += count) {
+            col = i % entry.lineBases;
+            count = std::min(entry.lineBases - col, end - i);
+            byte = entry.offset + (i / entry.lineBases) * entry.lineWidth + col;
+
+            if (byte + count > (*this).file.getSize()) {
+                throw std::runtime_error("ERROR: IndexedFASTA index does not match the FASTA file!");
+            }
+
+            std::memcpy(&seq[i - start], (*this).file.getData() + byte, count);
+        }
+
+        return seq;
+    }
+
+    // Get the bases [`start`, `end`) (0-based) of the sequence `name` as a DNAString with a samtools style region header.
+    DNAString IndexedFASTA::fetch(const std::string &name, unsigned long int start, unsigned long int end) const {
+        std::string seq = (*this).fetchSequence(name, start, end);
+
+        return DNAString(name + ":" + std::to_string(start + 1) + "-" + std::to_string(start + seq.length()), std::move(seq));
+    }
+
+    // Get a region written as `name`, `name:start` or `name:start-end` (1-based and inclusive, commas allowed in the numbers
+    // like samtools faidx).
+    DNAString IndexedFASTA::fetch(const std::string &region) const {
+        std::string::size_type colon;
+        std::string::size_type dash;
+        std::string name;
+        std::string range;
+        unsigned long int start = 1;
+        unsigned long int end;
+
+        if ((*this).hasSequence(region)) {
+            return DNAString(region, (*this).fetchSequence(region, 0, (*this).getEntry(region).length));
+        }
+
+        colon = region.rfind(':');
+
+        if (colon == std::string::npos) {
+            throw std::invalid_argument("ERROR: IndexedFASTA has no sequence named " + region + "!");
+        }
+
+        name = region.substr(0, colon);
+        end = (*this).getEntry(name).length;
+
+        for (char c : region.substr(colon + 1)) {
+            if (c != ',') {
+                range += c;
+            }
+        }
+
+        try {
+            dash = range.find('-');
+            start = std::stoul(range.substr(0, dash));
+
+            if (dash != std::string::npos) {
+                end = std::stoul(range.substr(dash + 1));
+            }
+        } catch (const std::logic_error &e) {
+            throw std::invalid_argument("ERROR: IndexedFASTA could not parse region " + region + "!");
+        }
+
+        if (start == 0) {
+            start = 1;
+        }
+
+        return DNAString(region, (*this).fetchSequence(name, start - 1, end));
+    }
+
+    // --------------------------------------------------------------------------
+
+    // Smallest chunk handed to a parsing thread, so small files are not split into pointless pieces
+    static const size_t MIN_PARSE_CHUNK_SIZE = 1 << 20;
+
+    // Find the end of the line starting at `p`, and where the next line starts.
+    static const char *findLineEnd(const char *p, const char *end, const char **next) {
+        const char *newline = (const char *) std::memchr(p, '\n', end - p);
+        const char *contentEnd = newline != NULL ? newline : end;
+
+        *next = newline != NULL ? newline + 1 : end;
+
+        if (contentEnd > p && contentEnd[-1] == '\r') {
+            --contentEnd;
+        }
+
+        return contentEnd;
+    }
+
+    // Move `p` forward to the start of the next FASTA record (a '>' at the start of a line).
+    static const char *nextFASTARecord(const char *data, const char *p, const char *end) {
+        while (p < end && !(*p == '>' && (p == data || p[-1] == '\n'))) {
+            p = (const char *) std::memchr(p, '\n', end - p);
+            p = p == NULL ? end : p + 1;
+        }
+
+        return p;
+    }
+
+    // Move `p` forward to the start of the next FASTQ record. A quality line can also start with '@', so a line only counts as
+    // a header when the line two below it starts with '+'.
+    static const char *nextFASTQRecord(const char *data, const char *p, const char *end) {
+        const char *line;
+        const char *next;
+
+        if (p != data) {
+            findLineEnd(p - 1, end, &p);
+        }
+
+        while (p < end) {
+            if (*p == '@') {
+                findLineEnd(p, end, &line);
+                findLineEnd(line, end, &next);
+
+                if (next == end || *next == '+') {
+                    return p;
+                }
+            }
+
+            findLineEnd(p, end, &p);
+        }
+
+        return end;
+    }
+
+    // Split the mapped file into at most `chunks` pieces that each start on a record boundary found by `nextRecord`.
+    template <typename F> static std::vector<const char *> splitRecords(const MappedFile &file, size_t chunks, F nextRecord) {
+        std::vector<const char *> bounds;
+        const char *data = file.getData();
+        const char *end = data + file.getSize();
+        const char *p;
+        size_t i;
+
+        chunks = std::max<size_t>(1, std::min(chunks, file.getSize() / MIN_PARSE_CHUNK_SIZE));
+        bounds.push_back(data);
+
+        for (i = 1; i < chunks; ++i) {
+            p = nextRecord(data, std::max(bounds.back(), data + file.getSize() / chunks * i), end);
+
+            if (p > bounds.back() && p < end) {
+                bounds.push_back(p);
+            }
+        }
+
+        bounds.push_back(end);
+        return bounds;
+    }
+
+    // Parse every FASTA record in [`p`, `end`) into `out`, following the same rules as FASTAReader.
+    static void parseFASTAChunk(const char *p, const char *end, std::vector<DNAString> &out) {
+        const char *next;
+        const char *contentEnd;
+        std::string header;
+        std::string seq;
+        bool inRecord = false;
+
+        while (p < end) {
+            contentEnd = findLineEnd(p, end, &next);
+
+            if (*p == '>') {
+                if (!header.empty()) {
+                    out.push_back(DNAString(std::move(header), std::move(seq)));
+                }
+
+                header.assign(p + 1, contentEnd);
+                seq.clear();
+                inRecord = true;
+            } else if (inRecord) {
+                seq.append(p, contentEnd);
+            }
+
+            p = next;
+        }
+
+        if (!header.empty()) {
+            out.push_back(DNAString(std::move(header), std::move(seq)));
+        }
+    }
+
+    // Parse every 4-line FASTQ record in [`p`, `end`) into `out`.
+    static void parseFASTQChunk(const char *p, const char *end, std::vector<FASTQRecord> &out) {
+        const char *lines[4];
+        const char *lineEnds[4];
+        const char *next;
+        FASTQRecord record;
+        unsigned int i;
+
+        while (p < end) {
+            // Blank lines between records are skipped
+            if (*p == '\n' || *p == '\r') {
+                findLineEnd(p, end, &p);
+                continue;
+            }
+
+            for (i = 0; i < 4; ++i) {
+                if (p >= end) {
+                    throw std::runtime_error("ERROR: readFASTQFile found a truncated record!");
+                }
+
+                lines[i] = p;
+                lineEnds[i] = findLineEnd(p, end, &next);
+                p = next;
+            }
+
+            if (*lines[0] != '@' || *lines[2] != '+') {
+                throw std::runtime_error("ERROR: readFASTQFile found a malformed record!");
+            }
+
+            if (lineEnds[1] - lines[1] != lineEnds[3] - lines[3]) {
+                throw std::runtime_error("ERROR: readFASTQFile found a quality string that does not match its sequence length!");
+            }
+
+            record.read = DNAString(std::string(lines[0] + 1, lineEnds[0]), std::string(lines[1], lineEnds[1]));
+            record.quality.assign(lines[3], lineEnds[3]);
+            out.push_back(std::move(record));
+        }
+    }
+
+    // Parse the chunks between `bounds` with `parse` on `threads` threads and join the per-chunk batches in file order.
+    template <typename T, typename F>
+    static std::vector<T> parseChunks(const std::vector<const char *> &bounds, unsigned int threads, F parse) {
+        std::vector<std::vector<T>> batches(bounds.size() - 1);
+        std::vector<T> records;
+        size_t total = 0;
+        size_t i;
+
+        parallelFor(batches.size(), threads, [&](size_t c) {
+            parse(bounds[c], bounds[c + 1], batches[c]);
+        });
+
+        for (i = 0; i < batches.size(); ++i) {
+            total += batches[i].size();
+        }
+
+        records.reserve(total);
+
+        for (i = 0; i < batches.size(); ++i) {
+            std::move(batches[i].begin(), batches[i].end(), std::back_inserter(records));
+            std::vector<T>().swap(batches[i]);
+        }
+
+        return records;
+    }
+
+    // Read a FASTA file with name `fn` on `threads` threads (0 for one per core). The mapped file is split on '>' record
+    // boundaries and every chunk is parsed into its own batch, so the records come back in file order.
+    std::vector<DNAString> readFASTAFileParallel(const std::string &fn, unsigned int threads) {
+        MappedFile file(fn);
+
+        threads = resolveThreadCount(threads);
+
+        return parseChunks<DNAString>(splitRecords(file, threads * 4, nextFASTARecord), threads, parseFASTAChunk);
+    }
+
+    // Read a 4-line FASTQ file with name `fn` on `threads` threads (0 for one per core). The mapped file is split on '@'
+    // record boundaries and the records come back in file order.
+    std::vector<FASTQRecord> readFASTQFile(const std::string &fn, unsigned int threads) {
+        MappedFile file(fn);
+
+        threads = resolveThreadCount(threads);
+
+        return parseChunks<FASTQRecord>(splitRecords(file, threads * 4, nextFASTQRecord), threads, parseFASTQChunk);
+    }
+}
\ No newline at end of file